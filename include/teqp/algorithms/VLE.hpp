@@ -7,6 +7,7 @@
 #include "teqp/algorithms/critical_pure.hpp"
 #include "teqp/algorithms/VLE_types.hpp"
 #include "teqp/algorithms/VLE_pure.hpp"
+#include "teqp/algorithms/trace_columns.hpp"
 #include <Eigen/Dense>
 
 // Imports from boost for numerical integration
@@ -785,11 +786,59 @@ auto get_dpsat_dTsat_isopleth(const Model& model, const double& T, const Eigen::
     //return der;
 }
 
+/**
+ Collects the points of a binary VLE trace, which are handed over as a VLETraceColumns at the end of the trace
+ */
+struct VLETraceColumnsBuilder {
+    std::vector<double> t, dt, T, pL, pV, c;
+    internal::RowAccumulator rhoL, rhoV, drhodt, critL, critV;
+    
+    template<typename VecType>
+    void push_back(double t_, double dt_, double T_, double pL_, double pV_, double c_, const VecType& rhovecL, const VecType& rhovecV, const std::vector<double>& drhodt_) {
+        t.push_back(t_); dt.push_back(dt_); T.push_back(T_); pL.push_back(pL_); pV.push_back(pV_); c.push_back(c_);
+        rhoL.push_back(rhovecL); rhoV.push_back(rhovecV); drhodt.push_back(drhodt_);
+    }
+    VLETraceColumns get(const std::string& termination_reason) const {
+        using internal::to_column;
+        return VLETraceColumns{to_column(t), to_column(dt), to_column(T), to_column(pL), to_column(pV), to_column(c),
+            rhoL.get(), rhoV.get(), drhodt.get(), critL.get(), critV.get(), termination_reason};
+    }
+};
+
+/**
+ * \brief Convert the columns of a binary VLE trace into the JSON format, an array with one object per point
+ */
+inline nlohmann::json VLE_trace_to_JSON(const VLETraceColumns& cols) {
+    auto JSONdata = nlohmann::json::array();
+    for (Eigen::Index i = 0; i < cols.T.size(); ++i) {
+        Eigen::ArrayXd rhovecL = cols.rhoL.row(i).transpose(), rhovecV = cols.rhoV.row(i).transpose();
+        Eigen::ArrayXd drhodt = cols.drhodt.row(i).transpose();
+        nlohmann::json point = {
+            {"t", cols.t[i]},
+            {"dt", cols.dt[i]},
+            {"T / K", cols.T[i]},
+            {"pL / Pa", cols.pL[i]},
+            {"pV / Pa", cols.pV[i]},
+            {"c", cols.c[i]},
+            {"rhoL / mol/m^3", rhovecL},
+            {"rhoV / mol/m^3", rhovecV},
+            {"xL_0 / mole frac.", rhovecL[0]/rhovecL.sum()},
+            {"xV_0 / mole frac.", rhovecV[0]/rhovecV.sum()},
+            {"drho/dt", drhodt}
+        };
+        if (cols.critL.rows() > 0) {
+            point["crit. conditions L"] = Eigen::ArrayXd(cols.critL.row(i).transpose());
+            point["crit. conditions V"] = Eigen::ArrayXd(cols.critV.row(i).transpose());
+        }
+        JSONdata.push_back(point);
+    }
+    return JSONdata;
+}
+
 /***
- * \brief Trace an isotherm with parametric tracing
- * \ note If options.revision is 2, the data will be returned in the "data" field, otherwise the data will be returned as root array
+ * \brief Trace an isotherm with parametric tracing, returning the trace in columnar form
 */
-inline auto trace_VLE_isotherm_binary(const AbstractModel &model, double T, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<TVLEOptions>& options = std::nullopt)
+inline auto trace_VLE_isotherm_binary_columns(const AbstractModel &model, double T, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<TVLEOptions>& options = std::nullopt)
 {
     // Get the options, or the default values if not provided
     TVLEOptions opt = options.value_or(TVLEOptions{});
@@ -804,7 +853,7 @@ inline auto trace_VLE_isotherm_binary(const AbstractModel &model, double T, cons
     auto norm = [](const auto& v) { return (v * v).sum(); };
 
     // Define datatypes and functions for tracing tools
-    auto JSONdata = nlohmann::json::array();
+    VLETraceColumnsBuilder builder;
 
     // Typedefs for the types
     using namespace boost::numeric::odeint;
@@ -900,26 +949,12 @@ inline auto trace_VLE_isotherm_binary(const AbstractModel &model, double T, cons
                 std::cout << "Something bad happened; couldn't calculate xprime in store_point" << std::endl;
             }
 
-            // Store the data in a JSON structure
-            nlohmann::json point = {
-                {"t", t},
-                {"dt", dt},
-                {"T / K", T},
-                {"pL / Pa", pL},
-                {"pV / Pa", pV},
-                {"c", c},
-                {"rhoL / mol/m^3", rhovecL},
-                {"rhoV / mol/m^3", rhovecV},
-                {"xL_0 / mole frac.", rhovecL[0]/rhovecL.sum()},
-                {"xV_0 / mole frac.", rhovecV[0]/rhovecV.sum()},
-                {"drho/dt", last_drhodt}
-            };
+            // Store the data in the columns
+            builder.push_back(t, dt, T, pL, pV, c, rhovecL, rhovecV, last_drhodt);
             if (opt.calc_criticality) {
-                point["crit. conditions L"] = model.get_criticality_conditions(T, rhovecL);
-                point["crit. conditions V"] = model.get_criticality_conditions(T, rhovecV);
+                builder.critL.push_back(model.get_criticality_conditions(T, rhovecL));
+                builder.critV.push_back(model.get_criticality_conditions(T, rhovecV));
             }
-            JSONdata.push_back(point);
-            //std::cout << JSONdata.back().dump() << std::endl;
         };
         if (istep == 0 && retry_count == 0) {
             store_point();
@@ -1010,29 +1045,40 @@ inline auto trace_VLE_isotherm_binary(const AbstractModel &model, double T, cons
         store_point(); // last_drhodt is updated;
         
     }
+    return builder.get(termination_reason);
+}
+
+/***
+ * \brief Trace an isotherm with parametric tracing
+ * \ note If options.revision is 2, the data will be returned in the "data" field, otherwise the data will be returned as root array
+*/
+inline auto trace_VLE_isotherm_binary(const AbstractModel &model, double T, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<TVLEOptions>& options = std::nullopt)
+{
+    TVLEOptions opt = options.value_or(TVLEOptions{});
+    if (opt.revision != 1 && opt.revision != 2){
+        throw teqp::InvalidArgument("revision is not valid");
+    }
+    auto cols = trace_VLE_isotherm_binary_columns(model, T, rhovecL0, rhovecV0, opt);
+    auto JSONdata = VLE_trace_to_JSON(cols);
     if (opt.revision == 1){
         return JSONdata;
     }
-    else if (opt.revision == 2){
+    else {
         nlohmann::json meta{
-            {"termination_reason", termination_reason}
+            {"termination_reason", cols.termination_reason}
         };
         return nlohmann::json{
             {"meta", meta},
             {"data", JSONdata}
         };
     }
-    else
-    {
-        throw teqp::InvalidArgument("revision is not valid");
-    }
 }
 
 /***
-* \brief Trace an isobar with parametric tracing
+* \brief Trace an isobar with parametric tracing, returning the trace in columnar form
 */
 template<typename Model = AbstractModel>
-auto trace_VLE_isobar_binary(const Model& model, double p, double T0, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<PVLEOptions>& options = std::nullopt)
+auto trace_VLE_isobar_binary_columns(const Model& model, double p, double T0, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<PVLEOptions>& options = std::nullopt)
 {
     // Get the options, or the default values if not provided
     PVLEOptions opt = options.value_or(PVLEOptions{});
@@ -1047,7 +1093,7 @@ auto trace_VLE_isobar_binary(const Model& model, double p, double T0, const Eige
     auto norm = [](const auto& v) { return (v * v).sum(); };
 
     // Define datatypes and functions for tracing tools
-    auto JSONdata = nlohmann::json::array();
+    VLETraceColumnsBuilder builder;
 
     // Typedefs for the types
     using namespace boost::numeric::odeint;
@@ -1147,26 +1193,12 @@ auto trace_VLE_isobar_binary(const Model& model, double p, double T0, const Eige
                 std::cout << "Something bad happened; couldn't calculate xprime in store_point" << std::endl;
             }
 
-            // Store the data in a JSON structure
-            nlohmann::json point = {
-                {"t", t},
-                {"dt", dt},
-                {"T / K", T},
-                {"pL / Pa", pL},
-                {"pV / Pa", pV},
-                {"c", c},
-                {"rhoL / mol/m^3", rhovecL},
-                {"rhoV / mol/m^3", rhovecV},
-                {"xL_0 / mole frac.", rhovecL[0] / rhovecL.sum()},
-                {"xV_0 / mole frac.", rhovecV[0] / rhovecV.sum()},
-                {"drho/dt", last_drhodt}
-            };
+            // Store the data in the columns
+            builder.push_back(t, dt, T, pL, pV, c, rhovecL, rhovecV, last_drhodt);
             if (opt.calc_criticality) {
-                point["crit. conditions L"] = model.get_criticality_conditions(T, rhovecL);
-                point["crit. conditions V"] = model.get_criticality_conditions(T, rhovecV);
+                builder.critL.push_back(model.get_criticality_conditions(T, rhovecL));
+                builder.critV.push_back(model.get_criticality_conditions(T, rhovecV));
             }
-            JSONdata.push_back(point);
-            //std::cout << JSONdata.back().dump() << std::endl;
         };
         if (istep == 0 && retry_count == 0) {
             store_point();
@@ -1255,12 +1287,23 @@ auto trace_VLE_isobar_binary(const Model& model, double p, double T0, const Eige
         store_point(); // last_drhodt is updated;
 
     }
-    return JSONdata;
+    return builder.get(termination_reason);
+}
+
+/***
+* \brief Trace an isobar with parametric tracing
+*/
+template<typename Model = AbstractModel>
+auto trace_VLE_isobar_binary(const Model& model, double p, double T0, const Eigen::ArrayXd& rhovecL0, const Eigen::ArrayXd& rhovecV0, const std::optional<PVLEOptions>& options = std::nullopt)
+{
+    return VLE_trace_to_JSON(trace_VLE_isobar_binary_columns(model, p, T0, rhovecL0, rhovecV0, options));
 }
 
 #define VLE_FUNCTIONS_TO_WRAP \
     X(trace_VLE_isobar_binary) \
     X(trace_VLE_isotherm_binary) \
+    X(trace_VLE_isobar_binary_columns) \
+    X(trace_VLE_isotherm_binary_columns) \
     X(get_dpsat_dTsat_isopleth) \
     X(get_drhovecdT_xsat) \
     X(get_drhovecdT_psat) \
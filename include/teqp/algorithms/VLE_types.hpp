@@ -35,6 +35,27 @@ struct MixVLETpFlags {
     int maxiter = 10;
 };
 
+/**
+ The columns of a binary VLE trace (along an isotherm or an isobar), with one entry (or row) per point of the trace
+
+ The arrays are contiguous so they can be handed to other languages (e.g., as NumPy arrays) without copying; the JSON format
+ is obtained from these columns with VLE_trace_to_JSON
+ */
+struct VLETraceColumns {
+    Eigen::ArrayXd t, ///< The tracing parameter
+    dt, ///< The step size in the tracing parameter
+    T, ///< Temperature, K
+    pL, ///< Pressure of the liquid phase, Pa
+    pV, ///< Pressure of the vapor phase, Pa
+    c; ///< The direction of tracing, either 1 or -1
+    Eigen::ArrayXXd rhoL, ///< Molar concentrations of the liquid phase, one row per point, mol/m^3
+    rhoV, ///< Molar concentrations of the vapor phase, one row per point, mol/m^3
+    drhodt, ///< The derivatives of the integration variables w.r.t. the tracing parameter, one row per point
+    critL, ///< The criticality conditions of the liquid phase, only populated if calc_criticality is true
+    critV; ///< The criticality conditions of the vapor phase, only populated if calc_criticality is true
+    std::string termination_reason;
+};
+
 enum class VLE_return_code { unset, xtol_satisfied, functol_satisfied, maxfev_met, maxiter_met, notfinite_step };
 
 struct MixVLEReturn {
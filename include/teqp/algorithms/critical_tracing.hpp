@@ -9,6 +9,8 @@
 #include "teqp/algorithms/rootfinding.hpp"
 #include "teqp/algorithms/critical_pure.hpp"
 #include "teqp/algorithms/critical_tracing_types.hpp"
+#include "teqp/algorithms/trace_columns.hpp"
+#include "teqp/algorithms/critical_tracing_writers.hpp"
 #include "teqp/exceptions.hpp"
 
 // Imports from boost
@@ -388,9 +390,47 @@ struct CriticalTracing {
         return x;
     }
 
-    static auto trace_critical_arclength_binary(const AbstractModel& model, const Scalar& T0, const VecType& rhovec0, const std::optional<std::string>& filename_ = std::nullopt, const std::optional<TCABOptions> &options_ = std::nullopt) -> nlohmann::json {
-        std::string filename = filename_.value_or("");
+    /**
+     * \brief Convert the columns of a critical curve trace into the JSON format, an array with one object per point
+     */
+    static auto critical_trace_to_JSON(const CriticalTraceColumns& cols) -> nlohmann::json {
+        auto JSONdata = nlohmann::json::array();
+        for (Eigen::Index i = 0; i < cols.T.size(); ++i) {
+            nlohmann::json point = {
+                {"t", cols.t[i]},
+                {"T / K", cols.T[i]},
+                {"rho0 / mol/m^3", cols.rhovec(i, 0)},
+                {"rho1 / mol/m^3", cols.rhovec(i, 1)},
+                {"c", cols.c[i]},
+                {"s^+", cols.splus[i]},
+                {"p / Pa", cols.p[i]},
+                {"dT/dt", cols.dTdt[i]},
+                {"drho0/dt", cols.drhovecdt(i, 0)},
+                {"drho1/dt", cols.drhovecdt(i, 1)},
+                {"lambda1", cols.lambda1[i]},
+                {"dirderiv(lambda1)/dalpha", cols.dirderiv_lambda1[i]},
+            };
+            if (cols.locally_stable.size() > 0) {
+                point["locally stable"] = static_cast<bool>(cols.locally_stable[i]);
+            }
+            JSONdata.push_back(point);
+        }
+        return JSONdata;
+    }
+
+    /**
+     * \brief Trace the critical curve of a binary mixture, passing each point to the sink as soon as it is generated
+     *
+     * The tracer itself only keeps the state of the integrator, so the memory use does not grow with the length of the trace.
+     * Whatever is done with the points (collecting them, writing them to file, ...) is up to the sink
+     *
+     * \returns The number of points passed to the sink
+     */
+    static auto trace_critical_arclength_binary_sink(const AbstractModel& model, const Scalar& T0, const VecType& rhovec0, const CriticalTraceSink& sink, const std::optional<TCABOptions> &options_ = std::nullopt) -> std::size_t {
         TCABOptions options = options_.value_or(TCABOptions{});
+        if (!sink) {
+            throw teqp::InvalidArgument("The sink for the critical trace is empty");
+        }
 
         VecType last_drhodt;
 
@@ -404,8 +444,7 @@ struct CriticalTracing {
         auto dot = [](const auto& v1, const auto& v2) { return (v1 * v2).sum(); };
         auto norm = [](const auto& v) { return sqrt((v * v).sum()); };
 
-        auto JSONdata = nlohmann::json::array();
-        std::ofstream ofs = (filename.empty()) ? std::ofstream() : std::ofstream(filename);
+        std::size_t Npoints = 0;
         
         double c = options.init_c; 
 
@@ -480,43 +519,20 @@ struct CriticalTracing {
             auto dxdt = x0;
             xprime(x0, dxdt, -1.0);
 
-            // Store the data in a JSON structure
-            nlohmann::json point = {
-                {"t", t},
-                {"T / K", T},
-                {"rho0 / mol/m^3", static_cast<double>(rhovec[0])},
-                {"rho1 / mol/m^3", static_cast<double>(rhovec[1])},
-                {"c", c},
-                {"s^+", splus},
-                {"p / Pa", p},
-                {"dT/dt", dxdt[0]},
-                {"drho0/dt", dxdt[1]},
-                {"drho1/dt", dxdt[2]},
-                {"lambda1", conditions[0]},
-                {"dirderiv(lambda1)/dalpha", conditions[1]},
-            };
+            // Hand the point to the sink
+            CriticalTracePoint pt;
+            pt.t = t; pt.dt = dt; pt.T = T; pt.c = c; pt.splus = splus; pt.p = p;
+            pt.dTdt = dxdt[0]; pt.lambda1 = conditions[0]; pt.dirderiv_lambda1 = conditions[1];
+            pt.rhovec = rhovec;
+            pt.drhovecdt = extract_drhodt(dxdt);
             if (options.calc_stability) {
-                point["locally stable"] = is_locally_stable(model, T, rhovec, options.stability_rel_drho);
-            }
-            JSONdata.push_back(point);
-        };
-
-        // Line writer
-        auto write_line = [&]() {
-            std::stringstream out;
-            auto rhotot = rhovec.sum();
-            double z0 = rhovec[0] / rhotot;
-            auto conditions = get_criticality_conditions(model, T, rhovec);
-            out << z0 << "," << rhovec[0] << "," << rhovec[1] << "," << T << "," << rhotot * model.R(rhovec / rhovec.sum()) * T + model.get_pr(T, rhovec) << "," << c << "," << dt << "," << conditions(0) << "," << conditions(1) << std::endl;
-            std::string sout(out.str());
-            std::cout << sout;
-            if (ofs.is_open()) {
-                ofs << sout;
+                pt.locally_stable = is_locally_stable(model, T, rhovec, options.stability_rel_drho);
             }
+            sink(pt);
+            Npoints++;
         };
         
         int counter_T_converged = 0, retry_count = 0;
-        ofs << "z0 / mole frac.,rho0 / mol/m^3,rho1 / mol/m^3,T / K,p / Pa,c,dt,condition(1),condition(2)" << std::endl;
         
         // Determine the initial direction of integration
         {
@@ -528,9 +544,6 @@ struct CriticalTracing {
             }
         }
         //store_drhodt(x0);
-        if (!filename.empty()) {
-            write_line();
-        }
 
         for (auto iter = 0; iter < options.max_step_count; ++iter) {
             
@@ -538,6 +551,7 @@ struct CriticalTracing {
             auto dxdt_start_step = get_dxdt(x0);
             auto x_start_step = x0;
 
+            // The initial state is the first point; it is also the first row of the CSV output of the tracers taking a filename
             if (iter == 0 && retry_count == 0) { 
                 store_point(); }
             
@@ -686,7 +700,6 @@ struct CriticalTracing {
                 break;
             }
 
-            if (!filename.empty()) { write_line(); }
             store_point();
 
             if (counter_T_converged > options.small_T_count) {
@@ -729,12 +742,55 @@ struct CriticalTracing {
                 rhovec[1 - ipure] = 0;
 
                 // And store the polished values
-                if (!filename.empty()) { write_line(); }
                 store_point();
             }
         }
-        //auto N = JSONdata.size();
-        return JSONdata;
+        return Npoints;
+    }
+    
+    /**
+     * \brief Trace the critical curve of a binary mixture, returning the trace in columnar form
+     *
+     * \param filename If provided and not empty, the points are also written in CSV format to this file by a CriticalTraceCSVWriter. As before the
+     * introduction of the sink, the file has one row per point of the trace, starting with the initial state; the rows are no longer echoed to stdout
+     */
+    static auto trace_critical_arclength_binary_columns(const AbstractModel& model, const Scalar& T0, const VecType& rhovec0, const std::optional<std::string>& filename_ = std::nullopt, const std::optional<TCABOptions> &options_ = std::nullopt) -> CriticalTraceColumns {
+        std::vector<double> t_, T_, c_, splus_, p_, dTdt_, lambda1_, dirderiv_lambda1_;
+        std::vector<bool> locally_stable_;
+        internal::RowAccumulator rhovec_, drhovecdt_;
+        
+        std::optional<CriticalTraceCSVWriter> writer;
+        if (filename_ && !filename_.value().empty()) {
+            writer.emplace(filename_.value());
+        }
+        auto collect = [&](const CriticalTracePoint& pt) {
+            t_.push_back(pt.t); T_.push_back(pt.T); c_.push_back(pt.c); splus_.push_back(pt.splus); p_.push_back(pt.p);
+            dTdt_.push_back(pt.dTdt); lambda1_.push_back(pt.lambda1); dirderiv_lambda1_.push_back(pt.dirderiv_lambda1);
+            rhovec_.push_back(pt.rhovec);
+            drhovecdt_.push_back(pt.drhovecdt);
+            if (pt.locally_stable) {
+                locally_stable_.push_back(pt.locally_stable.value());
+            }
+            if (writer) {
+                (*writer)(pt);
+            }
+        };
+        trace_critical_arclength_binary_sink(model, T0, rhovec0, collect, options_);
+        
+        using internal::to_column;
+        CriticalTraceColumns cols{to_column(t_), to_column(T_), to_column(c_), to_column(splus_), to_column(p_), to_column(dTdt_),
+            to_column(lambda1_), to_column(dirderiv_lambda1_), rhovec_.get(), drhovecdt_.get(), Eigen::ArrayX<bool>(locally_stable_.size())};
+        for (auto i = 0U; i < locally_stable_.size(); ++i) {
+            cols.locally_stable[i] = locally_stable_[i];
+        }
+        return cols;
+    }
+    
+    /**
+     * \brief Trace the critical curve of a binary mixture, returning the trace as JSON with one object per point
+     */
+    static auto trace_critical_arclength_binary(const AbstractModel& model, const Scalar& T0, const VecType& rhovec0, const std::optional<std::string>& filename_ = std::nullopt, const std::optional<TCABOptions> &options_ = std::nullopt) -> nlohmann::json {
+        return critical_trace_to_JSON(trace_critical_arclength_binary_columns(model, T0, rhovec0, filename_, options_));
     }
 
     /**
@@ -753,6 +809,8 @@ struct CriticalTracing {
 #define CRIT_FUNCTIONS_TO_WRAP \
     X(get_dp_dT_crit) \
     X(trace_critical_arclength_binary) \
+    X(trace_critical_arclength_binary_columns) \
+    X(trace_critical_arclength_binary_sink) \
     X(critical_polish_fixedmolefrac)  \
     X(get_drhovec_dT_crit) \
     X(get_derivs) \
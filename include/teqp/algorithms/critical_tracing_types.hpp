@@ -1,5 +1,8 @@
 # pragma once
 
+#include <functional>
+#include <optional>
+
 namespace teqp {
 
 struct TCABOptions {
@@ -24,6 +27,47 @@ struct TCABOptions {
     bool pure_endpoint_polish = false; ///< If true, if the last step crossed into negative concentrations, try to interpolate to find the pure fluid endpoint hiding in the data
 };
 
+/**
+ The columns of a critical curve trace, with one entry (or row) per point of the trace
+
+ The arrays are contiguous so they can be handed to other languages (e.g., as NumPy arrays) without copying; the JSON format
+ is obtained from these columns with CriticalTracing::critical_trace_to_JSON
+ */
+struct CriticalTraceColumns {
+    Eigen::ArrayXd t, ///< The tracing parameter
+    T, ///< Temperature, K
+    c, ///< The direction of tracing, either 1 or -1
+    splus, ///< The reduced residual entropy \f$s^+\f$
+    p, ///< Pressure, Pa
+    dTdt, ///< Derivative of temperature w.r.t. the tracing parameter
+    lambda1, ///< The first criticality condition
+    dirderiv_lambda1; ///< The second criticality condition, the directional derivative of lambda1
+    Eigen::ArrayXXd rhovec, ///< The molar concentrations, one row per point, mol/m^3
+    drhovecdt; ///< Derivatives of the molar concentrations w.r.t. the tracing parameter, one row per point
+    Eigen::ArrayX<bool> locally_stable; ///< Local stability, only populated if calc_stability is true
+};
+
+/**
+ One point along a critical curve trace, as passed to a CriticalTraceSink
+ */
+struct CriticalTracePoint {
+    double t = -1, ///< The tracing parameter
+    dt = -1, ///< The current step size in the tracing parameter
+    T = -1, ///< Temperature, K
+    c = 0, ///< The direction of tracing, either 1 or -1
+    splus = -1, ///< The reduced residual entropy \f$s^+\f$
+    p = -1, ///< Pressure, Pa
+    dTdt = 0, ///< Derivative of temperature w.r.t. the tracing parameter
+    lambda1 = 0, ///< The first criticality condition
+    dirderiv_lambda1 = 0; ///< The second criticality condition, the directional derivative of lambda1
+    Eigen::ArrayXd rhovec, ///< The molar concentrations, mol/m^3
+    drhovecdt; ///< Derivatives of the molar concentrations w.r.t. the tracing parameter
+    std::optional<bool> locally_stable; ///< Local stability, only populated if calc_stability is true
+};
+
+/// The callback that receives each point of a critical curve trace as it is generated
+using CriticalTraceSink = std::function<void(const CriticalTracePoint&)>;
+
 struct EigenData {
     Eigen::ArrayXd v0, v1, eigenvalues;
     Eigen::MatrixXd eigenvectorscols;
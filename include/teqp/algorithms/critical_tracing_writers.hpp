@@ -0,0 +1,105 @@
+#pragma once
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "teqp/algorithms/critical_tracing_types.hpp"
+#include "teqp/exceptions.hpp"
+
+namespace teqp {
+
+/**
+ A sink for critical curve traces that writes the points in CSV format to a file on a background thread, so that
+ the formatting and the file I/O do not sit in the tracing loop.
+
+ The points are handed over through a bounded queue; if the writer falls behind by more than `capacity` points, the
+ tracer blocks until there is room again, so the memory use stays bounded no matter how long the trace is.
+ All queued points are written, and the file is closed, when the writer is destroyed.
+
+ Usage (the writer is not copyable, so wrap it in std::ref to pass it as a CriticalTraceSink):
+ \code
+ CriticalTraceCSVWriter writer("trace.csv");
+ CriticalTracing<decltype(model)>::trace_critical_arclength_binary_sink(model, T0, rhovec0, std::ref(writer));
+ \endcode
+ */
+class CriticalTraceCSVWriter {
+private:
+    std::ofstream ofs;
+    const std::size_t capacity;
+    std::vector<CriticalTracePoint> queue;
+    std::mutex mtx;
+    std::condition_variable cv_notempty, cv_notfull;
+    bool done = false;
+    std::thread worker;
+
+    static void write_line(std::ostream& out, const CriticalTracePoint& pt) {
+        auto rhotot = pt.rhovec.sum();
+        out << pt.rhovec[0] / rhotot << "," << pt.rhovec[0] << "," << pt.rhovec[1] << "," << pt.T << "," << pt.p << "," << pt.c << "," << pt.dt << "," << pt.lambda1 << "," << pt.dirderiv_lambda1 << "\n";
+    }
+    void run() {
+        std::vector<CriticalTracePoint> batch;
+        std::stringstream out;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_notempty.wait(lock, [this] { return done || !queue.empty(); });
+                if (queue.empty() && done) {
+                    break;
+                }
+                std::swap(batch, queue);
+            }
+            cv_notfull.notify_all();
+            // Formatting and I/O are done without holding the lock
+            out.str("");
+            for (const auto& pt : batch) {
+                write_line(out, pt);
+            }
+            ofs << out.str();
+            batch.clear();
+        }
+        ofs.flush();
+    }
+public:
+    /**
+     \param filename The path to the CSV file, which is overwritten
+     \param capacity The maximum number of points waiting to be written
+     */
+    CriticalTraceCSVWriter(const std::string& filename, std::size_t capacity = 1024) : ofs(filename), capacity(capacity) {
+        if (!ofs.is_open()) {
+            throw teqp::InvalidArgument("Unable to open the file " + filename + " for writing");
+        }
+        if (capacity == 0) {
+            throw teqp::InvalidArgument("The capacity of the queue must be at least 1");
+        }
+        ofs << "z0 / mole frac.,rho0 / mol/m^3,rho1 / mol/m^3,T / K,p / Pa,c,dt,condition(1),condition(2)" << std::endl;
+        queue.reserve(capacity);
+        worker = std::thread(&CriticalTraceCSVWriter::run, this);
+    }
+    CriticalTraceCSVWriter(const CriticalTraceCSVWriter&) = delete;
+    CriticalTraceCSVWriter& operator=(const CriticalTraceCSVWriter&) = delete;
+    ~CriticalTraceCSVWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            done = true;
+        }
+        cv_notempty.notify_one();
+        worker.join();
+    }
+
+    /// Queue a point for writing; blocks if the queue is full
+    void operator()(const CriticalTracePoint& pt) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_notfull.wait(lock, [this] { return queue.size() < capacity; });
+            queue.push_back(pt);
+        }
+        cv_notempty.notify_one();
+    }
+};
+
+}
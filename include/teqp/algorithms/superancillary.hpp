@@ -0,0 +1,317 @@
+#pragma once
+
+/**
+ Superancillary equations for the vapor-liquid equilibrium of a pure fluid, generated from any model
+
+ The saturation pressure and the orthobaric densities are fit with piecewise Chebyshev expansions in
+ temperature, adaptively refined until the expansions reach the requested tolerance, in the same
+ form as the superancillary equations of the cubic EOS in CubicSuperAncillary
+ */
+
+#include <cmath>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include <Eigen/Dense>
+#include "nlohmann/json.hpp"
+
+#include "teqp/exceptions.hpp"
+#include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/batch.hpp"
+#include "teqp/algorithms/critical_pure.hpp"
+#include "teqp/algorithms/VLE_pure.hpp"
+#include "teqp/models/cubicsuperancillary.hpp"
+
+namespace teqp {
+
+/**
+ The coefficients of the Chebyshev expansion of degree N interpolating the values f_k of a function at the
+ Chebyshev-Lobatto nodes \f$x_k = \cos(\pi k/N)\f$, \f$k=0,\ldots,N\f$, of the interval [-1, 1], in the form
+ evaluated by CubicSuperAncillary::Chebyshev
+ */
+inline std::vector<double> get_Chebyshev_coefficients(const Eigen::ArrayXd& f){
+    const auto N = static_cast<int>(f.size()) - 1;
+    std::vector<double> c(N + 1);
+    for (auto j = 0; j <= N; ++j){
+        double s = 0;
+        for (auto k = 0; k <= N; ++k){
+            double w = (k == 0 || k == N) ? 0.5 : 1.0;
+            s += w*f[k]*cos(static_cast<double>(EIGEN_PI)*j*k/N);
+        }
+        c[j] = ((j == 0 || j == N) ? 1.0 : 2.0)*s/N;
+    }
+    return c;
+}
+
+struct ChebyshevFitOptions {
+    int degree = 16; ///< The degree of each expansion
+    double tol = 1e-12; ///< The magnitude of the last two coefficients relative to the largest one, below which an expansion is accepted
+    double noise_factor = 100; ///< An expansion within noise_factor*tol is also accepted when it is no better than the one of the parent interval, as the function values are then noise-limited
+    double min_width = 1e-10; ///< The width of an interval, relative to the full range, below which the refinement is abandoned
+    int Ninitial = 8; ///< The number of equal intervals with which the refinement starts; they are refined independently of each other
+    std::optional<int> Nthreads; ///< The number of threads over which the initial intervals are split
+};
+
+/**
+ \brief Fit piecewise Chebyshev expansions to M functions of one variable that share their intervals
+
+ \param func A callable returning the M values of the functions at x as an Eigen::ArrayXd
+ \param xmin The lower limit of the range to be fit
+ \param xmax The upper limit of the range to be fit
+ \param opt The options of the fit
+
+ An interval is bisected until the expansions of all the functions satisfy the tolerance. Functions obtained by iteration
+ (e.g., close to a critical point) can have a noise floor above the tolerance; there, bisection no longer reduces the tail
+ of the expansions, so the expansions are accepted if they are within noise_factor of the tolerance. The initial intervals are
+ refined in parallel, so func must be safe to call from several threads at once. The expansions of each function are
+ returned in increasing order of x
+ */
+template<typename Func>
+auto fit_adaptive_Chebyshev(const Func& func, const double xmin, const double xmax, const ChebyshevFitOptions& opt = {}){
+    using Chebyshev = CubicSuperAncillary::Chebyshev;
+    if (!(xmax > xmin)){
+        throw teqp::InvalidArgument("xmax (" + std::to_string(xmax) + ") must be greater than xmin (" + std::to_string(xmin) + ")");
+    }
+    if (opt.degree < 2){
+        throw teqp::InvalidArgument("The degree of the expansions must be at least 2");
+    }
+    if (opt.Ninitial < 1){
+        throw teqp::InvalidArgument("Ninitial must be at least 1");
+    }
+    const int N = opt.degree;
+    Eigen::ArrayXd nodes(N + 1);
+    for (auto k = 0; k <= N; ++k){
+        nodes[k] = cos(static_cast<double>(EIGEN_PI)*k/N);
+    }
+
+    // Refine one initial interval, the accepted expansions are stored in order of increasing x
+    auto refine = [&](double a0, double b0){
+        std::vector<std::vector<Chebyshev>> accepted;
+        // The intervals to be fit, and the largest relative tail of the expansions of their parent
+        std::vector<std::tuple<double, double, double>> stack = {{a0, b0, std::numeric_limits<double>::infinity()}};
+        while (!stack.empty()){
+            auto [a, b, parent_tail] = stack.back(); stack.pop_back();
+            std::vector<Eigen::ArrayXd> f;
+            for (auto k = 0; k <= N; ++k){
+                Eigen::ArrayXd vals = func((a + b)/2 + (b - a)/2*nodes[k]);
+                if (f.empty()){
+                    f.resize(vals.size(), Eigen::ArrayXd(N + 1));
+                }
+                for (auto m = 0; m < vals.size(); ++m){
+                    f[m][k] = vals[m];
+                }
+            }
+            std::vector<Chebyshev> exps;
+            double tail = 0;
+            for (const auto& fm : f){
+                auto c = get_Chebyshev_coefficients(fm);
+                double cmax = 0;
+                for (auto cc : c){ cmax = std::max(cmax, std::abs(cc)); }
+                tail = std::max(tail, std::max(std::abs(c[N - 1]), std::abs(c[N]))/cmax);
+                exps.push_back(Chebyshev{c, a, b});
+            }
+            if (tail <= opt.tol || (tail <= opt.noise_factor*opt.tol && tail > 0.5*parent_tail)){
+                accepted.push_back(exps);
+            }
+            else if ((b - a) < opt.min_width*(xmax - xmin)){
+                throw teqp::IterationFailure("Could not reach the tolerance of the Chebyshev expansions in [" + std::to_string(a) + ", " + std::to_string(b) + "]");
+            }
+            else{
+                // The left half is on the top of the stack so it is accepted first
+                double mid = (a + b)/2;
+                stack.emplace_back(mid, b, tail);
+                stack.emplace_back(a, mid, tail);
+            }
+        }
+        return accepted;
+    };
+
+    std::vector<std::vector<std::vector<Chebyshev>>> pieces(opt.Ninitial);
+    cppinterface::parallel_for_chunks(opt.Ninitial, opt.Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+        for (auto i = istart; i < iend; ++i){
+            double a = xmin + (xmax - xmin)*i/opt.Ninitial;
+            double b = (i + 1 == opt.Ninitial) ? xmax : xmin + (xmax - xmin)*(i + 1)/opt.Ninitial;
+            pieces[i] = refine(a, b);
+        }
+    });
+
+    // Reorganize by function
+    std::vector<std::vector<Chebyshev>> out;
+    for (const auto& piece : pieces){
+        for (const auto& exps : piece){
+            if (out.empty()){
+                out.resize(exps.size());
+            }
+            for (auto m = 0U; m < exps.size(); ++m){
+                out[m].push_back(exps[m]);
+            }
+        }
+    }
+    return out;
+}
+
+/**
+ The superancillary equations of a pure fluid, valid from Tmin to Tmax < Tc. They are built with build_pure_superancillary,
+ and can be saved to and loaded from JSON with to_json and the constructor taking JSON
+ */
+struct PureSuperAncillary {
+    const double Tc, rhoc;
+    const CubicSuperAncillary::SuperAncillary p, rhoL, rhoV;
+    const double Tmin, Tmax;
+
+private:
+    static std::vector<CubicSuperAncillary::Chebyshev> exps_from_json(const nlohmann::json& j){
+        std::vector<CubicSuperAncillary::Chebyshev> exps;
+        for (const auto& e : j){
+            exps.push_back(CubicSuperAncillary::Chebyshev{e.at("coef").get<std::vector<double>>(), e.at("xmin").get<double>(), e.at("xmax").get<double>()});
+        }
+        if (exps.empty()){
+            throw teqp::InvalidArgument("A superancillary requires at least one expansion");
+        }
+        return exps;
+    }
+    static nlohmann::json exps_to_json(const CubicSuperAncillary::SuperAncillary& sa){
+        nlohmann::json j = nlohmann::json::array();
+        for (const auto& e : sa.exps){
+            j.push_back({{"coef", e.coeff}, {"xmin", e.xmin}, {"xmax", e.xmax}});
+        }
+        return j;
+    }
+
+public:
+    PureSuperAncillary(double Tc, double rhoc, std::vector<CubicSuperAncillary::Chebyshev> p, std::vector<CubicSuperAncillary::Chebyshev> rhoL, std::vector<CubicSuperAncillary::Chebyshev> rhoV)
+    : Tc(Tc), rhoc(rhoc), p(std::move(p)), rhoL(std::move(rhoL)), rhoV(std::move(rhoV)), Tmin(this->p.exps.front().xmin), Tmax(this->p.exps.back().xmax) {}
+
+    PureSuperAncillary(const nlohmann::json& j)
+    : PureSuperAncillary(j.at("Tc"), j.at("rhoc"), exps_from_json(j.at("p")), exps_from_json(j.at("rhoL")), exps_from_json(j.at("rhoV"))) {}
+
+    /// The saturation pressure in Pa, and the saturated liquid and vapor densities in mol/m^3
+    Eigen::Array<double, 3, 1> operator()(double T) const {
+        if (!(T >= Tmin && T <= Tmax)){
+            throw teqp::InvalidArgument("T (" + std::to_string(T) + ") is not in the range [" + std::to_string(Tmin) + ", " + std::to_string(Tmax) + "] of the superancillary equations");
+        }
+        return (Eigen::Array<double, 3, 1>() << p.y(T), rhoL.y(T), rhoV.y(T)).finished();
+    }
+
+    /// The saturation pressure and densities of n temperatures, evaluated in batches with SuperAncillary::y_many
+    void eval_many(const double* T, double* psat, double* rhoLsat, double* rhoVsat, std::size_t n) const {
+        for (auto i = 0U; i < n; ++i){
+            if (!(T[i] >= Tmin && T[i] <= Tmax)){
+                throw teqp::InvalidArgument("T (" + std::to_string(T[i]) + ") is not in the range [" + std::to_string(Tmin) + ", " + std::to_string(Tmax) + "] of the superancillary equations");
+            }
+        }
+        p.y_many(T, psat, n);
+        rhoL.y_many(T, rhoLsat, n);
+        rhoV.y_many(T, rhoVsat, n);
+    }
+
+    nlohmann::json to_json() const {
+        return {{"Tc", Tc}, {"rhoc", rhoc}, {"p", exps_to_json(p)}, {"rhoL", exps_to_json(rhoL)}, {"rhoV", exps_to_json(rhoV)}};
+    }
+};
+
+/**
+ \brief Build the superancillary equations of a pure fluid, or of one component of a mixture model
+
+ The JSON data structure defines the variables that need to be specified:
+ * Tmin: the lowest temperature, normally the triple-point temperature, K
+ * Tcguess, rhocguess: the guess values for the critical point
+ * pure_spec (optional): the alternative_pure_index and alternative_length of the component, as in pure_trace_VLE
+ * Tred_max (optional): the upper limit of the superancillaries, relative to the critical temperature (default 0.99999)
+ * Nwalk (optional): the number of points in the walk that provides the initial guesses (default 200)
+ * NVLE (optional): the maximum number of iterations of each VLE calculation (default 20)
+ * degree, tol, noise_factor, min_width, Ninitial, Nthreads (optional): the fields of ChebyshevFitOptions
+
+ In the current implementation, there are a few steps:
+ 1. Solve for the critical point with solve_pure_critical
+ 2. Walk from Tred_max*Tc down to Tmin with equal steps in \f$\sqrt{1-T/T_c}\f$ (in which the densities are nearly linear close to
+ the critical point), starting from extrapolate_from_critical and predicting each step from the previous two
+ 3. Fit the expansions with fit_adaptive_Chebyshev; each VLE calculation is started from the walk, interpolated linearly in
+ \f$\sqrt{1-T/T_c}\f$ for \f$\rho_L\f$ and \f$\ln\rho_V\f$, and polished with pure_VLE_T
+ */
+inline auto build_pure_superancillary(const teqp::cppinterface::AbstractModel& model, const nlohmann::json& spec){
+    nlohmann::json pure_spec;
+    Eigen::ArrayXd z{Eigen::ArrayXd::Ones(1,1)};
+    if (spec.contains("pure_spec")){
+        pure_spec = spec.at("pure_spec");
+        z = Eigen::ArrayXd(pure_spec.at("alternative_length").get<int>()); z.setZero();
+        z(pure_spec.at("alternative_pure_index").get<int>()) = 1;
+    }
+    double Tc, rhoc; // Not a structured binding, as they are captured by the lambdas below
+    std::tie(Tc, rhoc) = solve_pure_critical(model, spec.at("Tcguess").get<double>(), spec.at("rhocguess").get<double>(), pure_spec);
+    const double Tmin = spec.at("Tmin");
+    const double Tmax = spec.value("Tred_max", 0.99999)*Tc;
+    if (!(Tmin > 0 && Tmin < Tmax)){
+        throw teqp::InvalidArgument("Tmin (" + std::to_string(Tmin) + ") must be in (0, " + std::to_string(Tmax) + ")");
+    }
+    const int Nwalk = spec.value("Nwalk", 200), NVLE = spec.value("NVLE", 20);
+    if (Nwalk < 2){
+        throw teqp::InvalidArgument("Nwalk must be at least 2");
+    }
+    const double R = model.get_R(z);
+
+    // Polish the VLE at T, and check that it converged to a non-trivial solution
+    auto VLE = [&](double T, double rhoLguess, double rhoVguess){
+        auto rhoLV = pure_VLE_T(model, T, rhoLguess, rhoVguess, NVLE, z);
+        double pL = rhoLV[0]*R*T*(1.0 + model.get_Ar01(T, rhoLV[0], z));
+        double pV = rhoLV[1]*R*T*(1.0 + model.get_Ar01(T, rhoLV[1], z));
+        if (!(std::isfinite(pV) && rhoLV[1] > 0 && rhoLV[0] > rhoLV[1]*(1 + 1e-10) && std::abs(pL/pV - 1) < 1e-8)){
+            throw teqp::IterationFailure("The VLE at T = " + std::to_string(T) + " K did not converge; try increasing Nwalk or decreasing Tred_max");
+        }
+        return (Eigen::ArrayXd(3) << pV, rhoLV[0], rhoLV[1]).finished();
+    };
+
+    // The walk, from the highest to the lowest temperature
+    const double smin = sqrt(1 - Tmax/Tc), smax = sqrt(1 - Tmin/Tc);
+    Eigen::ArrayXd s = Eigen::ArrayXd::LinSpaced(Nwalk, smin, smax), rhoLwalk(Nwalk), lnrhoVwalk(Nwalk);
+    for (auto i = 0; i < Nwalk; ++i){
+        double T = Tc*(1 - s[i]*s[i]), rhoLguess, lnrhoVguess;
+        if (i == 0){
+            auto rhoLV = extrapolate_from_critical(model, Tc, rhoc, T, z);
+            rhoLguess = rhoLV[0]; lnrhoVguess = log(rhoLV[1]);
+        }
+        else if (i == 1){
+            rhoLguess = rhoLwalk[0]; lnrhoVguess = lnrhoVwalk[0];
+        }
+        else{
+            double w = (s[i] - s[i-1])/(s[i-1] - s[i-2]);
+            rhoLguess = rhoLwalk[i-1] + w*(rhoLwalk[i-1] - rhoLwalk[i-2]);
+            lnrhoVguess = lnrhoVwalk[i-1] + w*(lnrhoVwalk[i-1] - lnrhoVwalk[i-2]);
+        }
+        auto sat = VLE(T, rhoLguess, exp(lnrhoVguess));
+        rhoLwalk[i] = sat[1]; lnrhoVwalk[i] = log(sat[2]);
+    }
+
+    auto func = [&](double T){
+        double si = sqrt(std::max(1 - T/Tc, 0.0));
+        auto i = std::clamp<Eigen::Index>(std::upper_bound(s.begin(), s.end(), si) - s.begin(), 1, Nwalk - 1);
+        double w = (si - s[i-1])/(s[i] - s[i-1]);
+        return VLE(T, rhoLwalk[i-1] + w*(rhoLwalk[i] - rhoLwalk[i-1]), exp(lnrhoVwalk[i-1] + w*(lnrhoVwalk[i] - lnrhoVwalk[i-1])));
+    };
+    ChebyshevFitOptions opt;
+    opt.degree = spec.value("degree", opt.degree);
+    opt.tol = spec.value("tol", opt.tol);
+    opt.noise_factor = spec.value("noise_factor", opt.noise_factor);
+    opt.min_width = spec.value("min_width", opt.min_width);
+    opt.Ninitial = spec.value("Ninitial", opt.Ninitial);
+    if (spec.contains("Nthreads")){
+        opt.Nthreads = spec.at("Nthreads").get<int>();
+    }
+    auto exps = fit_adaptive_Chebyshev(func, Tmin, Tmax, opt);
+    return PureSuperAncillary(Tc, rhoc, exps[0], exps[1], exps[2]);
+}
+
+#define X(f) template <typename TemplatedModel, typename ...Params, \
+typename = typename std::enable_if<is_not_AbstractModel<TemplatedModel>::value>::type> \
+inline auto f(const TemplatedModel& model, Params&&... params){ \
+    auto view = teqp::cppinterface::adapter::make_cview(model); \
+    const AbstractModel& am = *view.get(); \
+    return f(am, std::forward<Params>(params)...); \
+}
+X(build_pure_superancillary)
+#undef X
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "teqp/exceptions.hpp"
+
+namespace teqp {
+namespace internal {
+
+/**
+ Accumulate the rows of a table of fixed width in one contiguous buffer as a trace proceeds, and hand over the table
+ as an Eigen array (one row per point) at the end, so that the tracing loop neither resizes Eigen arrays nor builds JSON
+ */
+class RowAccumulator {
+private:
+    std::vector<double> buffer;
+    Eigen::Index width = -1;
+public:
+    template<typename Row>
+    void push_back(const Row& row) {
+        const auto N = static_cast<Eigen::Index>(row.size());
+        if (width < 0) {
+            width = N;
+        }
+        else if (N != width) {
+            throw teqp::InvalidArgument("Row length of " + std::to_string(N) + " does not match the width of " + std::to_string(width));
+        }
+        for (Eigen::Index i = 0; i < N; ++i) {
+            buffer.push_back(row[i]);
+        }
+    }
+    Eigen::Index rows() const { return (width > 0) ? static_cast<Eigen::Index>(buffer.size()) / width : 0; }
+    Eigen::ArrayXXd get() const {
+        if (width <= 0) {
+            return Eigen::ArrayXXd(0, 0);
+        }
+        return Eigen::Map<const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(buffer.data(), rows(), width);
+    }
+};
+
+/// Copy a buffer of values into an Eigen column
+inline Eigen::ArrayXd to_column(const std::vector<double>& v) {
+    return Eigen::Map<const Eigen::ArrayXd>(v.data(), static_cast<Eigen::Index>(v.size()));
+}
+
+}
+}
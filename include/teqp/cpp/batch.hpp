@@ -0,0 +1,91 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <exception>
+#include <optional>
+#include <algorithm>
+
+#include <Eigen/Dense>
+#include "teqp/exceptions.hpp"
+
+namespace teqp{
+namespace cppinterface{
+
+/**
+ Split the index range [0, N) into contiguous chunks and call func(istart, iend) for each chunk
+
+ \param N The number of items to be processed
+ \param Nthreads The number of threads to use. If not provided, or less than 2, all the work is carried out in the calling thread
+ \param func A callable with signature void(Eigen::Index istart, Eigen::Index iend)
+
+ If a worker throws, the first exception is rethrown in the calling thread once all the workers have been joined
+ */
+template<typename Func>
+void parallel_for_chunks(const Eigen::Index N, const std::optional<int>& Nthreads, const Func& func){
+    const Eigen::Index Nthr = std::min(static_cast<Eigen::Index>(Nthreads.value_or(1)), N);
+    if (Nthr < 2){
+        func(0, N);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(Nthr);
+    std::vector<std::thread> workers;
+    workers.reserve(Nthr);
+    const Eigen::Index chunk = N/Nthr, remainder = N % Nthr;
+    Eigen::Index istart = 0;
+    for (Eigen::Index k = 0; k < Nthr; ++k){
+        // The first remainder chunks take one extra item
+        Eigen::Index iend = istart + chunk + (k < remainder ? 1 : 0);
+        workers.emplace_back([&func, &errors, k, istart, iend](){
+            try{
+                func(istart, iend);
+            }
+            catch(...){
+                errors[k] = std::current_exception();
+            }
+        });
+        istart = iend;
+    }
+    for (auto& w : workers){ w.join(); }
+    for (auto& e : errors){
+        if (e){ std::rethrow_exception(e); }
+    }
+}
+
+/**
+ Call f(i, T[i], rho[i], molefrac_i) for each state in a batch of states
+
+ \param T The temperatures, one per state
+ \param rho The molar densities, one per state
+ \param molefracs The mole fractions; either one row per state, or a single row that is used for all states
+ \param Nthreads The number of threads over which the batch is split
+ \param f The callable with signature void(Eigen::Index i, double T, double rho, const Eigen::ArrayXd& molefrac)
+
+ The mole fraction buffer is allocated once per chunk and reused for each state in the chunk
+ */
+template<typename Func>
+void for_each_state(const Eigen::Ref<const Eigen::ArrayXd>& T, const Eigen::Ref<const Eigen::ArrayXd>& rho, const Eigen::Ref<const Eigen::ArrayXXd>& molefracs, const std::optional<int>& Nthreads, const Func& f){
+    const Eigen::Index N = T.size();
+    if (rho.size() != N){
+        throw teqp::InvalidArgument("Length of rho (" + std::to_string(rho.size()) + ") does not match length of T (" + std::to_string(N) + ")");
+    }
+    if (molefracs.rows() != N && molefracs.rows() != 1){
+        throw teqp::InvalidArgument("molefracs must have either one row per state or a single row");
+    }
+    if (N == 0){
+        return; // An empty batch, for which molefracs may have no rows to be read
+    }
+    parallel_for_chunks(N, Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+        Eigen::ArrayXd molefrac = molefracs.row(0).transpose();
+        const bool shared = (molefracs.rows() == 1);
+        for (auto i = istart; i < iend; ++i){
+            if (!shared){
+                molefrac = molefracs.row(i).transpose();
+            }
+            f(i, T[i], rho[i], molefrac);
+        }
+    });
+}
+
+}
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <list>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <unordered_map>
+
+#include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/derivs.hpp"
+#include "teqp/exceptions.hpp"
+
+namespace teqp{
+namespace cppinterface{
+
+/// Counters for the lookups into the derivative cache of a CachedModel
+struct DerivativeCacheStats{
+    std::size_t hits = 0, ///< Number of lookups that were served from the cache
+    misses = 0; ///< Number of lookups that required the wrapped model to be evaluated
+};
+
+namespace internal{
+
+/**
+ A small least-recently-used cache keyed by a state point given by a scalar temperature, a scalar, and an array.
+
+ The capacity is expected to be small (a handful of entries), so the lookup is a linear search with exact comparison
+ of the keys; the cache is meant for the case where the same state is queried repeatedly, not for interpolation
+ */
+template<typename Value>
+class StateLRU{
+private:
+    struct Entry{
+        double T, rho;
+        EArrayd x;
+        Value value;
+    };
+    std::list<Entry> entries;
+    std::size_t capacity;
+public:
+    StateLRU(std::size_t capacity) : capacity(capacity) {};
+
+    /// Return a pointer to the value if found (and mark it as most recently used), otherwise nullptr
+    const Value* find(const double T, const double rho, const EArrayd& x){
+        for (auto it = entries.begin(); it != entries.end(); ++it){
+            if (it->T == T && it->rho == rho && it->x.size() == x.size() && (it->x == x).all()){
+                entries.splice(entries.begin(), entries, it);
+                return &(entries.front().value);
+            }
+        }
+        return nullptr;
+    }
+    /// Store a value, evicting the least recently used entry if full
+    const Value& insert(const double T, const double rho, const EArrayd& x, Value&& value){
+        if (entries.size() >= capacity){
+            entries.pop_back();
+        }
+        entries.push_front(Entry{T, rho, x, std::move(value)});
+        return entries.front().value;
+    }
+};
+
+}
+
+/**
+ A decorator for an AbstractModel that caches the derivatives at the most recently visited state points.
+
+ Two kinds of state points are cached:
+ * For \f$(T,\rho,\vec{x})\f$, the full matrix of \f$\Lambda^{\rm r}_{xy}\f$ for \f$x,y\leq 2\f$ is obtained in one call
+   to get_deriv_mat2 of the wrapped model, and get_Arxy, get_Ar00...get_Ar22, get_Ar01n, get_Ar02n and get_deriv_mat2 are served from it
+ * For \f$(T,\vec{\rho})\f$, the value, gradient and Hessian of \f$\Psi^{\rm r}\f$ are obtained in one call to
+   build_Psir_fgradHessian_autodiff of the wrapped model, from which the gradient, Hessian, \f$p^{\rm r}\f$, the
+   fugacity coefficients, and their derivatives w.r.t. pressure and mole numbers are served
+
+ All other methods are forwarded to the wrapped model. The high-level algorithms (pure_VLE_T, mix_VLE_Tx, ...) that are
+ implemented in terms of the AbstractModel interface thus also benefit from the cache.
+
+ Each thread has its own cache, owned by the instance and released with it. Finding the cache of the calling thread takes a lock,
+ the lookups into the cache do not; the hit and miss counters are shared between threads
+ */
+class CachedModel : public AbstractModel{
+private:
+    using fgradHessian_t = std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd>;
+    struct Caches{
+        internal::StateLRU<EArray33d> TD;
+        internal::StateLRU<fgradHessian_t> iso;
+        Caches(std::size_t capacity) : TD(capacity), iso(capacity) {};
+    };
+
+    const std::unique_ptr<AbstractModel> m_model;
+    const std::size_t m_capacity;
+    mutable std::atomic<std::size_t> m_hits{0}, m_misses{0};
+    mutable std::mutex m_caches_mutex;
+    /// The caches of the threads that have used this instance; each is only ever accessed by its own thread
+    mutable std::unordered_map<std::thread::id, std::unique_ptr<Caches>> m_caches;
+
+    Caches& get_caches() const {
+        std::lock_guard<std::mutex> lock(m_caches_mutex);
+        auto& caches = m_caches[std::this_thread::get_id()];
+        if (!caches){
+            caches = std::make_unique<Caches>(m_capacity);
+        }
+        return *caches; // Stays valid when the map is rehashed, as it is held by pointer
+    }
+
+    const EArray33d& get_cached_mat2(const double T, const double rho, const EArrayd& z) const {
+        auto& cache = get_caches().TD;
+        if (const auto* val = cache.find(T, rho, z); val != nullptr){
+            ++m_hits;
+            return *val;
+        }
+        ++m_misses;
+        return cache.insert(T, rho, z, m_model->get_deriv_mat2(T, rho, z));
+    }
+    const fgradHessian_t& get_cached_fgradHessian(const double T, const EArrayd& rhovec) const {
+        auto& cache = get_caches().iso;
+        if (const auto* val = cache.find(T, 0.0, rhovec); val != nullptr){
+            ++m_hits;
+            return *val;
+        }
+        ++m_misses;
+        return cache.insert(T, 0.0, rhovec, m_model->build_Psir_fgradHessian_autodiff(T, rhovec));
+    }
+
+public:
+    /**
+     \param model The model to be wrapped; ownership is transferred to the CachedModel
+     \param capacity The number of state points retained in each cache of each thread
+     */
+    CachedModel(std::unique_ptr<AbstractModel>&& model, std::size_t capacity = 8) : m_model(std::move(model)), m_capacity(capacity) {
+        if (!m_model){
+            throw teqp::InvalidArgument("The model passed to CachedModel is a nullptr");
+        }
+        if (capacity == 0){
+            throw teqp::InvalidArgument("The capacity of the cache must be at least 1");
+        }
+    };
+
+    /// Get the counters of cache hits and misses, summed over all the threads
+    DerivativeCacheStats get_cache_stats() const { return {m_hits.load(), m_misses.load()}; }
+    /// Reset the counters of cache hits and misses
+    void reset_cache_stats() { m_hits = 0; m_misses = 0; }
+    /// Empty the cache of the calling thread
+    void clear_cache() const {
+        std::lock_guard<std::mutex> lock(m_caches_mutex);
+        m_caches.erase(std::this_thread::get_id());
+    }
+
+    const AbstractModel& get_wrapped_cref() const { return *m_model; }
+
+    const std::type_index& get_type_index() const override { return m_model->get_type_index(); };
+    double get_R(const EArrayd& molefrac) const override { return m_model->get_R(molefrac); };
+
+    double get_Arxy(const int NT, const int ND, const double T, const double rho, const EArrayd& molefrac) const override {
+        if (NT >= 0 && NT <= 2 && ND >= 0 && ND <= 2){
+            return get_cached_mat2(T, rho, molefrac)(NT, ND);
+        }
+        return m_model->get_Arxy(NT, ND, T, rho, molefrac);
+    };
+    void get_Arxy_many(const int NT, const int ND, const REArrayd& T, const REArrayd& rho, const REMatrixd& molefracs, Eigen::Ref<EArrayd> out, const std::optional<int>& Nthreads) const override {
+        // A batch of distinct states does not benefit from a cache of the last states
+        m_model->get_Arxy_many(NT, ND, T, rho, molefracs, out, Nthreads);
+    };
+
+#define X(i,j) double get_Ar ## i ## j(const double T, const double rho, const REArrayd& molefrac) const override { return get_Arxy(i, j, T, rho, molefrac); };
+    ARXY_args
+#undef X
+#define X(i) EArrayd get_Ar0 ## i ## n(const double T, const double rho, const REArrayd& molefrac) const override { \
+        if (i <= 2){ return get_cached_mat2(T, rho, molefrac).row(0).head(i+1).transpose(); } \
+        return m_model->get_Ar0 ## i ## n(T, rho, molefrac); };
+    AR0N_args
+#undef X
+
+    // Virial derivatives are functions of temperature only, and are forwarded
+    double get_B2vir(const double T, const EArrayd& z) const override { return m_model->get_B2vir(T, z); };
+    std::map<int, double> get_Bnvir(const int Nderiv, const double T, const EArrayd& z) const override { return m_model->get_Bnvir(Nderiv, T, z); };
+    double get_B12vir(const double T, const EArrayd& z) const override { return m_model->get_B12vir(T, z); };
+    double get_dmBnvirdTm(const int Nderiv, const int NTderiv, const double T, const EArrayd& z) const override { return m_model->get_dmBnvirdTm(Nderiv, NTderiv, T, z); };
+
+    // Isochoric derivatives that can be obtained from the value, gradient and Hessian of Psir
+    std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd> build_Psir_fgradHessian_autodiff(const double T, const EArrayd& rhovec) const override {
+        return get_cached_fgradHessian(T, rhovec);
+    };
+    EArrayd build_Psir_gradient_autodiff(const double T, const EArrayd& rhovec) const override {
+        return std::get<1>(get_cached_fgradHessian(T, rhovec));
+    };
+    EMatrixd build_Psir_Hessian_autodiff(const double T, const EArrayd& rhovec) const override {
+        return std::get<2>(get_cached_fgradHessian(T, rhovec)).array();
+    };
+    double get_pr(const double T, const EArrayd& rhovec) const override {
+        const auto& [Psir, grad, H] = get_cached_fgradHessian(T, rhovec);
+        return (rhovec*grad).sum() - Psir;
+    };
+    FugacityCoefficients get_ln_fugacity_coefficients_fused(const double T, const EArrayd& rhovec, const FugacityFlags& flags) const override {
+        if (flags.dT){
+            // The temperature derivatives are not in the cache
+            return m_model->get_ln_fugacity_coefficients_fused(T, rhovec, flags);
+        }
+        const auto& [Psir, grad, H] = get_cached_fgradHessian(T, rhovec);
+        return build_fugacity_coefficients(m_model->get_R((rhovec/rhovec.sum()).eval()), T, rhovec, Psir, grad, H, 0.0, Eigen::ArrayXd(), flags);
+    };
+    EArrayd get_fugacity_coefficients(const double T, const EArrayd& rhovec) const override {
+        const auto& [Psir, grad, H] = get_cached_fgradHessian(T, rhovec);
+        const double rhotot = rhovec.sum();
+        const double RT = m_model->get_R((rhovec/rhotot).eval())*T;
+        const double Z = 1.0 + ((rhovec*grad).sum() - Psir)/(rhotot*RT);
+        return exp(grad/RT - log(Z));
+    };
+
+    // The remaining isochoric derivatives are forwarded
+    double get_splus(const double T, const EArrayd& rhovec) const override { return m_model->get_splus(T, rhovec); };
+    double get_dpdT_constrhovec(const double T, const EArrayd& rhovec) const override { return m_model->get_dpdT_constrhovec(T, rhovec); };
+    EArrayd get_chempotVLE_autodiff(const double T, const EArrayd& rhovec) const override { return m_model->get_chempotVLE_autodiff(T, rhovec); };
+    EArrayd get_dchempotdT_autodiff(const double T, const EArrayd& rhovec) const override { return m_model->get_dchempotdT_autodiff(T, rhovec); };
+    EArrayd get_partial_molar_volumes(const double T, const EArrayd& rhovec) const override { return m_model->get_partial_molar_volumes(T, rhovec); };
+    EArrayd build_d2PsirdTdrhoi_autodiff(const double T, const EArrayd& rhovec) const override { return m_model->build_d2PsirdTdrhoi_autodiff(T, rhovec); };
+    EArrayd get_dpdrhovec_constT(const double T, const EArrayd& rhovec) const override { return m_model->get_dpdrhovec_constT(T, rhovec); };
+    EMatrixd build_Psi_Hessian_autodiff(const double T, const EArrayd& rhovec) const override { return m_model->build_Psi_Hessian_autodiff(T, rhovec); };
+    Eigen::ArrayXd get_Psir_sigma_derivs(const double T, const EArrayd& rhovec, const EArrayd& v) const override { return m_model->get_Psir_sigma_derivs(T, rhovec, v); };
+
+    EArray33d get_deriv_mat2(const double T, double rho, const EArrayd& z) const override {
+        return get_cached_mat2(T, rho, z);
+    };
+
+    // The superancillary equations do not need a cache
+    bool has_superanc() const override { return m_model->has_superanc(); };
+    EArray3 superanc_VLE_T(const double T, const std::size_t ifluid) const override { return m_model->superanc_VLE_T(T, ifluid); };
+};
+
+/**
+ Wrap a model in a CachedModel so that repeated queries at the same state point are served from a cache
+
+ \param model The model to be wrapped; ownership is transferred
+ \param capacity The number of state points retained in each cache of each thread
+ */
+inline auto make_cached(std::unique_ptr<AbstractModel>&& model, std::size_t capacity = 8){
+    return std::make_unique<CachedModel>(std::move(model), capacity);
+}
+
+}
+}
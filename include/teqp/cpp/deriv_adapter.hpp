@@ -3,6 +3,7 @@
 #include "teqp/derivs.hpp"
 #include "teqp/cpp/teqpcpp.hpp"
 #include "teqp/exceptions.hpp"
+#include "teqp/cpp/batch.hpp"
 
 namespace teqp{
 namespace cppinterface{
@@ -33,6 +34,20 @@ public:
 
 namespace internal{
     template<class T>struct tag{using type=T;};
+
+    /// Detects whether a model provides superanc_VLE_T(T, ifluid), returning a tuple of psat, rhoL, rhoV
+    template<typename Model, typename = void>
+    struct has_superanc_VLE_T : std::false_type {};
+
+    template<typename Model>
+    struct has_superanc_VLE_T<Model, std::void_t<decltype(std::declval<const std::decay_t<Model>&>().superanc_VLE_T(std::declval<double>(), std::declval<std::size_t>()))>> : std::true_type {};
+
+    /// Detects whether a model decides at runtime whether its superancillary equations are available, with a member has_superanc()
+    template<typename Model, typename = void>
+    struct has_runtime_superanc : std::false_type {};
+
+    template<typename Model>
+    struct has_runtime_superanc<Model, std::void_t<decltype(bool(std::declval<const std::decay_t<Model>&>().has_superanc()))>> : std::true_type {};
 }
 
 /**
@@ -66,15 +81,41 @@ public:
     };
     
     virtual double get_Arxy(const int NT, const int ND, const double T, const double rhomolar, const EArrayd& molefrac) const override{
-        return TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>::get_Ar(NT, ND, mp.get_cref(), T, rhomolar, molefrac);
+        using tdx = TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>;
+        // The runtime derivative orders select the templated function, so the analytic backend is used as in get_Ar ## i ## j
+        #define X(i,j) if (NT == i && ND == j){ return tdx::template get_Arxy<i,j,ADBackends::analytic>(mp.get_cref(), T, rhomolar, molefrac); }
+            ARXY_args
+        #undef X
+        throw teqp::InvalidArgument("Invalid combination of NT=" + std::to_string(NT) + " and ND=" + std::to_string(ND));
     };
-    
+
+    virtual void get_Arxy_many(const int NT, const int ND, const REArrayd& T, const REArrayd& rho, const REMatrixd& molefracs, Eigen::Ref<EArrayd> out, const std::optional<int>& Nthreads) const override {
+        if (out.size() != T.size()){
+            throw teqp::InvalidArgument("Length of out (" + std::to_string(out.size()) + ") does not match length of T (" + std::to_string(T.size()) + ")");
+        }
+        const auto& model = mp.get_cref();
+        using tdx = TDXDerivatives<decltype(model), double, EArrayd>;
+        // The runtime derivative orders are resolved once here, so the inner loop calls the templated function directly
+        #define X(i,j) if (NT == i && ND == j){ \
+            for_each_state(T, rho, molefracs, Nthreads, [&](const Eigen::Index k, const double T_, const double rho_, const EArrayd& z){ \
+                out[k] = tdx::template get_Arxy<i,j,ADBackends::analytic>(model, T_, rho_, z); }); \
+            return; }
+            ARXY_args
+        #undef X
+        throw teqp::InvalidArgument("Invalid combination of NT=" + std::to_string(NT) + " and ND=" + std::to_string(ND));
+    };
+
+    virtual FugacityCoefficients get_ln_fugacity_coefficients_fused(const double T, const EArrayd& rhovec, const FugacityFlags& flags) const override {
+        return IsochoricDerivatives<decltype(mp.get_cref()), double, EArrayd>::get_ln_fugacity_coefficients_fused(mp.get_cref(), T, rhovec, flags);
+    };
+
     // Here X-Macros are used to create functions like get_Ar00, get_Ar01, ....
-#define X(i,j) virtual double get_Ar ## i ## j(const double T, const double rho, const REArrayd& molefrac) const  override { return TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>::template get_Arxy<i,j>(mp.get_cref(), T, rho, molefrac); };
+    // The analytic backend uses the closed-form derivatives of the models that provide them, and autodiff for all others
+#define X(i,j) virtual double get_Ar ## i ## j(const double T, const double rho, const REArrayd& molefrac) const  override { return TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>::template get_Arxy<i,j,ADBackends::analytic>(mp.get_cref(), T, rho, molefrac); };
     ARXY_args
 #undef X
     // And like get_Ar01n, get_Ar02n, ....
-#define X(i) virtual EArrayd get_Ar0 ## i ## n(const double T, const double rho, const REArrayd& molefrac) const  override { auto vals = TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>::template get_Ar0n<i>(mp.get_cref(), T, rho, molefrac); return Eigen::Map<Eigen::ArrayXd>(&(vals[0]), vals.size()); };
+#define X(i) virtual EArrayd get_Ar0 ## i ## n(const double T, const double rho, const REArrayd& molefrac) const  override { auto vals = TDXDerivatives<decltype(mp.get_cref()), double, EArrayd>::template get_Ar0n<i,ADBackends::analytic>(mp.get_cref(), T, rho, molefrac); return Eigen::Map<Eigen::ArrayXd>(&(vals[0]), vals.size()); };
     AR0N_args
 #undef X
     
@@ -109,7 +150,28 @@ public:
         return IsochoricDerivatives<decltype(mp.get_cref()), double, EArrayd>::get_Psir_sigma_derivs(mp.get_cref(), T, rhovec, v);
     };
     
-    virtual EArray33d get_deriv_mat2(const double T, double rho, const EArrayd& z ) const override { throw teqp::NotImplementedError("Not available"); };
+    virtual bool has_superanc() const override {
+        if constexpr (internal::has_runtime_superanc<decltype(mp.get_cref())>::value){
+            return mp.get_cref().has_superanc();
+        }
+        else{
+            return internal::has_superanc_VLE_T<decltype(mp.get_cref())>::value;
+        }
+    };
+    virtual EArray3 superanc_VLE_T(const double T, const std::size_t ifluid) const override {
+        if constexpr (internal::has_superanc_VLE_T<decltype(mp.get_cref())>::value){
+            auto [p, rhoL, rhoV] = mp.get_cref().superanc_VLE_T(T, ifluid);
+            return (EArray3() << p, rhoL, rhoV).finished();
+        }
+        else{
+            return AbstractModel::superanc_VLE_T(T, ifluid);
+        }
+    };
+    
+    virtual EArray33d get_deriv_mat2(const double T, double rho, const EArrayd& z ) const override {
+        // The alphar method is called; for the ideal-gas models, alphar is an alias for alphaig
+        return DerivativeHolderSquare<2, AlphaWrapperOption::residual>(mp.get_cref(), T, rho, z).derivs;
+    };
 };
 
 template<typename TemplatedModel> auto view(const TemplatedModel& tp){
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "teqp/cpp/properties_types.hpp"
+
 namespace teqp{
 namespace cppinterface{
 
@@ -84,5 +86,40 @@ auto build_iteration_Jv(const std::vector<char>& vars, const Eigen::Array<double
     return im;
 }
 
+/**
+ \brief Calculate the common thermodynamic properties from the matrices of derivatives of \f$\alpha^{\rm r}\f$ and \f$\alpha^{\rm ig}\f$
+ 
+ Only the temperature derivatives of \f$\alpha^{\rm ig}\f$ are used; the density dependence of the ideal-gas part is taken to be \f$\ln\rho\f$
+ 
+ \param Ar The matrix of derivatives of \f$\alpha^{\rm r}\f$, perhaps obtained via get_deriv_mat2 of the AbstractModel
+ \param Aig The matrix of derivatives of \f$\alpha^{\rm ig}\f$, perhaps obtained via get_deriv_mat2 of the AbstractModel
+ \param R The molar gas constant
+ \param T Temperature
+ \param rho Molar density
+ */
+inline StateProperties build_state_properties(const Eigen::Array<double, 3, 3>& Ar, const Eigen::Array<double, 3, 3>& Aig, const double R, const double T, const double rho){
+    StateProperties o;
+    o.T = T; o.rho = rho; o.R = R;
+    const double RT = R*T;
+    // Sums of residual and ideal-gas temperature derivatives
+    const double A00 = Ar(0,0) + Aig(0,0), A10 = Ar(1,0) + Aig(1,0), A20 = Ar(2,0) + Aig(2,0);
+    
+    o.Z = 1.0 + Ar(0,1);
+    o.p = rho*RT*o.Z;
+    o.a = RT*A00;
+    o.u = RT*A10;
+    o.h = RT*(A10 + o.Z);
+    o.s = R*(A10 - A00);
+    o.g = RT*(A00 + o.Z);
+    o.cv = -R*A20;
+    o.dpdT_rho = rho*R*(1.0 + Ar(0,1) - Ar(1,1));
+    o.dpdrho_T = RT*(1.0 + 2.0*Ar(0,1) + Ar(0,2));
+    o.cp = o.cv + T/(rho*rho)*o.dpdT_rho*o.dpdT_rho/o.dpdrho_T;
+    o.Mw2 = o.cp/o.cv*o.dpdrho_T;
+    // From (T*(dv/dT)_p - v)/cp, with (dv/dT)_p = (dp/dT)_rho/(rho^2*(dp/drho)_T)
+    o.JT = (T*o.dpdT_rho/(rho*rho*o.dpdrho_T) - 1.0/rho)/o.cp;
+    return o;
+}
+
 }
 };
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Eigen/Core>
+
+namespace teqp {
+
+/**
+ The thermodynamic properties at a state point given by temperature, molar density, and mole fractions
+
+ The caloric properties include the ideal-gas contribution, so their reference state is that of the ideal-gas model
+ */
+struct StateProperties {
+    double T = -1, ///< Temperature, K
+    rho = -1, ///< Molar density, mol/m^3
+    R = -1, ///< Molar gas constant, J/mol/K
+    p = -1, ///< Pressure, Pa
+    Z = -1, ///< Compressibility factor, -
+    u = -1, ///< Molar internal energy, J/mol
+    h = -1, ///< Molar enthalpy, J/mol
+    s = -1, ///< Molar entropy, J/mol/K
+    a = -1, ///< Molar Helmholtz energy, J/mol
+    g = -1, ///< Molar Gibbs energy, J/mol
+    cv = -1, ///< Isochoric molar specific heat, J/mol/K
+    cp = -1, ///< Isobaric molar specific heat, J/mol/K
+    dpdT_rho = -1, ///< Derivative of pressure w.r.t. temperature at constant molar density, Pa/K
+    dpdrho_T = -1, ///< Derivative of pressure w.r.t. molar density at constant temperature, Pa/(mol/m^3)
+    Mw2 = -1, ///< Molar mass times the square of the speed of sound, J/mol; the speed of sound is then sqrt(Mw2/M) with M in kg/mol
+    JT = -1; ///< Joule-Thomson coefficient, K/Pa
+};
+
+/// The derivatives of the logarithms of the fugacity coefficients to be calculated along with them
+struct FugacityFlags {
+    bool dT = false, ///< Whether to calculate d(ln(phi_i))/dT at constant pressure and mole numbers
+    dp = false, ///< Whether to calculate d(ln(phi_i))/dp at constant temperature and mole numbers
+    dn = false; ///< Whether to calculate n*d(ln(phi_i))/dn_j at constant temperature and pressure
+};
+
+/**
+ The logarithms of the fugacity coefficients at a state point given by temperature and molar concentrations, the compressibility
+ factor, and the derivatives requested in FugacityFlags; the derivatives that were not requested are left empty
+ */
+struct FugacityCoefficients {
+    Eigen::ArrayXd lnphi; ///< Natural logarithm of the fugacity coefficient of each component, -
+    double Z = -1; ///< Compressibility factor, -
+    Eigen::ArrayXd dlnphidT; ///< Derivative of ln(phi_i) w.r.t. temperature at constant pressure and mole numbers, 1/K
+    Eigen::ArrayXd dlnphidp; ///< Derivative of ln(phi_i) w.r.t. pressure at constant temperature and mole numbers, 1/Pa
+    Eigen::ArrayXXd ndlnphidn; ///< n*d(ln(phi_i))/dn_j at constant temperature and pressure in row i and column j (a symmetric matrix), -
+};
+
+}
@@ -11,8 +11,10 @@
 #include "teqp/algorithms/critical_tracing_types.hpp"
 #include "teqp/algorithms/VLE_types.hpp"
 #include "teqp/algorithms/VLLE_types.hpp"
+#include "teqp/cpp/properties_types.hpp"
 
 using EArray2 = Eigen::Array<double, 2, 1>;
+using EArray3 = Eigen::Array<double, 3, 1>;
 using EArrayd = Eigen::ArrayX<double>;
 using EArray33d = Eigen::Array<double, 3, 3>;
 using REArrayd = Eigen::Ref<const EArrayd>;
@@ -95,7 +97,26 @@ namespace teqp {
             double R(const EArrayd& x) const { return get_R(x); };
             
             virtual double get_Arxy(const int, const int, const double, const double, const EArrayd&) const = 0;
-            
+
+            /**
+             Evaluate \f$\Lambda^{\rm r}_{xy}\f$ for a batch of states, with the dispatch to the model done once for the batch
+
+             \param T Temperatures, one per state
+             \param rho Molar densities, one per state
+             \param molefracs Mole fractions, one row per state, or a single row shared by all the states
+             \param out The output buffer, of the same length as T
+             \param Nthreads If provided, the batch is split over this many threads
+             */
+            virtual void get_Arxy_many(const int NT, const int ND, const REArrayd& T, const REArrayd& rho, const REMatrixd& molefracs, Eigen::Ref<EArrayd> out, const std::optional<int>& Nthreads = std::nullopt) const = 0;
+
+            /**
+             The logarithms of the fugacity coefficients, the compressibility factor, and the derivatives of ln(phi) requested in flags,
+             all obtained from one derivative pass of the model (see IsochoricDerivatives::get_ln_fugacity_coefficients_fused)
+             */
+            virtual FugacityCoefficients get_ln_fugacity_coefficients_fused(const double T, const EArrayd& rhovec, const FugacityFlags& flags = {}) const = 0;
+            /// The batched version of get_ln_fugacity_coefficients_fused; rhovecs has one row per state, and out is resized to the number of states
+            void get_ln_fugacity_coefficients_fused_many(const REArrayd& T, const REMatrixd& rhovecs, const FugacityFlags& flags, std::vector<FugacityCoefficients>& out, const std::optional<int>& Nthreads = std::nullopt) const;
+
             // Here X-Macros are used to create functions like get_Ar00, get_Ar01, ....
             #define X(i,j) virtual double get_Ar ## i ## j(const double T, const double rho, const REArrayd& molefrac) const = 0;
                 ARXY_args
@@ -135,14 +156,31 @@ namespace teqp {
             EArray2 extrapolate_from_critical(const double Tc, const double rhoc, const double Tgiven) const;
             std::tuple<EArrayd, EMatrixd> get_pure_critical_conditions_Jacobian(const double T, const double rho, const std::optional<std::size_t>& alternative_pure_index, const std::optional<std::size_t>& alternative_length) const;
             
+            /**
+             Pure fluid VLE at T by Newton's method, starting from the guesses rhoL and rhoV.
+             
+             When has_superanc() is true and T is within the range of the superancillary equations, the guesses are ignored and
+             the iteration starts from the superancillary densities of component 0 (ifluid is always 0 here), so with maxiter of 0
+             those values are returned directly. Outside that range, the guesses are used.
+             */
             EArray2 pure_VLE_T(const double T, const double rhoL, const double rhoV, int maxiter) const;
             double dpsatdT_pure(const double T, const double rhoL, const double rhoV) const;
             
+            /// Whether the model provides superancillary equations for the VLE of its pure components (the canonical cubics)
+            virtual bool has_superanc() const;
+            /// The saturation pressure and the saturated liquid and vapor densities of the pure component ifluid, straight from the superancillary equations of the model
+            virtual EArray3 superanc_VLE_T(const double T, const std::size_t ifluid = 0) const;
+            /// The batched version of superanc_VLE_T; out must have one row per temperature, with the columns psat, rhoL, rhoV. Any strides are accepted, so a row-major buffer can be written in place through a map
+            void superanc_VLE_T_many(const REArrayd& T, const std::size_t ifluid, Eigen::Ref<EMatrixd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> out, const std::optional<int>& Nthreads = std::nullopt) const;
+            
             virtual std::tuple<EArrayd, EArrayd> get_drhovecdp_Tsat(const double T, const REArrayd& rhovecL, const REArrayd& rhovecV) const;
             virtual std::tuple<EArrayd, EArrayd> get_drhovecdT_psat(const double T, const REArrayd& rhovecL, const REArrayd& rhovecV) const;
             virtual double get_dpsat_dTsat_isopleth(const double T, const REArrayd& rhovecL, const REArrayd& rhovecV) const;
             virtual nlohmann::json trace_VLE_isotherm_binary(const double T0, const EArrayd& rhovec0, const EArrayd& rhovecV0, const std::optional<TVLEOptions> & = std::nullopt) const;
             virtual nlohmann::json trace_VLE_isobar_binary(const double p, const double T0, const EArrayd& rhovecL0, const EArrayd& rhovecV0, const std::optional<PVLEOptions> & = std::nullopt) const;
+            // Versions of the tracers that return contiguous columns rather than JSON
+            virtual VLETraceColumns trace_VLE_isotherm_binary_columns(const double T0, const EArrayd& rhovec0, const EArrayd& rhovecV0, const std::optional<TVLEOptions> & = std::nullopt) const;
+            virtual VLETraceColumns trace_VLE_isobar_binary_columns(const double p, const double T0, const EArrayd& rhovecL0, const EArrayd& rhovecV0, const std::optional<PVLEOptions> & = std::nullopt) const;
             virtual std::tuple<VLE_return_code,EArrayd,EArrayd> mix_VLE_Tx(const double T, const REArrayd& rhovecL0, const REArrayd& rhovecV0, const REArrayd& xspec, const double atol, const double reltol, const double axtol, const double relxtol, const int maxiter) const;
             virtual MixVLEReturn mix_VLE_Tp(const double T, const double pgiven, const REArrayd& rhovecL0, const REArrayd& rhovecV0, const std::optional<MixVLETpFlags> &flags = std::nullopt) const;
             virtual std::tuple<VLE_return_code,double,EArrayd,EArrayd> mixture_VLE_px(const double p_spec, const REArrayd& xmolar_spec, const double T0, const REArrayd& rhovecL0, const REArrayd& rhovecV0, const std::optional<MixVLEpxFlags>& flags = std::nullopt) const;
@@ -151,6 +189,9 @@ namespace teqp {
             std::vector<nlohmann::json> find_VLLE_T_binary(const std::vector<nlohmann::json>& traces, const std::optional<VLLE::VLLEFinderOptions> options = std::nullopt) const;
             
             virtual nlohmann::json trace_critical_arclength_binary(const double T0, const EArrayd& rhovec0, const std::optional<std::string>& = std::nullopt, const std::optional<TCABOptions> & = std::nullopt) const;
+            virtual CriticalTraceColumns trace_critical_arclength_binary_columns(const double T0, const EArrayd& rhovec0, const std::optional<std::string>& = std::nullopt, const std::optional<TCABOptions> & = std::nullopt) const;
+            /// Streaming version of the critical curve tracer; each point is passed to the sink and nothing is retained. Returns the number of points
+            virtual std::size_t trace_critical_arclength_binary_sink(const double T0, const EArrayd& rhovec0, const CriticalTraceSink& sink, const std::optional<TCABOptions> & = std::nullopt) const;
             virtual EArrayd get_drhovec_dT_crit(const double T, const REArrayd& rhovec) const;
             virtual double get_dp_dT_crit(const double T, const REArrayd& rhovec) const;
             virtual EArray2 get_criticality_conditions(const double T, const REArrayd& rhovec) const;
@@ -175,5 +216,38 @@ namespace teqp {
         );
     
         std::unique_ptr<AbstractModel> build_model_ptr(const nlohmann::json& json);
+
+        /**
+         Save a model (as specified to make_model) to a versioned binary file, from which it can be loaded again with load_binary
+         without reading any other files.
+         
+         The file starts with the 8-byte magic string "TEQPBIN", a uint32 format version (2), a uint32 payload encoding,
+         and a uint64 payload length, all in native byte order. For the encoding 0, the payload is the UBJSON of the specification,
+         from which load_binary builds the model. Multifluid models are stored with the encoding 1: the specification, made
+         self-contained with make_self_contained_multifluid_spec, is stored as a uint64 length and its UBJSON, followed by the built
+         tables of the model (see multifluid_binary.hpp), from which load_binary constructs the model without parsing any JSON
+         */
+        void save_binary(const nlohmann::json& spec, const std::string& path);
+        /// Read the self-contained model specification from a file written by save_binary
+        nlohmann::json load_binary_spec(const std::string& path);
+        /// Build the model stored in a file written by save_binary
+        std::unique_ptr<AbstractModel> load_binary(const std::string& path);
+
+        /// Convert the columns of a VLE trace to the JSON format returned by trace_VLE_isotherm_binary and trace_VLE_isobar_binary
+        nlohmann::json to_JSON(const VLETraceColumns& cols);
+        /// Convert the columns of a critical curve trace to the JSON format returned by trace_critical_arclength_binary
+        nlohmann::json to_JSON(const CriticalTraceColumns& cols);
+
+        /**
+         Calculate the thermodynamic properties at the given state point. Each model is evaluated with a single pass
+         of get_deriv_mat2, so the setup in alphar (reducing functions, diameters, etc.) is only carried out once per model
+
+         \param residual The model for the residual Helmholtz energy
+         \param idealgas The model for the ideal-gas Helmholtz energy, perhaps of the kind IdealHelmholtz
+         */
+        StateProperties get_properties_Trho(const AbstractModel& residual, const AbstractModel& idealgas, const double T, const double rho, const REArrayd& molefrac);
+
+        /// The batched version of get_properties_Trho; out is resized to the number of states, and molefracs has one row per state (or a single shared row)
+        void get_properties_Trho_many(const AbstractModel& residual, const AbstractModel& idealgas, const REArrayd& T, const REArrayd& rho, const REMatrixd& molefracs, std::vector<StateProperties>& out, const std::optional<int>& Nthreads = std::nullopt);
     }
 }
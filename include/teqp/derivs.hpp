@@ -4,9 +4,14 @@
 #include <map>
 #include <tuple>
 #include <numeric>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <valarray>
 
 #include "teqp/types.hpp"
 #include "teqp/exceptions.hpp"
+#include "teqp/cpp/properties_types.hpp"
 
 #if defined(TEQP_MULTICOMPLEX_ENABLED)
 #include "MultiComplex/MultiComplex.hpp"
@@ -120,8 +125,45 @@ enum class ADBackends { autodiff
     ,multicomplex
 #endif
     ,complex_step
+    ,analytic
 };
 
+/**
+* \brief Detects whether a model provides a closed-form kernel for the derivative \f$\Lambda^{\rm r}_{xy}\f$,
+* as a member template of the form
+* \code
+* template<int iT, int iD, typename TType, typename RhoType, typename MoleFracType>
+* std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rho, const MoleFracType& molefrac) const;
+* \endcode
+* The kernel is used by the ADBackends::analytic backend; when it returns no value, the derivative is obtained with autodiff
+*/
+template<typename Model, int iT, int iD, typename Scalar, typename VectorType, typename = void>
+struct has_analytic_Arxy : std::false_type {};
+
+template<typename Model, int iT, int iD, typename Scalar, typename VectorType>
+struct has_analytic_Arxy<Model, iT, iD, Scalar, VectorType, std::void_t<decltype(
+    std::declval<const std::decay_t<Model>&>().template get_Arxy_analytic<iT, iD>(std::declval<const Scalar&>(), std::declval<const Scalar&>(), std::declval<const VectorType&>())
+)>> : std::is_same<Scalar, double> {};
+
+/**
+* \brief Detects whether a model provides closed-form kernels for the derivatives of \f$\Psi^{\rm r}\f$ w.r.t. the molar concentrations, as member functions of the form
+* \code
+* template<typename TType, typename RhoVecType>
+* std::optional<Eigen::ArrayXd> get_Psir_gradient_analytic(const TType& T, const RhoVecType& rhovec) const;
+* template<typename TType, typename RhoVecType>
+* std::optional<std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd>> get_Psir_fgradHessian_analytic(const TType& T, const RhoVecType& rhovec) const;
+* \endcode
+* The kernels are used by IsochoricDerivatives in place of autodiff; when they return no value, autodiff is used
+*/
+template<typename Model, typename Scalar, typename VectorType, typename = void>
+struct has_analytic_Psir_derivs : std::false_type {};
+
+template<typename Model, typename Scalar, typename VectorType>
+struct has_analytic_Psir_derivs<Model, Scalar, VectorType, std::void_t<
+    decltype(std::declval<const std::decay_t<Model>&>().get_Psir_gradient_analytic(std::declval<const Scalar&>(), std::declval<const VectorType&>())),
+    decltype(std::declval<const std::decay_t<Model>&>().get_Psir_fgradHessian_analytic(std::declval<const Scalar&>(), std::declval<const VectorType&>()))
+>> : std::is_same<Scalar, double> {};
+
 template<typename Model, typename Scalar = double, typename VectorType = Eigen::ArrayXd>
 struct TDXDerivatives {
 
@@ -235,6 +277,16 @@ struct TDXDerivatives {
         if constexpr (iT == 0 && iD == 0) {
             return wrapper.alpha(T, rho, molefrac);
         }
+        else if constexpr (be == ADBackends::analytic) {
+            // Closed-form derivatives if the model provides them, otherwise autodiff
+            if constexpr (has_analytic_Arxy<Model, iT, iD, Scalar, VectorType>::value) {
+                std::optional<double> val = model.template get_Arxy_analytic<iT, iD>(T, rho, molefrac);
+                if (val) {
+                    return val.value();
+                }
+            }
+            return get_Agenxy<iT, iD, ADBackends::autodiff>(wrapper, T, rho, molefrac);
+        }
         else {
             return get_Agenxy<iT, iD, be>(wrapper, T, rho, molefrac);
         }
@@ -377,7 +429,18 @@ struct TDXDerivatives {
     template<int iT, ADBackends be = ADBackends::autodiff>
     static auto get_Arn0(const Model& model, const Scalar& T, const Scalar& rho, const VectorType& molefrac) {
         auto wrapper = AlphaCallWrapper<AlphaWrapperOption::residual, decltype(model)>(model);
-        return get_Agenn0<iT, be>(wrapper, T, rho, molefrac);
+        if constexpr (be == ADBackends::analytic) {
+            if constexpr (has_analytic_Arxy<Model, iT, 0, Scalar, VectorType>::value) {
+                auto o = get_Ar_analytic_series<true>(model, T, rho, molefrac, std::make_index_sequence<iT + 1>());
+                if (o) {
+                    return o.value();
+                }
+            }
+            return get_Agenn0<iT, ADBackends::autodiff>(wrapper, T, rho, molefrac);
+        }
+        else {
+            return get_Agenn0<iT, be>(wrapper, T, rho, molefrac);
+        }
     }
     
     /**
@@ -391,7 +454,33 @@ struct TDXDerivatives {
     template<int iD, ADBackends be = ADBackends::autodiff>
     static auto get_Ar0n(const Model& model, const Scalar& T, const Scalar& rho, const VectorType& molefrac) {
         auto wrapper = AlphaCallWrapper<AlphaWrapperOption::residual, decltype(model)>(model);
-        return get_Agen0n<iD, be>(wrapper, T, rho, molefrac);
+        if constexpr (be == ADBackends::analytic) {
+            if constexpr (has_analytic_Arxy<Model, 0, iD, Scalar, VectorType>::value) {
+                auto o = get_Ar_analytic_series<false>(model, T, rho, molefrac, std::make_index_sequence<iD + 1>());
+                if (o) {
+                    return o.value();
+                }
+            }
+            return get_Agen0n<iD, ADBackends::autodiff>(wrapper, T, rho, molefrac);
+        }
+        else {
+            return get_Agen0n<iD, be>(wrapper, T, rho, molefrac);
+        }
+    }
+    
+    /// Collect the derivatives \f$\Lambda^{\rm r}_{n0}\f$ (if wrtT) or \f$\Lambda^{\rm r}_{0n}\f$ for each n in I from the closed-form kernels of the model, if all of them are available
+    template<bool wrtT, std::size_t... I>
+    static std::optional<std::valarray<Scalar>> get_Ar_analytic_series(const Model& model, const Scalar& T, const Scalar& rho, const VectorType& molefrac, std::index_sequence<I...>) {
+        std::valarray<Scalar> o(sizeof...(I));
+        bool ok = true;
+        auto store = [&](std::size_t n, const std::optional<double>& val) {
+            if (val) { o[n] = val.value(); } else { ok = false; }
+        };
+        (store(I, model.template get_Arxy_analytic<(wrtT ? static_cast<int>(I) : 0), (wrtT ? 0 : static_cast<int>(I))>(T, rho, molefrac)), ...);
+        if (!ok) {
+            return std::nullopt;
+        }
+        return o;
     }
     
 
@@ -637,6 +726,47 @@ struct VirialDerivatives {
     }
 };
 
+/**
+ Build the fugacity coefficients from \f$\Psi^{\rm r}\f$, its gradient \f$\Psi^{\rm r}_i\f$ and Hessian \f$\Psi^{\rm r}_{ij}\f$ w.r.t. the molar concentrations,
+ and the derivatives \f$\Psi^{\rm r}_T\f$ and \f$\Psi^{\rm r}_{Ti}\f$ w.r.t. temperature at constant molar concentrations. The Hessian is only
+ needed for the derivatives, and the temperature derivatives only for flags.dT
+
+ With \f$p^{\rm r} = \sum_i\rho_i\Psi^{\rm r}_i - \Psi^{\rm r}\f$ and \f$p_i = (\partial p/\partial\rho_i)_{T} = RT + \sum_k\Psi^{\rm r}_{ik}\rho_k\f$, the
+ partial molar volumes are \f$\bar v_i = p_i/\sum_k\rho_kp_k\f$, and
+ \f[
+ \ln\phi_i = \frac{\Psi^{\rm r}_i}{RT} - \ln Z,\quad Z = 1 + \frac{p^{\rm r}}{\rho RT}
+ \f]
+ \f[
+ \left(\frac{\partial\ln\phi_i}{\partial p}\right)_{T,\vec n} = \frac{\bar v_i}{RT} - \frac{1}{p},\quad
+ n\left(\frac{\partial\ln\phi_i}{\partial n_j}\right)_{T,p} = 1 + \frac{\rho}{RT}\left(\Psi^{\rm r}_{ij} - \frac{p_ip_j}{\sum_k\rho_kp_k}\right)
+ \f]
+ \f[
+ \left(\frac{\partial\ln\phi_i}{\partial T}\right)_{p,\vec n} = \frac{\Psi^{\rm r}_{Ti}}{RT} - \frac{\Psi^{\rm r}_i}{RT^2} + \frac{1}{T} - \frac{\bar v_i}{RT}\left(\frac{\partial p}{\partial T}\right)_{\vec\rho}
+ \f]
+ */
+inline FugacityCoefficients build_fugacity_coefficients(const double R, const double T, const Eigen::ArrayXd& rhovec, const double Psir, const Eigen::ArrayXd& grad, const Eigen::MatrixXd& H, const double dPsirdT, const Eigen::ArrayXd& dgraddT, const FugacityFlags& flags){
+    FugacityCoefficients o;
+    const double rho = rhovec.sum(), RT = R*T;
+    o.Z = 1.0 + ((rhovec*grad).sum() - Psir)/(rho*RT);
+    o.lnphi = grad/RT - log(o.Z);
+    if (flags.dT || flags.dp || flags.dn){
+        const Eigen::ArrayXd dpdrhovec = RT + (H*rhovec.matrix()).array();
+        const double rhodpdrho = (rhovec*dpdrhovec).sum();
+        const Eigen::ArrayXd vbar = dpdrhovec/rhodpdrho;
+        if (flags.dp){
+            o.dlnphidp = vbar/RT - 1.0/(rho*RT*o.Z);
+        }
+        if (flags.dn){
+            o.ndlnphidn = 1.0 + rho/RT*(H - dpdrhovec.matrix()*dpdrhovec.matrix().transpose()/rhodpdrho).array();
+        }
+        if (flags.dT){
+            const double dpdT = rho*R + (rhovec*dgraddT).sum() - dPsirdT;
+            o.dlnphidT = dgraddT/RT - grad/(RT*T) + 1.0/T - vbar*dpdT/RT;
+        }
+    }
+    return o;
+}
+
 /**
  In the isochoric formalism, the fugacity coefficient array can be obtained by the gradient of the residual Helmholtz energy density (which is a scalar) and the compressibility factor \f$Z\f$  (which is also a scalar) in terms of the temperature \f$T\f$ and the molar concentration vector \f$\vec\rho\f$:
  \begin{equation}
@@ -724,6 +854,7 @@ struct VirialDerivatives {
  \end{equation}
  
  */
+
 template<typename Model, typename Scalar = double, typename VectorType = Eigen::ArrayXd>
 struct IsochoricDerivatives{
 
@@ -797,9 +928,15 @@ struct IsochoricDerivatives{
     /***
     * \brief Calculate the Hessian of Psir = ar*rho w.r.t. the molar concentrations
     *
-    * Requires the use of autodiff derivatives to calculate second partial derivatives
+    * Requires the use of autodiff derivatives to calculate second partial derivatives, unless the model provides the closed-form kernels of has_analytic_Psir_derivs
     */
-    static auto build_Psir_Hessian_autodiff(const Model& model, const Scalar& T, const VectorType& rho) {
+    static Eigen::MatrixXd build_Psir_Hessian_autodiff(const Model& model, const Scalar& T, const VectorType& rho) {
+        if constexpr (has_analytic_Psir_derivs<Model, Scalar, VectorType>::value) {
+            auto o = model.get_Psir_fgradHessian_analytic(T, rho);
+            if (o) {
+                return std::get<2>(o.value());
+            }
+        }
         // Double derivatives in each component's concentration
         // N^N matrix (symmetric)
 
@@ -811,15 +948,22 @@ struct IsochoricDerivatives{
             auto molefrac = (rho_ / rhotot_).eval();
             return eval(model.alphar(T, rhotot_, molefrac) * model.R(molefrac) * T * rhotot_);
         };
-        return autodiff::hessian(hfunc, wrt(rhovecc), at(rhovecc), u, g).eval(); // evaluate the function value u, its gradient, and its Hessian matrix H
+        Eigen::MatrixXd H = autodiff::hessian(hfunc, wrt(rhovecc), at(rhovecc), u, g); // evaluate the function value u, its gradient, and its Hessian matrix H
+        return H;
     }
 
     /***
     * \brief Calculate the function value, gradient, and Hessian of Psir = ar*rho w.r.t. the molar concentrations
     *
-    * Uses autodiff to calculate the derivatives
+    * Uses autodiff to calculate the derivatives, unless the model provides the closed-form kernels of has_analytic_Psir_derivs
     */
     static auto build_Psir_fgradHessian_autodiff(const Model& model, const Scalar& T, const VectorType& rho) {
+        if constexpr (has_analytic_Psir_derivs<Model, Scalar, VectorType>::value) {
+            auto o = model.get_Psir_fgradHessian_analytic(T, rho);
+            if (o) {
+                return o.value();
+            }
+        }
         // Double derivatives in each component's concentration
         // N^N matrix (symmetric)
 
@@ -834,8 +978,8 @@ struct IsochoricDerivatives{
         // Evaluate the function value u, its gradient, and its Hessian matrix H
         Eigen::MatrixXd H = autodiff::hessian(hfunc, wrt(rhovecc), at(rhovecc), u, g); 
         // Remove autodiff stuff from the numerical values
-        auto f = getbaseval(u);
-        auto gg = g.cast<double>().eval();
+        double f = getbaseval(u);
+        Eigen::ArrayXd gg = g.cast<double>();
         return std::make_tuple(f, gg, H);
     }
 
@@ -881,19 +1025,51 @@ struct IsochoricDerivatives{
     /***
     * \brief Gradient of Psir = ar*rho w.r.t. the molar concentrations
     *
-    * Uses autodiff to calculate derivatives
+    * Uses autodiff to calculate derivatives, unless the model provides the closed-form kernels of has_analytic_Psir_derivs
     */
-    static auto build_Psir_gradient_autodiff(const Model& model, const Scalar& T, const VectorType& rho) {
+    static Eigen::VectorXd build_Psir_gradient_autodiff(const Model& model, const Scalar& T, const VectorType& rho) {
+        if constexpr (has_analytic_Psir_derivs<Model, Scalar, VectorType>::value) {
+            auto o = model.get_Psir_gradient_analytic(T, rho);
+            if (o) {
+                return o.value().matrix();
+            }
+        }
         ArrayXdual rhovecc(rho.size()); for (auto i = 0; i < rho.size(); ++i) { rhovecc[i] = rho[i]; }
         auto psirfunc = [&model, &T](const ArrayXdual& rho_) {
             auto rhotot_ = rho_.sum();
             auto molefrac = (rho_ / rhotot_).eval();
             return eval(model.alphar(T, rhotot_, molefrac) * model.R(molefrac) * T * rhotot_);
         };
-        auto val = autodiff::gradient(psirfunc, wrt(rhovecc), at(rhovecc)).eval(); // evaluate the gradient
+        Eigen::VectorXd val = autodiff::gradient(psirfunc, wrt(rhovecc), at(rhovecc)); // evaluate the gradient
         return val;
     }
 
+    /***
+    * \brief Calculate Psir = ar*rho and its gradient w.r.t. the molar concentrations in one pass
+    *
+    * Uses the closed-form gradient if the model provides the kernels of has_analytic_Psir_derivs, and autodiff otherwise
+    */
+    static std::tuple<double, Eigen::ArrayXd> build_Psir_fgrad(const Model& model, const Scalar& T, const VectorType& rho) {
+        if constexpr (has_analytic_Psir_derivs<Model, Scalar, VectorType>::value) {
+            auto o = model.get_Psir_gradient_analytic(T, rho);
+            if (o) {
+                auto rhotot = rho.sum();
+                auto molefrac = (rho / rhotot).eval();
+                double Psir = model.alphar(T, rhotot, molefrac) * model.R(molefrac) * T * rhotot;
+                return std::make_tuple(Psir, Eigen::ArrayXd(o.value()));
+            }
+        }
+        dual u; // the output scalar u = f(x), evaluated together with the gradient below
+        ArrayXdual rhovecc(rho.size()); for (auto i = 0; i < rho.size(); ++i) { rhovecc[i] = rho[i]; }
+        auto psirfunc = [&model, &T](const ArrayXdual& rho_) {
+            auto rhotot_ = rho_.sum();
+            auto molefrac = (rho_ / rhotot_).eval();
+            return eval(model.alphar(T, rhotot_, molefrac) * model.R(molefrac) * T * rhotot_);
+        };
+        Eigen::VectorXd g = autodiff::gradient(psirfunc, wrt(rhovecc), at(rhovecc), u);
+        return std::make_tuple(getbaseval(u), Eigen::ArrayXd(g.array()));
+    }
+
 #if defined(TEQP_MULTICOMPLEX_ENABLED)
     /***
     * \brief Gradient of Psir = ar*rho w.r.t. the molar concentrations
@@ -987,15 +1163,63 @@ struct IsochoricDerivatives{
     */
     template<ADBackends be = ADBackends::autodiff>
     static auto get_ln_fugacity_coefficients(const Model& model, const Scalar& T, const VectorType& rhovec) {
-        auto rhotot = forceeval(rhovec.sum());
-        auto molefrac = (rhovec / rhotot).eval();
-        auto R = model.R(molefrac);
-        using tdx = TDXDerivatives<Model, Scalar, VectorType>;
-        auto Z = 1.0 + tdx::template get_Ar01<be>(model, T, rhotot, molefrac);
-        auto grad = build_Psir_gradient<be>(model, T, rhovec).eval();
-        auto RT = R * T;
-        auto lnphi = ((grad / RT).array() - log(Z)).eval();
-        return forceeval(lnphi.eval());
+        if constexpr (be == ADBackends::autodiff && std::is_same_v<Scalar, double> && std::is_same_v<VectorType, Eigen::ArrayXd>) {
+            // Z is obtained from the same pass as the gradient, rather than from another evaluation of alphar
+            return get_ln_fugacity_coefficients_fused(model, T, rhovec).lnphi;
+        }
+        else {
+            auto rhotot = forceeval(rhovec.sum());
+            auto molefrac = (rhovec / rhotot).eval();
+            auto R = model.R(molefrac);
+            using tdx = TDXDerivatives<Model, Scalar, VectorType>;
+            auto Z = 1.0 + tdx::template get_Ar01<be>(model, T, rhotot, molefrac);
+            auto grad = build_Psir_gradient<be>(model, T, rhovec).eval();
+            auto RT = R * T;
+            auto lnphi = ((grad / RT).array() - log(Z)).eval();
+            return forceeval(lnphi.eval());
+        }
+    }
+
+    /***
+    * \brief Calculate the natural logarithm of the fugacity coefficient of each component, the compressibility factor, and the derivatives of ln(phi) requested in flags, from one derivative pass of alphar
+    *
+    * Z is obtained from \f$p^{\rm r} = \sum_i\rho_i\partial\Psi^{\rm r}/\partial\rho_i - \Psi^{\rm r}\f$, so \f$\Psi^{\rm r}\f$ and its gradient are all that is needed
+    * for ln(phi); they are obtained with build_Psir_fgrad. The derivatives w.r.t. pressure and mole numbers also need the Hessian,
+    * obtained with build_Psir_fgradHessian_autodiff, and the temperature derivatives are obtained from the Hessian of \f$\Psi^{\rm r}\f$ w.r.t.
+    * \f$(T,\rho_1,\ldots,\rho_N)\f$. See build_fugacity_coefficients for the expressions
+    */
+    static FugacityCoefficients get_ln_fugacity_coefficients_fused(const Model& model, const Scalar& T, const VectorType& rhovec, const FugacityFlags& flags = {}) {
+        const auto N = rhovec.size();
+        double Psir = 0, dPsirdT = 0;
+        Eigen::ArrayXd grad, dgraddT;
+        Eigen::MatrixXd H;
+        if (flags.dT) {
+            ArrayXdual2nd x(N + 1); x[0] = T; for (auto i = 0; i < N; ++i) { x[i + 1] = rhovec[i]; }
+            auto hfunc = [&model, N](const ArrayXdual2nd& x_) {
+                auto T_ = x_[0];
+                auto rho_ = x_.tail(N).eval();
+                auto rhotot_ = rho_.sum();
+                auto molefrac = (rho_ / rhotot_).eval();
+                return eval(model.alphar(T_, rhotot_, molefrac) * model.R(molefrac) * T_ * rhotot_);
+            };
+            dual2nd u;
+            ArrayXdual g;
+            Eigen::MatrixXd Hx = autodiff::hessian(hfunc, wrt(x), at(x), u, g);
+            Eigen::ArrayXd gg = g.cast<double>();
+            Psir = getbaseval(u);
+            dPsirdT = gg[0];
+            grad = gg.tail(N);
+            dgraddT = Hx.col(0).tail(N).array();
+            H = Hx.bottomRightCorner(N, N);
+        }
+        else if (flags.dp || flags.dn) {
+            std::tie(Psir, grad, H) = build_Psir_fgradHessian_autodiff(model, T, rhovec);
+        }
+        else {
+            std::tie(Psir, grad) = build_Psir_fgrad(model, T, rhovec);
+        }
+        const auto molefrac = (rhovec / rhovec.sum()).eval();
+        return build_fugacity_coefficients(model.R(molefrac), T, rhovec, Psir, grad, H, dPsirdT, dgraddT, flags);
     }
     
     template<ADBackends be = ADBackends::autodiff>
@@ -1242,6 +1466,39 @@ struct IsochoricDerivatives{
     }
 };
 
+namespace internal{
+
+    /// Set the gradient part of the nested dual number at the given level (0 is the outermost level) to unity
+    template<typename DualType>
+    void seed_nested_level(DualType& d, const int level){
+        if (level == 0){
+            d.grad = 1.0;
+        }
+        else if constexpr (!std::is_arithmetic_v<std::decay_t<decltype(d.val)>>){
+            seed_nested_level(d.val, level-1);
+        }
+    }
+
+    /// Extract one coefficient of a nested dual number; the gradient part is taken at the levels whose bit is set in mask (bit 0 is the outermost level), and the value part otherwise
+    template<typename DualType>
+    double get_nested_coeff(const DualType& d, const unsigned int mask){
+        if constexpr (std::is_arithmetic_v<DualType>){
+            return d;
+        }
+        else{
+            return (mask & 1u) ? get_nested_coeff(d.grad, mask >> 1) : get_nested_coeff(d.val, mask >> 1);
+        }
+    }
+}
+
+/**
+ Hold the matrix of derivatives \f$\Lambda_{ij}\f$ for \f$i,j \leq\f$ Nderivsmax
+ 
+ All the derivatives are obtained from a single evaluation of alpha with nested dual numbers that have 2*Nderivsmax levels.
+ The first Nderivsmax levels are seeded in \f$1/T\f$ and the remaining levels in \f$\rho\f$, so the derivative of order \f$i\f$ in \f$1/T\f$ and order \f$j\f$ in
+ \f$\rho\f$ is the coefficient obtained by taking the gradient part of the first \f$i\f$ levels of each group. In this way, the
+ setup of the model (reducing functions, diameters, etc.) is only carried out once for the whole matrix.
+ */
 template<int Nderivsmax, AlphaWrapperOption opt>
 class DerivativeHolderSquare{
     
@@ -1250,21 +1507,25 @@ public:
     
     template<typename Model, typename Scalar, typename VecType>
     DerivativeHolderSquare(const Model& model, const Scalar& T, const Scalar& rho, const VecType& z) {
-        using tdx = TDXDerivatives<decltype(model), Scalar, VecType>;
-        static_assert(Nderivsmax == 2, "It's gotta be 2 for now");
+        static_assert(Nderivsmax > 0 && 2*Nderivsmax < 8*sizeof(unsigned int), "Nderivsmax is out of range");
         AlphaCallWrapper<opt, Model> wrapper(model);
         
-        auto AX02 = tdx::template get_Agen0n<2>(wrapper, T, rho, z);
-        derivs(0, 0) = AX02[0];
-        derivs(0, 1) = AX02[1];
-        derivs(0, 2) = AX02[2];
-        
-        auto AX20 = tdx::template get_Agenn0<2>(wrapper, T, rho, z);
-        derivs(0, 0) = AX20[0];
-        derivs(1, 0) = AX20[1];
-        derivs(2, 0) = AX20[2];
+        using adtype = autodiff::HigherOrderDual<2*Nderivsmax, double>;
+        adtype Trecipad = 1.0/T, rhoad = rho;
+        for (auto k = 0; k < Nderivsmax; ++k){
+            internal::seed_nested_level(Trecipad, k);
+            internal::seed_nested_level(rhoad, Nderivsmax + k);
+        }
+        adtype Tad = 1.0/Trecipad;
+        adtype alpha = forceeval(wrapper.alpha(Tad, rhoad, z));
         
-        derivs(1, 1) = tdx::template get_Agenxy<1,1>(wrapper, T, rho, z);
+        Scalar Trecip = 1.0/T;
+        for (auto i = 0; i <= Nderivsmax; ++i){
+            for (auto j = 0; j <= Nderivsmax; ++j){
+                unsigned int mask = ((1u << i) - 1u) | (((1u << j) - 1u) << Nderivsmax);
+                derivs(i, j) = powi(Trecip, i)*powi(rho, j)*internal::get_nested_coeff(alpha, mask);
+            }
+        }
     }
 };
 
@@ -4,6 +4,10 @@
 #include <set>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include "teqp/exceptions.hpp"
 
 namespace teqp{
@@ -25,6 +29,68 @@ namespace teqp{
         }
     }
 
+    /**
+     A process-wide cache of parsed JSON files, keyed by the absolute path of the file.
+     
+     The modification time and the size of the file are checked at every lookup, and the file is parsed again if
+     either of them has changed. The contents are not compared, so an edit that keeps the size and falls within the
+     granularity of the modification time of the file system is not detected; call clear() after rewriting a file in
+     place in that way. The parsed data are shared and immutable, so any number of threads can use them at the same time.
+     */
+    class JSONFileCache {
+    private:
+        struct Entry {
+            std::filesystem::file_time_type mtime;
+            std::uintmax_t size;
+            std::shared_ptr<const nlohmann::json> data;
+        };
+        std::unordered_map<std::string, Entry> entries;
+        mutable std::shared_mutex mtx;
+    public:
+        /// The instance shared by the whole process
+        static JSONFileCache& instance() {
+            static JSONFileCache cache;
+            return cache;
+        }
+        
+        /// Get the parsed contents of the file, parsing it only if it is not in the cache or it has changed since it was parsed
+        std::shared_ptr<const nlohmann::json> get(const std::string& path) {
+            if (!std::filesystem::is_regular_file(path)) {
+                throw std::invalid_argument("Path to be loaded does not exist: " + path);
+            }
+            const auto key = std::filesystem::absolute(path).lexically_normal().string();
+            const auto mtime = std::filesystem::last_write_time(path);
+            const auto size = std::filesystem::file_size(path);
+            {
+                std::shared_lock<std::shared_mutex> lock(mtx);
+                auto it = entries.find(key);
+                if (it != entries.end() && it->second.mtime == mtime && it->second.size == size) {
+                    return it->second.data;
+                }
+            }
+            // Parse without holding the lock; if two threads miss at the same time, both parse and the last one wins
+            auto data = std::make_shared<const nlohmann::json>(load_a_JSON_file(path));
+            std::unique_lock<std::shared_mutex> lock(mtx);
+            entries[key] = Entry{mtime, size, data};
+            return data;
+        }
+        /// Drop all the cached files
+        void clear() {
+            std::unique_lock<std::shared_mutex> lock(mtx);
+            entries.clear();
+        }
+        /// The number of files in the cache
+        std::size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(mtx);
+            return entries.size();
+        }
+    };
+    
+    /// Load a JSON file via the process-wide JSONFileCache; the returned data must not be modified
+    inline std::shared_ptr<const nlohmann::json> load_a_JSON_file_cached(const std::string& path) {
+        return JSONFileCache::instance().get(path);
+    }
+
     inline auto all_same_length(const nlohmann::json& j, const std::vector<std::string>& ks) {
         std::set<decltype(j[0].size())> lengths;
         for (auto k : ks) { lengths.insert(j.at(k).size()); }
@@ -63,12 +129,13 @@ namespace teqp{
     A method for loading something from a nlohmann::json node. Thing to be operated on can be:
     
      0. empty, in which case the file at the default_path is loaded
-     1. An object node, in which case it is returned
+     1. An object node or a non-empty array node, in which case it is returned
      2. A path as a string. If this file exists, it will be loaded
      3. A JSON-encoded string
      
+     Files are loaded via the JSONFileCache, so the returned data are shared and must not be modified
      */
-    inline auto multilevel_JSON_load(const nlohmann::json &j, const std::string& default_path){
+    inline std::shared_ptr<const nlohmann::json> multilevel_JSON_load_shared(const nlohmann::json &j, const std::string& default_path){
         
         auto is_valid_path = [](const std::string & s){
             try{
@@ -82,11 +149,11 @@ namespace teqp{
         
         // If not provided (NULL, empty array or empty string), load from the default path provided
         if (j.is_null() || (j.is_array() && j.empty()) || (j.is_string() && j.get<std::string>().empty())){
-            return load_a_JSON_file(default_path);
+            return load_a_JSON_file_cached(default_path);
         }
-        else if (j.is_object()){
+        else if (j.is_object() || j.is_array()){
             // Assume we are already providing the thing
-            return j;
+            return std::make_shared<const nlohmann::json>(j);
         }
         else if (j.is_string()){
             // If a string, either data in JSON format, or a path-like thing
@@ -94,15 +161,20 @@ namespace teqp{
             
             // If path to existing file, use it
             if (is_valid_path(s) && std::filesystem::is_regular_file(s)){
-                return load_a_JSON_file(s);
+                return load_a_JSON_file_cached(s);
             }
             // Or assume it is a string in JSON format
             else{
-                return nlohmann::json::parse(s);
+                return std::make_shared<const nlohmann::json>(nlohmann::json::parse(s));
             }
         }
         else{
             throw teqp::InvalidArgument("Unable to load the argument to multilevel_JSON_load");
         }
     }
+    
+    /// The version of multilevel_JSON_load_shared that returns a copy of the data
+    inline nlohmann::json multilevel_JSON_load(const nlohmann::json &j, const std::string& default_path){
+        return *multilevel_JSON_load_shared(j, default_path);
+    }
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "nlohmann/json.hpp"
+#include "teqp/models/saft/association.hpp"
+#include "teqp/models/cubicanalytic.hpp"
+#include <optional>
 
 namespace teqp {
 
@@ -17,16 +20,58 @@ inline auto get_association_classes(const std::string& s) {
     else if (s == "2B") { return association_classes::a2B; }
     else if (s == "3B") { return association_classes::a3B; }
     else if (s == "4C") { return association_classes::a4C; }
+    else if (s == "not_associating") { return association_classes::not_associating; }
     else {
         throw std::invalid_argument("bad association flag:" + s);
     }
 }
 
+/// The association sites of each class, in terms of electron donor (e) and proton donor (H) sites,
+/// and a single site (A) for the 1A scheme that can bond with any other site
+inline auto get_association_sites(association_classes cl) -> std::vector<std::string> {
+    switch (cl) {
+    case association_classes::a1A: return {"A"};
+    case association_classes::a2B: return {"e", "H"};
+    case association_classes::a3B: return {"e", "e", "H"};
+    case association_classes::a4C: return {"e", "e", "H", "H"};
+    case association_classes::not_associating: return {};
+    default: throw std::invalid_argument("Bad association class");
+    }
+}
+
+/// The interaction partners that go with the sites of get_association_sites
+inline auto get_CPA_association_options(){
+    association::AssociationOptions options;
+    options.interaction_partners = {{"e", {"H", "A"}}, {"H", {"e", "A"}}, {"A", {"A", "e", "H"}}};
+    return options;
+}
+
 enum class radial_dist { CS, KG, OT };
+inline auto get_radial_dist(const std::string& s) {
+    if (s == "CS") { return radial_dist::CS; }
+    else if (s == "KG") { return radial_dist::KG; }
+    else if (s == "OT") { return radial_dist::OT; }
+    else {
+        throw std::invalid_argument("bad radial_dist flag:" + s);
+    }
+}
 
-/// Function that calculates the association binding strength between site A of molecule i and site B on molecule j
-template<typename BType, typename TType, typename RhoType, typename VecType>
-inline auto get_DeltaAB_pure(radial_dist dist, double epsABi, double betaABi, BType b_cubic, TType RT, RhoType rhomolar, const VecType& molefrac) {
+/// Combining rules for the cross-association between components i and j
+enum class association_combining_rule {
+    CR1, ///< epsilon_ij = (epsilon_i+epsilon_j)/2, beta_ij = sqrt(beta_i*beta_j)
+    ECR ///< Elliott's rule, Delta_ij = sqrt(Delta_i*Delta_j)
+};
+inline auto get_association_combining_rule(const std::string& s) {
+    if (s == "CR1") { return association_combining_rule::CR1; }
+    else if (s == "ECR") { return association_combining_rule::ECR; }
+    else {
+        throw std::invalid_argument("bad combining rule:" + s);
+    }
+}
+
+/// The contact value of the radial distribution function, a function of the mixture covolume and the density
+template<typename BType, typename RhoType>
+inline auto get_g_contact(radial_dist dist, BType b_cubic, RhoType rhomolar) {
 
     using eta_type = std::common_type_t<decltype(rhomolar), decltype(b_cubic)>;
     eta_type eta;
@@ -55,64 +100,8 @@ inline auto get_DeltaAB_pure(radial_dist dist, double epsABi, double betaABi, BT
         }
     }
 
-    // Calculate the association strength between site Ai and Bi for a pure compent
-    auto DeltaAiBj = forceeval(g_vm_ref*(exp(epsABi/RT) - 1.0)*b_cubic* betaABi);
-
-    return DeltaAiBj;
-};
-
-/// Routine that calculates the fractions of sites Ai not bound to other active sites for pure fluids
-/// Some association schemes are explicitly solvable for self-associating compounds, see Huang and Radosz, Ind. Eng. Chem. Res., 29 (11), 1990
-/// So far implemented association schemes : 1A, 2B, 3B, 4C (see Kontogeorgis et al., Ind. Eng. Chem. Res. 2006, 45, 4855 - 4868)
-/// 
-
-template<typename BType, typename TType, typename RhoType, typename VecType>
-inline auto XA_calc_pure(int N_sites, association_classes scheme, double epsABi, double betaABi, const BType b_cubic, const TType RT, const RhoType rhomolar, const VecType& molefrac) {
-
-    // Matrix XA(A, j) that contains all of the fractions of sites A not bonded to other active sites for each molecule i
-    // Start values for the iteration(set all sites to non - bonded, = 1)
-    using result_type = std::common_type_t<decltype(RT), decltype(rhomolar), decltype(molefrac[0])>;
-    Eigen::Array<result_type, Eigen::Dynamic, Eigen::Dynamic> XA;  // A maximum of 4 association sites(A, B, C, D)
-    XA.resize(N_sites, 1);
-    XA.setOnes();
-
-    // Get the association strength between the associating sites
-    auto dist = radial_dist::KG; // TODO: pass this in
-    auto DeltaAiBj = get_DeltaAB_pure(dist, epsABi, betaABi, b_cubic, RT, rhomolar, molefrac);
-
-    if (scheme == association_classes::a1A) { // Acids
-        // Only one association site "A"  (OH - group with C = O - group)
-        XA(0, 0) = forceeval((-1.0 + sqrt(1.0 + 4.0 * rhomolar * DeltaAiBj)) / (2.0 * rhomolar * DeltaAiBj));
-    }
-    else if (scheme == association_classes::a2B) { // Alcohols
-        // Two association sites "A" and "B"
-        XA(0, 0) = forceeval((-1.0 + sqrt(1.0 + 4.0 * rhomolar * DeltaAiBj)) / (2.0 * rhomolar * DeltaAiBj));
-        XA(1, 0) = XA(0, 0);   // XB = XA;
-    }
-    else if (scheme == association_classes::a3B) { // Glycols
-        // Three association sites "A", "B", "C"
-        XA(0, 0) = forceeval((-(1.0 - rhomolar * DeltaAiBj) + sqrt(POW2(1.0 + rhomolar * DeltaAiBj) + 4.0 * rhomolar * DeltaAiBj)) / (4.0 * rhomolar * DeltaAiBj));
-        XA(1, 0) = XA(0, 0);           // XB = XA
-        XA(2, 0) = 2.0*XA(0, 0) - 1.0; // XC = 2XA - 1
-    }
-    else if (scheme == association_classes::a4C) { // Water
-        // Four association sites "A", "B", "C", "D"
-        XA(0, 0) = forceeval((-1.0 + sqrt(1.0 + 8.0 * rhomolar * DeltaAiBj)) / (4.0 * rhomolar * DeltaAiBj));
-        XA(1, 0) = XA(0, 0);   // XB = XA
-        XA(2, 0) = XA(0, 0);   // XC = XA
-        XA(3, 0) = XA(0, 0);   // XD = XA
-    }
-    else if (scheme == association_classes::not_associating) { // non - associating compound
-        XA(0, 0) = 1;
-        XA(1, 0) = 1;
-        XA(2, 0) = 1;
-        XA(3, 0) = 1;
-    }
-    else {
-        throw std::invalid_argument("Bad scheme");
-    }
-    return XA;
-};
+    return g_vm_ref;
+}
 
 enum class cubic_flag {not_set, PR, SRK};
 inline auto get_cubic_flag(const std::string& s) {
@@ -130,6 +119,8 @@ private:
     double delta_1, delta_2;
     std::valarray<std::valarray<double>> k_ij;
     double R_gas;
+    Eigen::ArrayXXd one_minus_kij;
+    std::optional<CubicAnalytic::SqrtTQuadratic> a_sqrtT; ///< sqrt(a_i) = sqrt(a0_i)(1+c1_i) - sqrt(a0_i)c1_i/sqrt(Tc_i)*sqrt(T)
 
 public:
     CPACubic(cubic_flag flag, const std::valarray<double> &a0, const std::valarray<double> &bi, const std::valarray<double> &c1, const std::valarray<double> &Tc, double R_gas) : a0(a0), bi(bi), c1(c1), Tc(Tc), R_gas(R_gas) {
@@ -142,10 +133,24 @@ public:
             throw std::invalid_argument("Bad cubic flag");
         }
         k_ij.resize(Tc.size()); for (auto i = 0; i < k_ij.size(); ++i) { k_ij[i].resize(Tc.size()); }
+        
+        const auto N = Tc.size();
+        one_minus_kij.resize(N, N);
+        Eigen::ArrayXd A(N), B(N);
+        for (auto i = 0U; i < N; ++i) {
+            for (auto j = 0U; j < N; ++j) {
+                one_minus_kij(i, j) = 1.0 - k_ij[i][j];
+            }
+            A[i] = sqrt(a0[i]) * (1.0 + c1[i]);
+            B[i] = sqrt(a0[i]) * c1[i] / sqrt(Tc[i]);
+        }
+        a_sqrtT.emplace(A, B, one_minus_kij);
     };
 
     template<typename VecType>
     auto R(const VecType& molefrac) const { return R_gas; }
+    
+    const auto& get_bi() const { return bi; }
 
     template<typename TType>
     auto get_ai(TType T, int i) const {
@@ -176,57 +181,130 @@ public:
             -a_cubic/R_gas/T*log((delta_1*b_cubic*rhomolar + 1.0) / (delta_2*b_cubic*rhomolar + 1.0)) / b_cubic / (delta_1 - delta_2) // attractive part
         );
     }
+    
+    /// The derivative \f$\Lambda^{\rm r}_{xy}\f$ in closed form, see CubicAnalytic::get_Arxy; no value for arguments that are not double
+    template<int iT, int iD, typename TType, typename RhoType, typename VecType>
+    std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
+        using x_t = std::decay_t<decltype(molefrac[0])>;
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<RhoType, double> || !std::is_same_v<x_t, double>) {
+            return std::nullopt;
+        }
+        else if constexpr (iT == 0 && iD == 0) {
+            return alphar(T, rhomolar, molefrac);
+        }
+        else {
+            double b_cubic = 0.0;
+            for (auto i = 0; i < molefrac.size(); ++i) {
+                b_cubic += molefrac[i] * bi[i];
+            }
+            auto abeta = CubicAnalytic::get_abeta_deriv<iT>(T, a_sqrtT.value().get_coeffs(molefrac));
+            return CubicAnalytic::get_Arxy<iT, iD>(R_gas, abeta, b_cubic, rhomolar, delta_1, delta_2);
+        }
+    }
+    
+    /// The gradient of \f$\Psi^{\rm r}\f$ w.r.t. the molar concentrations in closed form; no value for arguments that are not double
+    template<typename TType, typename RhoVecType>
+    std::optional<Eigen::ArrayXd> get_Psir_gradient_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<std::decay_t<decltype(rhovec[0])>, double>) {
+            return std::nullopt;
+        }
+        else {
+            return std::get<1>(get_Psir_derivs<false>(T, rhovec));
+        }
+    }
+    
+    /// The value, gradient and Hessian of \f$\Psi^{\rm r}\f$ w.r.t. the molar concentrations in closed form; no value for arguments that are not double
+    template<typename TType, typename RhoVecType>
+    std::optional<std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd>> get_Psir_fgradHessian_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<std::decay_t<decltype(rhovec[0])>, double>) {
+            return std::nullopt;
+        }
+        else {
+            return get_Psir_derivs<true>(T, rhovec);
+        }
+    }
+    
+private:
+    template<bool Hessian, typename RhoVecType>
+    auto get_Psir_derivs(double T, const RhoVecType& rhovec) const {
+        const auto N = Tc.size();
+        if (static_cast<std::size_t>(rhovec.size()) != N) {
+            throw std::invalid_argument("Sizes do not match");
+        }
+        Eigen::ArrayXd rho(N), b(N), s(N);
+        for (auto i = 0U; i < N; ++i) {
+            rho[i] = rhovec[i];
+            b[i] = bi[i];
+            s[i] = sqrt(get_ai(T, i));
+        }
+        return CubicAnalytic::get_Psir_derivs<Hessian>(R_gas * T, rho, b, one_minus_kij, s, delta_1, delta_2);
+    }
 };
 
+/**
+ The association contribution of CPA, for pure fluids and mixtures
+
+ The association strength between site A of molecule i and site B of molecule j is
+ \f$\Delta^{A_iB_j} = g(\rho)[\exp(\varepsilon_{ij}/(RT))-1]b_{ij}\beta_{ij}\f$ with \f$b_{ij}=(b_i+b_j)/2\f$ and the
+ cross parameters from the CR-1 combining rule, or \f$\Delta^{A_iB_j} = \sqrt{\Delta^{A_iB_i}\Delta^{A_jB_j}}\f$ with the
+ ECR rule. The fractions of non-bonded sites are solved with association::solve_X
+ */
 template<typename Cubic>
 class CPAAssociation {
 private:
     const Cubic cubic;
     const std::vector<association_classes> classes;
     const std::valarray<double> epsABi, betaABi;
-    const std::vector<int> N_sites; 
     const double R_gas;
-
-    auto get_N_sites(const std::vector<association_classes> &classes) {
-        std::vector<int> N_sites_out;
-        auto get_N = [](auto cl) {
-            switch (cl) {
-            case association_classes::a1A: return 1;
-            case association_classes::a2B: return 2;
-            case association_classes::a3B: return 3;
-            case association_classes::a4C: return 4;
-            default: throw std::invalid_argument("Bad association class");
-            }
-        };
-        for (auto cl : classes) {  
-            N_sites_out.push_back(get_N(cl));
+    const association_combining_rule combining;
+    const radial_dist dist;
+    const association::AssociationOptions options;
+    const association::AssociationSites sites;
+
+    static auto get_molecule_sites(const std::vector<association_classes> &classes) {
+        std::vector<std::vector<std::string>> molecule_sites;
+        for (auto cl : classes) {
+            molecule_sites.push_back(get_association_sites(cl));
         }
-        return N_sites_out;
+        return molecule_sites;
     }
 
 public:
-    CPAAssociation(const Cubic &&cubic, const std::vector<association_classes>& classes, const std::valarray<double> &epsABi, const std::valarray<double> &betaABi, double R_gas) 
-        : cubic(cubic), classes(classes), epsABi(epsABi), betaABi(betaABi), N_sites(get_N_sites(classes)), R_gas(R_gas) {};
+    CPAAssociation(const Cubic &&cubic, const std::vector<association_classes>& classes, const std::valarray<double> &epsABi, const std::valarray<double> &betaABi, double R_gas, association_combining_rule combining = association_combining_rule::CR1, radial_dist dist = radial_dist::KG)
+        : cubic(cubic), classes(classes), epsABi(epsABi), betaABi(betaABi), R_gas(R_gas), combining(combining), dist(dist), options(get_CPA_association_options()), sites(get_molecule_sites(classes), options) {};
 
+    const auto& get_sites() const { return sites; }
+
+    /// The association strength between each pair of unique sites
     template<typename TType, typename RhoType, typename VecType>
-    auto alphar(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
-        // Calculate a and b of the mixture
-        auto [a_cubic, b_cubic] = cubic.get_ab(T, molefrac);
-
-        // Calculate the fraction of sites not bonded with other active sites
-        auto RT = forceeval(R_gas * T); // R times T
-        auto XA = XA_calc_pure(N_sites[0], classes[0], epsABi[0], betaABi[0], b_cubic, RT, rhomolar, molefrac);
-
-        using return_type = std::common_type_t<decltype(T), decltype(rhomolar), decltype(molefrac[0])>;
-        return_type alpha_r_asso = 0.0;
-        auto i = 0;
-        for (auto xi : molefrac){ // loop over all components
-            auto XAi = XA.col(i);
-            alpha_r_asso += forceeval(xi * (log(XAi) - XAi / 2).sum());
-            alpha_r_asso += xi*static_cast<double>(N_sites[i])/2;
-            i++;
+    auto get_Delta(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
+        const auto& bi = cubic.get_bi();
+        std::common_type_t<TType, std::decay_t<decltype(molefrac[0])>> b_cubic = 0.0;
+        for (auto i = 0; i < molefrac.size(); ++i) {
+            b_cubic += molefrac[i]*bi[i];
         }
-        return forceeval(alpha_r_asso);
+        auto g = forceeval(get_g_contact(dist, b_cubic, rhomolar));
+        auto RT = forceeval(R_gas*T);
+
+        if (combining == association_combining_rule::ECR) {
+            return association::get_site_Delta(sites, [&](std::size_t i, std::size_t j) {
+                return forceeval(g*sqrt(bi[i]*betaABi[i]*(exp(epsABi[i]/RT) - 1.0)*bi[j]*betaABi[j]*(exp(epsABi[j]/RT) - 1.0)));
+            });
+        }
+        return association::get_site_Delta(sites, [&](std::size_t i, std::size_t j) {
+            return forceeval(g*(exp((epsABi[i] + epsABi[j])/2.0/RT) - 1.0)*(bi[i] + bi[j])/2.0*sqrt(betaABi[i]*betaABi[j]));
+        });
+    }
+
+    /// The fractions of non-bonded sites, in the order of the unique sites
+    template<typename TType, typename RhoType, typename VecType>
+    auto get_X(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
+        return association::solve_X(sites, get_Delta(T, rhomolar, molefrac), rhomolar, molefrac, options);
+    }
+
+    template<typename TType, typename RhoType, typename VecType>
+    auto alphar(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
+        return association::get_alphar(sites, get_X(T, rhomolar, molefrac), molefrac);
     }
 };
 
@@ -257,6 +335,33 @@ public:
 
         return forceeval(alpha_r_cubic + alpha_r_assoc);
     }
+    
+    /// The closed-form derivatives of the cubic part, which is the whole model if no component associates; otherwise no value, so that autodiff is used
+    template<int iT, int iD, typename TType, typename RhoType, typename VecType>
+    std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rhomolar, const VecType& molefrac) const {
+        if (assoc.get_sites().size() > 0) {
+            return std::nullopt;
+        }
+        return cubic.template get_Arxy_analytic<iT, iD>(T, rhomolar, molefrac);
+    }
+    
+    /// The closed-form gradient of \f$\Psi^{\rm r}\f$ of the cubic part, if no component associates
+    template<typename TType, typename RhoVecType>
+    std::optional<Eigen::ArrayXd> get_Psir_gradient_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if (assoc.get_sites().size() > 0) {
+            return std::nullopt;
+        }
+        return cubic.get_Psir_gradient_analytic(T, rhovec);
+    }
+    
+    /// The closed-form value, gradient and Hessian of \f$\Psi^{\rm r}\f$ of the cubic part, if no component associates
+    template<typename TType, typename RhoVecType>
+    std::optional<std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd>> get_Psir_fgradHessian_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if (assoc.get_sites().size() > 0) {
+            return std::nullopt;
+        }
+        return cubic.get_Psir_fgradHessian_analytic(T, rhovec);
+    }
 };
 
 /// A factory function to return an instantiated CPA instance given
@@ -286,7 +391,9 @@ inline auto CPAfactory(const nlohmann::json &j){
             classes.push_back(get_association_classes(p["class"]));
             i++;
         }
-        return CPAAssociation(std::move(cubic), classes, epsABi, betaABi, j["R_gas / J/mol/K"]);
+        auto combining = (j.contains("combining")) ? get_association_combining_rule(j["combining"]) : association_combining_rule::CR1;
+        auto dist = (j.contains("radial_dist")) ? get_radial_dist(j["radial_dist"]) : radial_dist::KG;
+        return CPAAssociation(std::move(cubic), classes, epsABi, betaABi, j["R_gas / J/mol/K"], combining, dist);
     };
 	return CPAEOS(build_cubic(j), build_assoc(build_cubic(j), j));
 }
@@ -0,0 +1,188 @@
+#pragma once
+
+/**
+ Closed-form derivatives of the residual Helmholtz energy of the cubic equations of state of the form
+ \f[
+ \alpha^{\rm r} = -\ln(1-b\rho) - \frac{a}{RT}\frac{1}{b(\Delta_1-\Delta_2)}\ln\left(\frac{1+\Delta_1b\rho}{1+\Delta_2b\rho}\right)
+ \f]
+ shared by the GenericCubic and the cubic part of CPA. Only double precision arguments are handled; the
+ models return no value otherwise, so that the derivatives are obtained with automatic differentiation
+ */
+
+#include <array>
+#include <cmath>
+#include <tuple>
+
+#include "teqp/types.hpp"
+
+#include <Eigen/Dense>
+
+namespace teqp {
+
+namespace CubicAnalytic {
+
+/**
+ The attractive parameter of a mixture written as \f$a(T) = \vec{x}^TM_0\vec{x} - \sqrt{T}\,\vec{x}^TM_1\vec{x} + T\,\vec{x}^TM_2\vec{x}\f$
+
+ This form is exact when \f$\sqrt{a_i\alpha_i(T)} = A_i - B_i\sqrt{T}\f$ for each component, as for the alpha function of Soave, in which case
+ \f$M_0 = K\circ AA^T\f$, \f$M_1 = K\circ(AB^T+BA^T)\f$ and \f$M_2 = K\circ BB^T\f$ with \f$K_{ij} = 1-k_{ij}\f$
+ */
+struct SqrtTQuadratic {
+    Eigen::MatrixXd M0, M1, M2;
+
+    SqrtTQuadratic(const Eigen::ArrayXd& A, const Eigen::ArrayXd& B, const Eigen::ArrayXXd& K)
+    : M0((K * (A.matrix() * A.matrix().transpose()).array()).matrix()),
+      M1((K * (A.matrix() * B.matrix().transpose() + B.matrix() * A.matrix().transpose()).array()).matrix()),
+      M2((K * (B.matrix() * B.matrix().transpose()).array()).matrix()) {}
+
+    /// The coefficients \f$c_0\f$, \f$c_1\f$, \f$c_2\f$ of \f$a(T) = c_0 - c_1\sqrt{T} + c_2T\f$ for the given mole fractions
+    template<typename VecType>
+    std::array<double, 3> get_coeffs(const VecType& molefrac) const {
+        const auto N = M0.rows();
+        std::array<double, 3> c = { 0.0, 0.0, 0.0 };
+        for (auto i = 0; i < N; ++i) {
+            double s0 = 0, s1 = 0, s2 = 0;
+            for (auto j = 0; j < N; ++j) {
+                s0 += M0(i, j) * molefrac[j];
+                s1 += M1(i, j) * molefrac[j];
+                s2 += M2(i, j) * molefrac[j];
+            }
+            c[0] += molefrac[i] * s0;
+            c[1] += molefrac[i] * s1;
+            c[2] += molefrac[i] * s2;
+        }
+        return c;
+    }
+};
+
+/// \f$\rho^n\partial^n/\partial\rho^n\f$ of \f$-\ln(1-B)\f$, with \f$B=b\rho\f$, which is \f$(n-1)!(B/(1-B))^n\f$ for \f$n>0\f$
+template<int iD>
+double get_Psiminus_deriv(double B) {
+    if constexpr (iD == 0) {
+        return -log1p(-B);
+    }
+    else {
+        double factorial = 1.0; // (n-1)!
+        for (auto k = 2; k < iD; ++k) {
+            factorial *= k;
+        }
+        return factorial * powi(B / (1.0 - B), iD);
+    }
+}
+
+/// \f$\rho^n\partial^n/\partial\rho^n\f$ of \f$\ln[(1+\Delta_1B)/(1+\Delta_2B)]/(b(\Delta_1-\Delta_2))\f$, from \f$\rho^n\partial^n\ln(1+\Delta B)/\partial\rho^n = (-1)^{n-1}(n-1)!(\Delta B/(1+\Delta B))^n\f$ for \f$n>0\f$
+template<int iD>
+double get_Psiplus_deriv(double b, double B, double Delta1, double Delta2) {
+    if constexpr (iD == 0) {
+        return (log1p(Delta1 * B) - log1p(Delta2 * B)) / (b * (Delta1 - Delta2));
+    }
+    else {
+        double factorial = 1.0; // (n-1)!
+        for (auto k = 2; k < iD; ++k) {
+            factorial *= k;
+        }
+        const double sign = (iD % 2 == 1) ? 1.0 : -1.0;
+        return sign * factorial * (powi(Delta1 * B / (1.0 + Delta1 * B), iD) - powi(Delta2 * B / (1.0 + Delta2 * B), iD)) / (b * (Delta1 - Delta2));
+    }
+}
+
+/**
+ \f$\beta^n\partial^n(a\beta)/\partial\beta^n\f$ with \f$\beta=1/T\f$, for \f$a = c_0 - c_1\sqrt{T} + c_2T\f$ so that \f$a\beta = c_0\beta - c_1\beta^{1/2} + c_2\f$, and
+ \f$\beta^n\partial^n\beta^p/\partial\beta^n = p(p-1)\cdots(p-n+1)\beta^p\f$
+ */
+template<int iT>
+double get_abeta_deriv(double T, const std::array<double, 3>& c) {
+    if constexpr (iT == 0) {
+        return (c[0] - c[1] * sqrt(T) + c[2] * T) / T;
+    }
+    else {
+        double falling = 1.0; // (1/2)(1/2-1)...(1/2-n+1)
+        for (auto k = 0; k < iT; ++k) {
+            falling *= 0.5 - k;
+        }
+        return ((iT == 1) ? c[0] / T : 0.0) - c[1] * falling / sqrt(T);
+    }
+}
+
+/**
+ \f$\Lambda^{\rm r}_{xy}\f$ given \f$\beta^x\partial^x(a\beta)/\partial\beta^x\f$ from get_abeta_deriv (or \f$a/T\f$ for \f$x=0\f$); the repulsive part only contributes for \f$x=0\f$
+ */
+template<int iT, int iD>
+double get_Arxy(double R, double abeta_deriv, double b, double rho, double Delta1, double Delta2) {
+    const double B = b * rho;
+    const double Psiplus = get_Psiplus_deriv<iD>(b, B, Delta1, Delta2);
+    if constexpr (iT == 0) {
+        return get_Psiminus_deriv<iD>(B) - abeta_deriv / R * Psiplus;
+    }
+    else {
+        return -abeta_deriv / R * Psiplus;
+    }
+}
+
+/**
+ The function \f$F(v) = \ln[(1+\Delta_1v)/(1+\Delta_2v)]/(v(\Delta_1-\Delta_2))\f$ and its first two derivatives. Close to \f$v=0\f$ the closed forms
+ lose digits to cancellation, so the series \f$F = \sum_n (-1)^n\frac{\Delta_1^{n+1}-\Delta_2^{n+1}}{(n+1)(\Delta_1-\Delta_2)}v^n\f$ is summed instead
+ */
+inline std::array<double, 3> get_F(double v, double Delta1, double Delta2) {
+    const double c = Delta1 - Delta2;
+    if (std::abs(v) * std::max(std::abs(Delta1), std::abs(Delta2)) < 0.1) {
+        constexpr int Nterms = 24;
+        std::array<double, Nterms> f;
+        double p1 = Delta1, p2 = Delta2, sign = 1.0;
+        for (auto n = 0; n < Nterms; ++n) {
+            f[n] = sign * (p1 - p2) / (c * (n + 1));
+            p1 *= Delta1; p2 *= Delta2; sign = -sign;
+        }
+        double F = 0, F1 = 0, F2 = 0;
+        for (auto n = Nterms - 1; n >= 0; --n) {
+            F = F * v + f[n];
+            if (n >= 1) { F1 = F1 * v + n * f[n]; }
+            if (n >= 2) { F2 = F2 * v + n * (n - 1) * f[n]; }
+        }
+        return { F, F1, F2 };
+    }
+    const double L = log1p(Delta1 * v) - log1p(Delta2 * v);
+    const double L1 = Delta1 / (1.0 + Delta1 * v) - Delta2 / (1.0 + Delta2 * v);
+    const double L2 = -pow2(Delta1 / (1.0 + Delta1 * v)) + pow2(Delta2 / (1.0 + Delta2 * v));
+    return { L / (c * v), (L1 * v - L) / (c * v * v), (L2 * v * v - 2.0 * L1 * v + 2.0 * L) / (c * v * v * v) };
+}
+
+/**
+ \brief The residual Helmholtz energy density \f$\Psi^{\rm r} = \rho RT\alpha^{\rm r}\f$, its gradient, and (if Hessian is true) its Hessian w.r.t. the molar concentrations
+
+ With \f$v = \sum_i b_i\rho_i\f$, \f$A_{ij} = K_{ij}s_is_j\f$ (\f$s_i = \sqrt{a_i\alpha_i}\f$) and \f$Q = \vec\rho^TA\vec\rho\f$,
+ \f[
+ \Psi^{\rm r} = -RT\rho\ln(1-v) - QF(v)
+ \f]
+ \f[
+ \frac{\partial\Psi^{\rm r}}{\partial\rho_i} = -RT\ln(1-v) + \frac{RT\rho b_i}{1-v} - 2(A\vec\rho)_iF - QF'b_i
+ \f]
+ \f[
+ \frac{\partial^2\Psi^{\rm r}}{\partial\rho_i\partial\rho_j} = RT\left[\frac{b_i+b_j}{1-v} + \frac{\rho b_ib_j}{(1-v)^2}\right] - 2A_{ij}F - 2F'[(A\vec\rho)_ib_j + (A\vec\rho)_jb_i] - QF''b_ib_j
+ \f]
+ The Hessian is left empty if it is not requested
+ */
+template<bool Hessian>
+auto get_Psir_derivs(double RT, const Eigen::ArrayXd& rhovec, const Eigen::ArrayXd& b, const Eigen::ArrayXXd& K, const Eigen::ArrayXd& s, double Delta1, double Delta2) {
+    const double rho = rhovec.sum(), v = (b * rhovec).sum();
+    const Eigen::ArrayXd Arho = (K.matrix() * (s * rhovec).matrix()).array() * s;
+    const double Q = (rhovec * Arho).sum();
+    const auto [F, F1, F2] = get_F(v, Delta1, Delta2);
+    const double ln1mv = log1p(-v);
+
+    const double Psir = -RT * rho * ln1mv - Q * F;
+    Eigen::ArrayXd grad = -RT * ln1mv + RT * rho * b / (1.0 - v) - 2.0 * F * Arho - Q * F1 * b;
+    Eigen::MatrixXd H;
+    if constexpr (Hessian) {
+        const Eigen::VectorXd bb = b.matrix(), Ar = Arho.matrix();
+        H = (RT / (1.0 - v)) * (bb.rowwise().replicate(bb.size()) + bb.transpose().colwise().replicate(bb.size()));
+        H += (RT * rho / pow2(1.0 - v) - Q * F2) * (bb * bb.transpose());
+        H -= 2.0 * F * (K * (s.matrix() * s.matrix().transpose()).array()).matrix();
+        H -= 2.0 * F1 * (Ar * bb.transpose() + bb * Ar.transpose());
+    }
+    return std::make_tuple(Psir, grad, H);
+}
+
+}; // namespace CubicAnalytic
+
+}; // namespace teqp
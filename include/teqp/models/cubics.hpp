@@ -13,6 +13,7 @@ Implementations of the canonical cubic equations of state
 #include "teqp/constants.hpp"
 #include "teqp/exceptions.hpp"
 #include "cubicsuperancillary.hpp"
+#include "cubicanalytic.hpp"
 #include "teqp/json_tools.hpp"
 
 #include "nlohmann/json.hpp"
@@ -32,6 +33,9 @@ private:
 public:
     BasicAlphaFunction(NumType Tci, NumType mi) : Tci(Tci), mi(mi) {};
     
+    auto get_Tci() const { return Tci; }
+    auto get_mi() const { return mi; }
+    
     template<typename TType>
     auto operator () (const TType& T) const {
         return forceeval(pow2(forceeval(1.0 + mi * (1.0 - sqrt(T / Tci)))));
@@ -71,6 +75,8 @@ protected:
     int superanc_index;
     const AlphaFunctions alphas;
     Eigen::ArrayXXd kmat;
+    Eigen::ArrayXXd one_minus_kmat;
+    std::optional<CubicAnalytic::SqrtTQuadratic> a_sqrtT; ///< The attractive parameter as a quadratic in sqrt(T), if all the alpha functions allow it
     
     nlohmann::json meta;
     
@@ -93,6 +99,35 @@ protected:
         }
     };
     
+    /// The alpha function of Soave if that is what the alpha function is, otherwise nullptr
+    template<typename AlphaType>
+    static const BasicAlphaFunction<double>* get_basic_alpha(const AlphaType& alpha) {
+        if constexpr (std::is_same_v<AlphaType, BasicAlphaFunction<double>>) {
+            return &alpha;
+        }
+        else if constexpr (std::is_same_v<AlphaType, AlphaFunctionOptions>) {
+            return std::get_if<BasicAlphaFunction<double>>(&alpha);
+        }
+        else {
+            return nullptr;
+        }
+    }
+    
+    /// For the alpha function of Soave, sqrt(a_i*alpha_i) = A_i - B_i*sqrt(T), which gives the temperature derivatives in closed form
+    void build_a_sqrtT() {
+        const auto N = ai.size();
+        Eigen::ArrayXd A(N), B(N);
+        for (auto i = 0U; i < N; ++i) {
+            auto basic = get_basic_alpha(alphas[i]);
+            if (basic == nullptr) {
+                return;
+            }
+            A[i] = sqrt(ai[i]) * (1.0 + basic->get_mi());
+            B[i] = sqrt(ai[i]) * basic->get_mi() / sqrt(basic->get_Tci());
+        }
+        a_sqrtT.emplace(A, B, one_minus_kmat);
+    }
+    
 public:
     GenericCubic(NumType Delta1, NumType Delta2, NumType OmegaA, NumType OmegaB, int superanc_index, const std::valarray<NumType>& Tc_K, const std::valarray<NumType>& pc_Pa, const AlphaFunctions& alphas, const Eigen::ArrayXXd& kmat)
     : Delta1(Delta1), Delta2(Delta2), OmegaA(OmegaA), OmegaB(OmegaB), superanc_index(superanc_index), alphas(alphas), kmat(kmat)
@@ -104,6 +139,8 @@ public:
             bi[i] = OmegaB * Ru * Tc_K[i] / pc_Pa[i];
         }
         check_kmat(ai.size());
+        one_minus_kmat = 1.0 - kmat;
+        build_a_sqrtT();
     };
     
     void set_meta(const nlohmann::json& j) { meta = j; }
@@ -116,12 +153,31 @@ public:
         if (ai.size() != 1) {
             throw std::invalid_argument("function only available for pure species");
         }
-        const std::valarray<double> z = { 1.0 };
-        auto b = get_b(T, z);
-        auto Ttilde = R(z)*T*b/get_a(T,z);
+        auto [p, rhoL, rhoV] = superanc_VLE_T(T, 0);
+        return std::make_tuple(rhoL, rhoV);
+    }
+    
+    /// Whether superancillary equations are available for this cubic (only for the canonical PR and SRK)
+    bool has_superanc() const { return superanc_index != CubicSuperAncillary::UNKNOWN_CODE; }
+    
+    /**
+     Return a tuple of the saturation pressure and the saturated liquid and vapor densities of the pure component ifluid,
+     from the superancillary equations of Bell and Deiters in terms of \f$\tilde T = RTb/a\f$, with \f$\tilde p = pb^2/a\f$ and \f$\tilde\rho = \rho b\f$
+     */
+    std::tuple<double, double, double> superanc_VLE_T(double T, std::size_t ifluid = 0) const {
+        if (!has_superanc()) {
+            throw teqp::InvalidArgument("No superancillary equations are available for this cubic");
+        }
+        if (ifluid >= ai.size()) {
+            throw teqp::InvalidArgument("ifluid (" + std::to_string(ifluid) + ") must be less than the number of components (" + std::to_string(ai.size()) + ")");
+        }
+        const double alpha = std::visit([&](auto& t) { return t(T); }, alphas[ifluid]);
+        const double a = (1.0 - kmat(ifluid, ifluid)) * ai[ifluid] * alpha, b = bi[ifluid];
+        const double Ttilde = Ru * T * b / a;
         return std::make_tuple(
-                               CubicSuperAncillary::supercubic(superanc_index, CubicSuperAncillary::RHOL_CODE, Ttilde)/b,
-                               CubicSuperAncillary::supercubic(superanc_index, CubicSuperAncillary::RHOV_CODE, Ttilde)/b
+                               CubicSuperAncillary::supercubic(superanc_index, CubicSuperAncillary::P_CODE, Ttilde) * a / (b * b),
+                               CubicSuperAncillary::supercubic(superanc_index, CubicSuperAncillary::RHOL_CODE, Ttilde) / b,
+                               CubicSuperAncillary::supercubic(superanc_index, CubicSuperAncillary::RHOV_CODE, Ttilde) / b
                                );
     }
     
@@ -172,6 +228,84 @@ public:
         auto val = Psiminus - get_a(T, molefrac) / (Ru * T) * Psiplus;
         return forceeval(val);
     }
+    
+    /**
+     The derivative \f$\Lambda^{\rm r}_{xy}\f$ in closed form, for the analytic backend of TDXDerivatives, see CubicAnalytic::get_Arxy.
+     No value is returned, so that autodiff is used instead, for arguments that are not double, or for temperature
+     derivatives if not all the alpha functions are the one of Soave
+     */
+    template<int iT, int iD, typename TType, typename RhoType, typename MoleFracType>
+    std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rho, const MoleFracType& molefrac) const {
+        using x_t = std::decay_t<decltype(molefrac[0])>;
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<RhoType, double> || !std::is_same_v<x_t, double>) {
+            return std::nullopt;
+        }
+        else if constexpr (iT == 0 && iD == 0) {
+            return alphar(T, rho, molefrac);
+        }
+        else {
+            if (molefrac.size() != alphas.size()) {
+                throw std::invalid_argument("Sizes do not match");
+            }
+            double abeta;
+            if constexpr (iT == 0) {
+                abeta = get_a(T, molefrac) / T;
+            }
+            else {
+                if (!a_sqrtT) {
+                    return std::nullopt;
+                }
+                abeta = CubicAnalytic::get_abeta_deriv<iT>(T, a_sqrtT.value().get_coeffs(molefrac));
+            }
+            return CubicAnalytic::get_Arxy<iT, iD>(Ru, abeta, get_b(T, molefrac), rho, Delta1, Delta2);
+        }
+    }
+    
+    /// The square roots of \f$a_i\alpha_i(T)\f$ of the components
+    auto get_sqrt_ai_alphai(double T) const {
+        Eigen::ArrayXd s(ai.size());
+        for (auto i = 0U; i < ai.size(); ++i) {
+            s[i] = sqrt(ai[i] * std::visit([&](auto& t) { return t(T); }, alphas[i]));
+        }
+        return s;
+    }
+    
+    /// The gradient of \f$\Psi^{\rm r}\f$ w.r.t. the molar concentrations in closed form, for IsochoricDerivatives; no value for arguments that are not double
+    template<typename TType, typename RhoVecType>
+    std::optional<Eigen::ArrayXd> get_Psir_gradient_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<std::decay_t<decltype(rhovec[0])>, double>) {
+            return std::nullopt;
+        }
+        else {
+            return std::get<1>(get_Psir_derivs<false>(T, rhovec));
+        }
+    }
+    
+    /// The value, gradient and Hessian of \f$\Psi^{\rm r}\f$ w.r.t. the molar concentrations in closed form, for IsochoricDerivatives; no value for arguments that are not double
+    template<typename TType, typename RhoVecType>
+    std::optional<std::tuple<double, Eigen::ArrayXd, Eigen::MatrixXd>> get_Psir_fgradHessian_analytic(const TType& T, const RhoVecType& rhovec) const {
+        if constexpr (!std::is_same_v<TType, double> || !std::is_same_v<std::decay_t<decltype(rhovec[0])>, double>) {
+            return std::nullopt;
+        }
+        else {
+            return get_Psir_derivs<true>(T, rhovec);
+        }
+    }
+    
+private:
+    template<bool Hessian, typename RhoVecType>
+    auto get_Psir_derivs(double T, const RhoVecType& rhovec) const {
+        const auto N = ai.size();
+        if (static_cast<std::size_t>(rhovec.size()) != N) {
+            throw std::invalid_argument("Sizes do not match");
+        }
+        Eigen::ArrayXd rho(N), b(N);
+        for (auto i = 0U; i < N; ++i) {
+            rho[i] = rhovec[i];
+            b[i] = bi[i];
+        }
+        return CubicAnalytic::get_Psir_derivs<Hessian>(Ru * T, rho, b, one_minus_kmat, get_sqrt_ai_alphai(T), Delta1, Delta2);
+    }
 };
 
 template <typename TCType, typename PCType, typename AcentricType>
@@ -1,5 +1,10 @@
 #pragma once 
 #include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include <Eigen/Core>
 
 namespace teqp {
 
@@ -31,39 +36,157 @@ static int midpoint_Knuth(int x, int y) {
     return (x & y) + ((x ^ y) >> 1);
 };
 
+/**
+ A set of contiguous Chebyshev expansions covering the range of Ttilde
+
+ The coefficients of the expansions are copied into one contiguous block, zero-padded to a common
+ length, which does not change the value given by Clenshaw's method; each expansion starts on a boundary
+ of the alignment of Eigen, so that the loads of its coefficients do not straddle cache lines. A uniform grid over the range
+ stores, for each of its cells, the first and last expansions that overlap the cell, so that finding the
+ expansion is a multiply and a truncation for the cells that overlap one expansion, and a bisection over
+ the few expansions of a cell otherwise (the expansions are refined toward the critical point)
+ */
 struct SuperAncillary{
 public:
 
     const std::vector<Chebyshev> exps;
 
-    int get_index(double x) const{
-        int iL = 0, iR = static_cast<int>(exps.size()) - 1, iM;
+private:
+    std::size_t Ncoeff = 0; ///< The number of coefficients of each expansion once padded
+    std::size_t stride = 0; ///< Ncoeff rounded up to a multiple of the alignment, in doubles
+    std::vector<double, Eigen::aligned_allocator<double>> packed; ///< The coefficients of expansion i are in [i*stride, i*stride + Ncoeff)
+    std::vector<double> xmins, xmaxs;
+    double xlo, xhi, cells_per_x;
+    std::vector<int> cell_first, cell_last;
+
+    /// Bisection for the expansion containing x, with iL <= index <= iR
+    int bisect(double x, int iL, int iR) const{
+        int iM;
         while (iR - iL > 1) {
             iM = midpoint_Knuth(iL, iR);
-            if (x >= exps[iM].xmin) {
+            if (x >= xmins[iM]) {
                 iL = iM;
             }
             else {
                 iR = iM;
             }
         }
-        return (x < exps[iL].xmax) ? iL : iR;
+        return (x < xmaxs[iL]) ? iL : iR;
+    }
+
+    static std::vector<Chebyshev> check_nonempty(std::vector<Chebyshev>&& expansions){
+        if (expansions.empty()) {
+            throw std::invalid_argument("At least one expansion is needed to build a SuperAncillary");
+        }
+        return std::move(expansions);
+    }
+
+    /// The index of the expansion that contains x, without checking that x is within the range of the expansions
+    int get_index_unchecked(double x) const{
+        const auto c = std::min(static_cast<std::size_t>((x - xlo)*cells_per_x), cell_first.size() - 1);
+        int i = bisect(x, cell_first[c], cell_last[c]);
+        // The cell edges are rounded, so x can be on the other side of an expansion boundary lying on a cell edge
+        while (i > 0 && x < xmins[i]) { --i; }
+        while (i + 1 < static_cast<int>(xmaxs.size()) && x >= xmaxs[i]) { ++i; }
+        return i;
+    }
+
+    void check_range(double x) const{
+        if (!(x >= xlo)) { // NaN is rejected here too
+            throw std::invalid_argument("Ttilde (" + std::to_string(x) + ") is below the minimum of " + std::to_string(xlo));
+        }
+        if (x > xhi) {
+            throw std::invalid_argument("Ttilde (" + std::to_string(x) + ") is above the maximum of " + std::to_string(xhi));
+        }
+    }
+
+public:
+
+    SuperAncillary(std::vector<Chebyshev> expansions, std::size_t cells_per_expansion = 8) : exps(check_nonempty(std::move(expansions))), xlo(exps.front().xmin), xhi(exps.back().xmax) {
+        const auto N = exps.size();
+        for (const auto& e : exps) {
+            Ncoeff = std::max(Ncoeff, e.coeff.size());
+            xmins.push_back(e.xmin);
+            xmaxs.push_back(e.xmax);
+        }
+        if (Ncoeff == 0) {
+            throw std::invalid_argument("The expansions of a SuperAncillary have no coefficients");
+        }
+        const std::size_t align = std::max<std::size_t>(1, EIGEN_MAX_ALIGN_BYTES/sizeof(double));
+        stride = (Ncoeff + align - 1)/align*align;
+        packed.resize(N*stride, 0.0);
+        for (auto i = 0U; i < N; ++i) {
+            std::copy(exps[i].coeff.begin(), exps[i].coeff.end(), packed.begin() + i*stride);
+        }
+        const auto Ncells = std::max<std::size_t>(1, cells_per_expansion*N);
+        cells_per_x = Ncells/(xhi - xlo);
+        for (auto c = 0U; c < Ncells; ++c) {
+            double xleft = xlo + c/cells_per_x, xright = xlo + (c + 1)/cells_per_x;
+            cell_first.push_back(bisect(std::max(xleft, xlo), 0, static_cast<int>(N) - 1));
+            cell_last.push_back(bisect(std::min(xright, xhi), 0, static_cast<int>(N) - 1));
+        }
+    }
+
+    /// The index of the expansion that contains x; throws if x is outside the range of the expansions
+    int get_index(double x) const{
+        check_range(x);
+        return get_index_unchecked(x);
     };
 
     /// Evaluate the SuperAncillary
     double y(double x) const{
         // First check whether the input is possible
-        if (x < exps[0].xmin) {
-            throw std::invalid_argument("Ttilde (" + std::to_string(x) + ") is below the minimum of " + std::to_string(exps[0].xmin));
+        check_range(x);
+        const auto i = get_index_unchecked(x);
+        // Evaluate the expansion i with Clenshaw's method, as in Chebyshev::y
+        const double* coeff = packed.data() + i*stride;
+        double xscaled = (2*x - (xmaxs[i] + xmins[i])) / (xmaxs[i] - xmins[i]);
+        int Norder = static_cast<int>(Ncoeff) - 1;
+        double u_k = 0, u_kp1 = coeff[Norder], u_kp2 = 0;
+        for (int k = Norder-1; k > 0; k--){
+            u_k = 2.0*xscaled*u_kp1 - u_kp2 + coeff[k];
+            u_kp2 = u_kp1; u_kp1 = u_k;
         }
-        if (x > exps.back().xmax) {
-            throw std::invalid_argument("Ttilde (" + std::to_string(x) + ") is above the maximum of " + std::to_string(exps.back().xmax));
+        return coeff[0] + xscaled*u_kp1 - u_kp2;
+    }
+
+    /**
+     Evaluate the SuperAncillary for n inputs. The inputs are taken in blocks of fixed width, and the
+     Clenshaw recurrences of a block are advanced together, so that the loops over the block are
+     independent of each other and vectorize (each recurrence on its own is latency-bound)
+     */
+    void y_many(const double* x, double* out, std::size_t n) const{
+        constexpr std::size_t B = 8;
+        const int Norder = static_cast<int>(Ncoeff) - 1;
+        for (std::size_t j0 = 0; j0 < n; j0 += B) {
+            const std::size_t m = std::min(B, n - j0);
+            double xscaled[B], u_kp1[B], u_kp2[B];
+            const double* coeff[B];
+            for (std::size_t j = 0; j < B; ++j) {
+                if (j < m) {
+                    check_range(x[j0 + j]);
+                    const auto i = get_index_unchecked(x[j0 + j]);
+                    coeff[j] = packed.data() + i*stride;
+                    xscaled[j] = (2*x[j0 + j] - (xmaxs[i] + xmins[i])) / (xmaxs[i] - xmins[i]);
+                }
+                else {
+                    // Padding of the last block, the results are discarded
+                    coeff[j] = packed.data();
+                    xscaled[j] = 0.0;
+                }
+                u_kp1[j] = coeff[j][Norder];
+                u_kp2[j] = 0.0;
+            }
+            for (int k = Norder-1; k > 0; k--){
+                for (std::size_t j = 0; j < B; ++j) {
+                    const double u_k = 2.0*xscaled[j]*u_kp1[j] - u_kp2[j] + coeff[j][k];
+                    u_kp2[j] = u_kp1[j]; u_kp1[j] = u_k;
+                }
+            }
+            for (std::size_t j = 0; j < m; ++j) {
+                out[j0 + j] = coeff[j][0] + xscaled[j]*u_kp1[j] - u_kp2[j];
+            }
         }
-        // Bisection to find the expansion
-        // we need
-        auto i = get_index(x);
-        // Evaluate the expansion
-        return exps[i].y(x);
     }
 };
 
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <optional>
 #include <variant>
+#include <algorithm>
 
 #include "teqp/types.hpp"
 #include "teqp/constants.hpp"
@@ -47,6 +48,7 @@ template<typename EOSCollection>
 class CorrespondingStatesContribution {
 
 private:
+    friend struct internal::MultiFluidBinaryIO;
     const EOSCollection EOSs;
 public:
     CorrespondingStatesContribution(EOSCollection&& EOSs) : EOSs(EOSs) {};
@@ -64,6 +66,20 @@ public:
         return forceeval(alphar);
     }
 
+    /// The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$ in closed form, if all the EOS provide it
+    template<int iT, int iD, typename MoleFractions>
+    std::optional<double> alphar_taudelta(const double tau, const double delta, const MoleFractions& molefracs) const {
+        double val = 0.0;
+        for (auto i = 0; i < molefracs.size(); ++i) {
+            auto vali = EOSs[i].template alphar_taudelta<iT, iD>(tau, delta);
+            if (!vali) {
+                return std::nullopt;
+            }
+            val += molefracs[i] * vali.value();
+        }
+        return val;
+    }
+
     template<typename TauType, typename DeltaType>
     auto alphari(const TauType& tau, const DeltaType& delta, std::size_t i) const {
         return EOSs[i].alphar(tau, delta);
@@ -78,23 +94,116 @@ template<typename FCollection, typename DepartureFunctionCollection>
 class DepartureContribution {
 
 private:
+    friend struct internal::MultiFluidBinaryIO;
     const FCollection F;
     const DepartureFunctionCollection funcs;
+    
+    /// A binary pair with a non-zero F and a departure function that is not null
+    struct ActivePair {
+        std::size_t i, j;
+        double F;
+    };
+    /// The active pairs that share the same departure function, which is the one of the pair (i, j)
+    struct DepartureGroup {
+        std::size_t i, j;
+        std::vector<ActivePair> pairs;
+    };
+    const std::vector<DepartureGroup> groups;
+    
+    /// Collect the active pairs, grouped by identical departure function, so that each distinct function is evaluated only once
+    static auto build_groups(const FCollection& F, const DepartureFunctionCollection& funcs) {
+        std::vector<DepartureGroup> groups;
+        for (auto i = 0U; i < funcs.size(); ++i) {
+            for (auto j = i + 1; j < funcs.size(); ++j) {
+                double Fij = F(i, j);
+                if (Fij == 0.0 || funcs[i][j].is_null()) {
+                    continue;
+                }
+                auto same = [&](const DepartureGroup& g) { return funcs[g.i][g.j].has_same_terms(funcs[i][j]); };
+                auto it = std::find_if(groups.begin(), groups.end(), same);
+                if (it == groups.end()) {
+                    groups.push_back(DepartureGroup{i, j, {}});
+                    it = groups.end() - 1;
+                }
+                it->pairs.push_back(ActivePair{i, j, Fij});
+            }
+        }
+        return groups;
+    }
+    template<typename MoleFractions>
+    void check_size(const MoleFractions& molefracs) const {
+        if (static_cast<std::size_t>(molefracs.size()) != funcs.size()) {
+            throw teqp::InvalidArgument("Wrong size of mole fractions; " + std::to_string(funcs.size()) + " are loaded but " + std::to_string(molefracs.size()) + " were provided");
+        }
+    }
+    /// Construct with groups that were already collected, as when the model is loaded from a binary file
+    DepartureContribution(FCollection&& F, DepartureFunctionCollection&& funcs, std::vector<DepartureGroup>&& groups) : F(F), funcs(funcs), groups(groups) {};
 public:
-    DepartureContribution(FCollection&& F, DepartureFunctionCollection&& funcs) : F(F), funcs(funcs) {};
+    DepartureContribution(FCollection&& F, DepartureFunctionCollection&& funcs) : F(F), funcs(funcs), groups(build_groups(this->F, this->funcs)) {};
 
     template<typename TauType, typename DeltaType, typename MoleFractions>
     auto alphar(const TauType& tau, const DeltaType& delta, const MoleFractions& molefracs) const {
         using resulttype = std::common_type_t<decltype(tau), decltype(molefracs[0]), decltype(delta)>; // Type promotion, without the const-ness
         resulttype alphar = 0.0;
-        auto N = molefracs.size();
-        for (auto i = 0; i < N; ++i) {
-            for (auto j = i+1; j < N; ++j) {
-                alphar = alphar + molefracs[i] * molefracs[j] * F(i, j) * funcs[i][j].alphar(tau, delta);
+        check_size(molefracs);
+        for (const auto& group : groups) {
+            std::common_type_t<decltype(molefracs[0])> xxF = 0.0;
+            for (const auto& pair : group.pairs) {
+                xxF = xxF + molefracs[pair.i] * molefracs[pair.j] * pair.F;
             }
+            alphar = alphar + xxF * funcs[group.i][group.j].alphar(tau, delta);
+        }
+        return forceeval(alphar);
+    }
+    
+    /// The weight \f$\sum x_ix_jF_{ij}\f$ of each distinct departure function, for use with alphar_weighted
+    auto get_weights(const Eigen::ArrayXd& molefracs) const {
+        check_size(molefracs);
+        Eigen::ArrayXd weights(groups.size());
+        for (auto g = 0U; g < groups.size(); ++g) {
+            double xxF = 0.0;
+            for (const auto& pair : groups[g].pairs) {
+                xxF += molefracs[pair.i] * molefracs[pair.j] * pair.F;
+            }
+            weights[g] = xxF;
+        }
+        return weights;
+    }
+    
+    /// Evaluate the contribution with the weights of the distinct departure functions obtained from get_weights
+    template<typename TauType, typename DeltaType>
+    auto alphar_weighted(const TauType& tau, const DeltaType& delta, const Eigen::ArrayXd& weights) const {
+        std::common_type_t<TauType, DeltaType> alphar = 0.0;
+        for (auto g = 0U; g < groups.size(); ++g) {
+            alphar = alphar + weights[g] * funcs[groups[g].i][groups[g].j].alphar(tau, delta);
         }
         return forceeval(alphar);
     }
+    
+    /// The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$ in closed form with the weights from get_weights, if all the departure functions provide it
+    template<int iT, int iD>
+    std::optional<double> alphar_taudelta_weighted(const double tau, const double delta, const Eigen::ArrayXd& weights) const {
+        double val = 0.0;
+        for (auto g = 0U; g < groups.size(); ++g) {
+            auto valg = funcs[groups[g].i][groups[g].j].template alphar_taudelta<iT, iD>(tau, delta);
+            if (!valg) {
+                return std::nullopt;
+            }
+            val += weights[g] * valg.value();
+        }
+        return val;
+    }
+    
+    /// The matrix of the factors \f$F_{ij}\f$ of the departure functions
+    const auto& get_F() const { return F; }
+    /// The number of distinct departure functions that are evaluated in alphar
+    auto get_Ndistinct() const { return groups.size(); }
+    /// The number of binary pairs that contribute to alphar
+    auto get_Nactive() const {
+        std::size_t N = 0;
+        for (const auto& g : groups) { N += g.pairs.size(); }
+        return N;
+    }
 
     /// Call a single departure term at i,j 
     template<typename TauType, typename DeltaType>
@@ -157,8 +266,135 @@ public:
         auto val = corr.alphar(tau, delta, molefrac) + dep.alphar(tau, delta, molefrac);
         return forceeval(val);
     }
+    
+    /**
+     The derivative \f$\Lambda^{\rm r}_{xy}\f$ in closed form, for the analytic backend of TDXDerivatives. At constant composition,
+     \f$\Lambda^{\rm r}_{xy} = \tau^x\delta^y\partial^{x+y}\alpha^{\rm r}/\partial\tau^x\partial\delta^y\f$, which is summed term by term.
+     No value is returned, so that autodiff is used instead, for orders above 4, for arguments that are not double, or when
+     some of the terms do not have closed-form derivatives
+     */
+    template<int iT, int iD, typename TType, typename RhoType, typename MoleFracType>
+    std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rho, const MoleFracType& molefrac) const {
+        using x_t = std::decay_t<decltype(molefrac[0])>;
+        if constexpr (iT > 4 || iD > 4 || !std::is_same_v<TType, double> || !std::is_same_v<RhoType, double> || !std::is_same_v<x_t, double>) {
+            return std::nullopt;
+        }
+        else {
+            if (molefrac.size() != corr.size()){
+                throw teqp::InvalidArgument("Wrong size of mole fractions; "+std::to_string(corr.size()) + " are loaded but "+std::to_string(molefrac.size()) + " were provided");
+            }
+            const Eigen::ArrayXd z = molefrac;
+            const double tau = redfunc.get_Tr(z) / T, delta = rho / redfunc.get_rhor(z);
+            auto valcorr = corr.template alphar_taudelta<iT, iD>(tau, delta, z);
+            auto valdep = (valcorr) ? dep.template alphar_taudelta_weighted<iT, iD>(tau, delta, dep.get_weights(z)) : std::nullopt;
+            if (!valdep) {
+                return std::nullopt;
+            }
+            return valcorr.value() + valdep.value();
+        }
+    }
+};
+
+/**
+ A view of a MultiFluid model with the composition bound once, for the many evaluations at one composition in isopleth work
+ (phase envelopes, density solving, flashes at fixed composition, ...).
+
+ The reducing temperature and density, and the weights of the departure functions, are calculated when the view is constructed,
+ so an evaluation does not pay for the \f$O(N^2)\f$ reducing functions and departure weights. When alphar is called with
+ mole fractions that are not the bound ones (or that are not of type double, as in composition derivatives), the evaluation is
+ forwarded to the model, so the view can be used with any of the derivative routines.
+
+ The view holds a reference to the model, which must outlive it
+ */
+template<typename Model>
+class FixedCompositionMultiFluid {
+private:
+    const Model& model;
+    const Eigen::ArrayXd z; ///< The bound mole fractions
+    const double Tr, rhor; ///< The reducing temperature and density at the bound composition
+    const Eigen::ArrayXd depweights; ///< The weights of the distinct departure functions at the bound composition
+    
+    template<typename MoleFracType>
+    bool is_bound(const MoleFracType& molefrac) const {
+        if (static_cast<Eigen::Index>(molefrac.size()) != z.size()) { return false; }
+        for (auto i = 0; i < z.size(); ++i) {
+            if (molefrac[i] != z[i]) { return false; }
+        }
+        return true;
+    }
+    static const Eigen::ArrayXd& check_size(const Model& model, const Eigen::ArrayXd& molefrac) {
+        if (molefrac.size() != static_cast<Eigen::Index>(model.corr.size())) {
+            throw teqp::InvalidArgument("Wrong size of mole fractions; " + std::to_string(model.corr.size()) + " are loaded but " + std::to_string(molefrac.size()) + " were provided");
+        }
+        return molefrac;
+    }
+public:
+    FixedCompositionMultiFluid(const Model& model, const Eigen::ArrayXd& molefrac) : model(model), z(check_size(model, molefrac)),
+        Tr(model.redfunc.get_Tr(z)), rhor(model.redfunc.get_rhor(z)), depweights(model.dep.get_weights(z)) {}
+    
+    const auto& get_molefrac() const { return z; }
+    auto get_Tr() const { return Tr; }
+    auto get_rhor() const { return rhor; }
+    
+    template<class VecType>
+    auto R(const VecType& molefrac) const { return model.R(molefrac); }
+    
+    /// Evaluate \f$\alpha^{\rm r}\f$ at the bound composition
+    template<typename TType, typename RhoType>
+    auto alphar_bound(const TType& T, const RhoType& rho) const {
+        auto delta = forceeval(rho / rhor);
+        auto tau = forceeval(Tr / T);
+        auto val = model.corr.alphar(tau, delta, z) + model.dep.alphar_weighted(tau, delta, depweights);
+        return forceeval(val);
+    }
+    
+    template<typename TType, typename RhoType, typename MoleFracType>
+    auto alphar(const TType& T, const RhoType& rho, const MoleFracType& molefrac) const {
+        using result_t = std::decay_t<decltype(model.alphar(T, rho, molefrac))>;
+        using x_t = std::decay_t<decltype(molefrac[0])>;
+        if constexpr (std::is_same_v<x_t, double>) {
+            if (is_bound(molefrac)) {
+                return static_cast<result_t>(alphar_bound(T, rho));
+            }
+        }
+        return static_cast<result_t>(model.alphar(T, rho, molefrac));
+    }
+    
+    template<typename TType, typename RhoType>
+    auto alphar(TType T, const RhoType& rhovec, const std::optional<typename RhoType::value_type> rhotot = std::nullopt) const {
+        typename RhoType::value_type rhotot_ = (rhotot.has_value()) ? rhotot.value() : std::accumulate(std::begin(rhovec), std::end(rhovec), (decltype(rhovec[0]))0.0);
+        auto molefrac = rhovec / rhotot_;
+        return alphar(T, rhotot_, molefrac);
+    }
+    
+    /// The closed-form derivative \f$\Lambda^{\rm r}_{xy}\f$ (see MultiFluid::get_Arxy_analytic), with the reducing values and departure weights of the bound composition
+    template<int iT, int iD, typename TType, typename RhoType, typename MoleFracType>
+    std::optional<double> get_Arxy_analytic(const TType& T, const RhoType& rho, const MoleFracType& molefrac) const {
+        using x_t = std::decay_t<decltype(molefrac[0])>;
+        if constexpr (iT > 4 || iD > 4 || !std::is_same_v<TType, double> || !std::is_same_v<RhoType, double> || !std::is_same_v<x_t, double>) {
+            return std::nullopt;
+        }
+        else {
+            if (!is_bound(molefrac)) {
+                return model.template get_Arxy_analytic<iT, iD>(T, rho, molefrac);
+            }
+            const double tau = Tr / T, delta = rho / rhor;
+            auto valcorr = model.corr.template alphar_taudelta<iT, iD>(tau, delta, z);
+            auto valdep = (valcorr) ? model.dep.template alphar_taudelta_weighted<iT, iD>(tau, delta, depweights) : std::nullopt;
+            if (!valdep) {
+                return std::nullopt;
+            }
+            return valcorr.value() + valdep.value();
+        }
+    }
 };
 
+/// Bind the composition of a MultiFluid model, returning a FixedCompositionMultiFluid view of it; the model must outlive the view
+template<typename Model>
+auto make_fixed_composition(const Model& model, const Eigen::ArrayXd& molefrac) {
+    return FixedCompositionMultiFluid<Model>(model, molefrac);
+}
+
 
 /***
 * \brief Get the JSON data structure for a given departure function
@@ -167,8 +403,7 @@ public:
 */
 inline auto get_departure_json(const std::string& name, const std::string& path) {
     std::string filepath = std::filesystem::is_regular_file(path) ? path : path + "/dev/mixtures/mixture_departure_functions.json";
-    nlohmann::json j = load_a_JSON_file(filepath);
-    std::string js = j.dump(2);
+    const nlohmann::json& j = *load_a_JSON_file_cached(filepath);
     // First pass, direct name lookup
     for (auto& el : j) {
         if (el.at("Name") == name) {
@@ -733,7 +968,7 @@ inline auto collect_component_json(const std::vector<std::string>& components, c
             }
         }
         if (selected_path != "") {
-            out.push_back(load_a_JSON_file(selected_path.string()));
+            out.push_back(*load_a_JSON_file_cached(selected_path.string()));
         }
         else {
             throw std::invalid_argument("Could not load any of the candidates:" + c);
@@ -780,10 +1015,11 @@ inline auto select_identifier(const nlohmann::json& BIPcollection, const mapvecs
 }
 
 /// Build a reverse-lookup map for finding a fluid JSON structure given a backup identifier
+/// The fluid files are read via the JSONFileCache, so only files that are new or have changed are parsed
 inline auto build_alias_map(const std::string& root) {
     std::map<std::string, std::string> aliasmap;
     for (auto path : get_files_in_folder(root + "/dev/fluids", ".json")) {
-        auto j = load_a_JSON_file(path.string());
+        const nlohmann::json& j = *load_a_JSON_file_cached(path.string());
         std::string REFPROP_name = j.at("INFO").at("REFPROP_NAME"); 
         std::string name = j.at("INFO").at("NAME");
         for (std::string k : {"NAME", "CAS", "REFPROP_NAME"}) {
@@ -940,15 +1176,65 @@ inline auto make_pure_components_JSON(const nlohmann::json& components, const st
 inline auto build_multifluid_model(const std::vector<std::string>& components, const std::string& root, const std::string& BIPcollectionpath = {}, const nlohmann::json& flags = {}, const std::string& departurepath = {}) {
     
     // Convert the string representations to JSON using the existing routines (a bit slower, but more convenient, more DRY)
-    nlohmann::json BIPcollection = nlohmann::json::array();
-    nlohmann::json depcollection = nlohmann::json::array();
+    // The collections are shared with the JSONFileCache, which avoids copying them
+    auto BIPcollection = std::make_shared<const nlohmann::json>(nlohmann::json::array());
+    auto depcollection = BIPcollection;
     if (components.size() > 1){
         nlohmann::json B = BIPcollectionpath, D = departurepath;
-        BIPcollection = multilevel_JSON_load(B, root + "/dev/mixtures/mixture_binary_pairs.json");
-        depcollection = multilevel_JSON_load(D, root + "/dev/mixtures/mixture_departure_functions.json");
+        BIPcollection = multilevel_JSON_load_shared(B, root + "/dev/mixtures/mixture_binary_pairs.json");
+        depcollection = multilevel_JSON_load_shared(D, root + "/dev/mixtures/mixture_departure_functions.json");
     }
     
-    return _build_multifluid_model(make_pure_components_JSON(components, root), BIPcollection, depcollection, flags);
+    return _build_multifluid_model(make_pure_components_JSON(components, root), *BIPcollection, *depcollection, flags);
+}
+
+/**
+* \brief Convert the specification of a multifluid model to one that does not refer to any files
+*
+* The components are replaced by their JSON data, and the BIP and departure collections are reduced to the entries
+* that could be matched by the components, so the specification can be stored (see save_binary) and the model
+* built again from it without access to the fluid files. The specification is otherwise as for multifluidfactory
+*/
+inline auto make_self_contained_multifluid_spec(const nlohmann::json& spec) {
+    std::string root = (spec.contains("root")) ? spec.at("root") : "";
+    auto pureJSON = make_pure_components_JSON(spec.at("components"), root);
+    
+    nlohmann::json out = spec;
+    out.erase("root");
+    out["components"] = pureJSON;
+    if (pureJSON.size() < 2){
+        return out;
+    }
+    
+    auto toupper = [](const std::string s) { auto data = s; std::for_each(data.begin(), data.end(), [](char& c) { c = ::toupper(c); }); return data; };
+    std::set<std::string> names, CAS;
+    for (auto& [key, vals] : collect_identifiers(pureJSON)) {
+        for (auto& val : vals) {
+            if (key == "CAS") { CAS.insert(val); } else { names.insert(toupper(val)); }
+        }
+    }
+    const auto& BIPcollection = *multilevel_JSON_load_shared(spec.at("BIP"), root + "/dev/mixtures/mixture_binary_pairs.json");
+    const auto& depcollection = *multilevel_JSON_load_shared(spec.at("departure"), root + "/dev/mixtures/mixture_departure_functions.json");
+    
+    nlohmann::json BIPs = nlohmann::json::array(), deps = nlohmann::json::array();
+    std::set<std::string> funcnames;
+    for (auto& el : BIPcollection) {
+        bool by_name = names.count(toupper(el.at("Name1").get<std::string>())) > 0 && names.count(toupper(el.at("Name2").get<std::string>())) > 0;
+        bool by_CAS = CAS.count(el.at("CAS1").get<std::string>()) > 0 && CAS.count(el.at("CAS2").get<std::string>()) > 0;
+        if (by_name || by_CAS) {
+            BIPs.push_back(el);
+            if (el.contains("function")) { funcnames.insert(el.at("function").get<std::string>()); }
+        }
+    }
+    for (auto& el : depcollection) {
+        if (funcnames.count(el.at("Name").get<std::string>()) > 0) {
+            deps.push_back(el);
+        }
+    }
+    // Empty arrays would be taken to mean the default files, so empty collections are stored as JSON-encoded strings
+    out["BIP"] = BIPs.empty() ? nlohmann::json("[]") : BIPs;
+    out["departure"] = deps.empty() ? nlohmann::json("[]") : deps;
+    return out;
 }
 
 /**
@@ -965,15 +1251,15 @@ inline auto multifluidfactory(const nlohmann::json& spec) {
     
     auto components = spec.at("components");
     
-    nlohmann::json BIPcollection = nlohmann::json::array();
-    nlohmann::json depcollection = nlohmann::json::array();
+    auto BIPcollection = std::make_shared<const nlohmann::json>(nlohmann::json::array());
+    auto depcollection = BIPcollection;
     if (components.size() > 1){
-        BIPcollection = multilevel_JSON_load(spec.at("BIP"), root + "/dev/mixtures/mixture_binary_pairs.json");
-        depcollection = multilevel_JSON_load(spec.at("departure"), root + "/dev/mixtures/mixture_departure_functions.json");
+        BIPcollection = multilevel_JSON_load_shared(spec.at("BIP"), root + "/dev/mixtures/mixture_binary_pairs.json");
+        depcollection = multilevel_JSON_load_shared(spec.at("departure"), root + "/dev/mixtures/mixture_departure_functions.json");
     }
     nlohmann::json flags = (spec.contains("flags")) ? spec.at("flags") : nlohmann::json();
 
-    return _build_multifluid_model(make_pure_components_JSON(components, root), BIPcollection, depcollection, flags);
+    return _build_multifluid_model(make_pure_components_JSON(components, root), *BIPcollection, *depcollection, flags);
 }
 /// An overload of multifluidfactory that takes in a string
 inline auto multifluidfactory(const std::string& specstring) {
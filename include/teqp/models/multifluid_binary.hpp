@@ -0,0 +1,285 @@
+#pragma once
+
+/**
+ Serialization of the built tables of a multifluid model (the EOS terms with their struct-of-arrays groups, the reducing
+ functions, and the departure functions with their groups of active pairs) to a contiguous binary layout, from which the
+ model can be constructed again without parsing any JSON or repeating the matching of the binary pairs.
+
+ The layout is a sequence of fields in native byte order, without padding. Scalars are stored as is, strings and Eigen
+ arrays are preceded by their dimensions as uint64, and the coefficients of an array follow contiguously in column-major order.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "teqp/models/multifluid.hpp"
+#include "teqp/exceptions.hpp"
+
+namespace teqp {
+
+/// The type of the model returned by multifluidfactory, whose tables can be written with multifluid_to_binary
+using MultiFluidModel = MultiFluid<CorrespondingStatesContribution<std::vector<EOSTerms>>, DepartureContribution<Eigen::MatrixXd, std::vector<std::vector<DepartureTerms>>>>;
+
+static_assert(std::is_same_v<MultiFluidModel, decltype(multifluidfactory(std::declval<nlohmann::json>()))>);
+
+namespace internal {
+
+/// Appends fields to a contiguous buffer
+class BinaryWriter {
+public:
+    std::vector<std::uint8_t> buffer;
+
+    template<typename T>
+    void put_raw(const T* data, std::size_t N) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto p = reinterpret_cast<const std::uint8_t*>(data);
+        buffer.insert(buffer.end(), p, p + N*sizeof(T));
+    }
+    void put(double v) { put_raw(&v, 1); }
+    void put(std::uint64_t v) { put_raw(&v, 1); }
+    void put(const std::string& s) { put(static_cast<std::uint64_t>(s.size())); put_raw(s.data(), s.size()); }
+    template<typename Derived>
+    void put(const Eigen::PlainObjectBase<Derived>& a) {
+        put(static_cast<std::uint64_t>(a.rows())); put(static_cast<std::uint64_t>(a.cols()));
+        put_raw(a.data(), static_cast<std::size_t>(a.size()));
+    }
+};
+
+/// Reads the fields written by BinaryWriter back, checking that the buffer is not overrun
+class BinaryReader {
+private:
+    const std::uint8_t* ptr;
+    const std::uint8_t* const end;
+public:
+    BinaryReader(const std::uint8_t* begin, const std::uint8_t* end) : ptr(begin), end(end) {};
+
+    template<typename T>
+    void get_raw(T* data, std::size_t N) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (N > static_cast<std::size_t>(end - ptr)/sizeof(T)) {
+            throw teqp::InvalidArgument("The binary tables of the model are truncated");
+        }
+        std::memcpy(data, ptr, N*sizeof(T));
+        ptr += N*sizeof(T);
+    }
+    void get(double& v) { get_raw(&v, 1); }
+    void get(std::uint64_t& v) { get_raw(&v, 1); }
+    std::uint64_t get_size() { std::uint64_t v; get(v); return v; }
+    /// Get a number of items, each of which takes at least the given number of bytes in the rest of the buffer
+    std::uint64_t get_count(std::size_t min_bytes) {
+        auto N = get_size();
+        if (N > static_cast<std::size_t>(end - ptr)/min_bytes) {
+            throw teqp::InvalidArgument("The binary tables of the model are truncated");
+        }
+        return N;
+    }
+    void get(std::string& s) { s.resize(get_size()); get_raw(s.data(), s.size()); }
+    template<typename Derived>
+    void get(Eigen::PlainObjectBase<Derived>& a) {
+        auto rows = get_size(), cols = get_size();
+        if (Derived::ColsAtCompileTime == 1 && cols != 1) {
+            throw teqp::InvalidArgument("A one-dimensional array is stored with " + std::to_string(cols) + " columns");
+        }
+        if (rows != 0 && cols > static_cast<std::uint64_t>(end - ptr)/rows) {
+            throw teqp::InvalidArgument("The binary tables of the model are truncated");
+        }
+        a.resize(static_cast<Eigen::Index>(rows), static_cast<Eigen::Index>(cols));
+        get_raw(a.data(), static_cast<std::size_t>(a.size()));
+    }
+    bool at_end() const { return ptr == end; }
+};
+
+/// Writes and reads the tables of MultiFluidModel, with access to the private members of the classes that make it up
+struct MultiFluidBinaryIO {
+
+    /// Call the function with each field of a term (or of a struct-of-arrays group), in the order in which they are stored
+    template<typename Term, typename Function>
+    static void visit_fields(Term& e, Function&& f) {
+        using T = std::decay_t<Term>;
+        if constexpr (std::is_same_v<T, JustPowerEOSTerm>) { f(e.n); f(e.t); f(e.d); }
+        else if constexpr (std::is_same_v<T, PowerEOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.c); f(e.l); f(e.l_i); }
+        else if constexpr (std::is_same_v<T, ExponentialEOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.g); f(e.l); f(e.l_i); }
+        else if constexpr (std::is_same_v<T, DoubleExponentialEOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.gd); f(e.ld); f(e.gt); f(e.lt); f(e.ld_i); }
+        else if constexpr (std::is_same_v<T, GaussianEOSTerm> || std::is_same_v<T, GERG2004EOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.eta); f(e.beta); f(e.gamma); f(e.epsilon); }
+        else if constexpr (std::is_same_v<T, Lemmon2005EOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.l); f(e.m); f(e.l_i); }
+        else if constexpr (std::is_same_v<T, GaoBEOSTerm>) { f(e.n); f(e.t); f(e.d); f(e.eta); f(e.beta); f(e.gamma); f(e.epsilon); f(e.b); }
+        else if constexpr (std::is_same_v<T, Chebyshev2DEOSTerm>) { f(e.a); f(e.taumin); f(e.taumax); f(e.deltamin); f(e.deltamax); }
+        else if constexpr (std::is_same_v<T, NonAnalyticEOSTerm>) { f(e.A); f(e.B); f(e.C); f(e.D); f(e.a); f(e.b); f(e.beta); f(e.n); }
+        else if constexpr (std::is_same_v<T, NullEOSTerm>) { }
+        else if constexpr (std::is_same_v<T, PowerTermsSoA>) { f(e.n); f(e.t); f(e.d); f(e.c); f(e.l); }
+        else if constexpr (std::is_same_v<T, DoubleExponentialTermsSoA>) { f(e.n); f(e.t); f(e.d); f(e.gd); f(e.ld); f(e.gt); f(e.lt); }
+        else if constexpr (std::is_same_v<T, GaussianTermsSoA>) { f(e.n); f(e.t); f(e.d); f(e.eta); f(e.epsilon); f(e.betatau); f(e.gammatau); f(e.betadelta); f(e.gammadelta); }
+        else {
+            static_assert(!std::is_same_v<T, T>, "This kind of term cannot be stored");
+        }
+    }
+
+    template<typename Term>
+    static void write_fields(BinaryWriter& w, const Term& e) {
+        visit_fields(e, [&w](const auto& field) { w.put(field); });
+    }
+    template<typename Term>
+    static void read_fields(BinaryReader& r, Term& e) {
+        visit_fields(e, [&r](auto& field) { r.get(field); });
+    }
+
+    /// Read the term of the alternative of the variant with the given index
+    template<typename Variant, std::size_t I = 0>
+    static Variant read_term(BinaryReader& r, std::uint64_t index) {
+        if constexpr (I < std::variant_size_v<Variant>) {
+            if (index == I) {
+                std::variant_alternative_t<I, Variant> e;
+                read_fields(r, e);
+                return e;
+            }
+            return read_term<Variant, I + 1>(r, index);
+        }
+        else {
+            throw teqp::InvalidArgument("Unknown kind of EOS term: " + std::to_string(index));
+        }
+    }
+
+    template<typename... Args>
+    static void write(BinaryWriter& w, const EOSTermContainer<Args...>& c) {
+        w.put(static_cast<std::uint64_t>(c.coll.size()));
+        for (const auto& term : c.coll) {
+            w.put(static_cast<std::uint64_t>(term.index()));
+            std::visit([&w](const auto& e) { write_fields(w, e); }, term);
+        }
+        write_fields(w, c.power);
+        write_fields(w, c.doubleexponential);
+        write_fields(w, c.gaussian);
+        w.put(static_cast<std::uint64_t>(c.unflattened.size()));
+        for (auto i : c.unflattened) { w.put(static_cast<std::uint64_t>(i)); }
+    }
+    template<typename... Args>
+    static void read(BinaryReader& r, EOSTermContainer<Args...>& c) {
+        using varEOSTerms = typename EOSTermContainer<Args...>::varEOSTerms;
+        auto Nterms = r.get_count(sizeof(std::uint64_t));
+        for (auto i = 0U; i < Nterms; ++i) {
+            c.coll.emplace_back(read_term<varEOSTerms>(r, r.get_size()));
+        }
+        read_fields(r, c.power);
+        read_fields(r, c.doubleexponential);
+        read_fields(r, c.gaussian);
+        auto Nunflattened = r.get_count(sizeof(std::uint64_t));
+        for (auto i = 0U; i < Nunflattened; ++i) {
+            auto index = r.get_size();
+            if (index >= c.coll.size()) {
+                throw teqp::InvalidArgument("Index of unflattened term is out of range");
+            }
+            c.unflattened.push_back(static_cast<std::size_t>(index));
+        }
+    }
+
+    static void write(BinaryWriter& w, const ReducingFunctions& red) {
+        w.put(static_cast<std::uint64_t>(red.term.index()));
+        std::visit([&w](const auto& t) {
+            using T = std::decay_t<decltype(t)>;
+            if constexpr (std::is_same_v<T, MultiFluidReducingFunction>) { w.put(t.betaT); w.put(t.gammaT); w.put(t.betaV); w.put(t.gammaV); }
+            else { w.put(t.phiT); w.put(t.lambdaT); w.put(t.phiV); w.put(t.lambdaV); }
+            w.put(t.Tc); w.put(t.vc);
+        }, red.term);
+    }
+    static ReducingFunctions read_reducing(BinaryReader& r) {
+        auto index = r.get_size();
+        Eigen::MatrixXd m[4];
+        for (auto& mi : m) { r.get(mi); }
+        Eigen::ArrayXd Tc, vc;
+        r.get(Tc); r.get(vc);
+        for (auto& mi : m) {
+            if (mi.rows() != Tc.size() || mi.cols() != Tc.size()) {
+                throw teqp::InvalidArgument("The reducing function matrices do not match the number of components");
+            }
+        }
+        switch (index) {
+            case 0: return ReducingFunctions(MultiFluidReducingFunction(m[0], m[1], m[2], m[3], Tc, vc));
+            case 1: return ReducingFunctions(MultiFluidInvariantReducingFunction(m[0], m[1], m[2], m[3], Tc, vc));
+            default: throw teqp::InvalidArgument("Unknown kind of reducing function: " + std::to_string(index));
+        }
+    }
+
+    static void write(BinaryWriter& w, const MultiFluidModel& model) {
+        write(w, model.redfunc);
+        const auto& EOSs = model.corr.EOSs;
+        w.put(static_cast<std::uint64_t>(EOSs.size()));
+        for (const auto& EOS : EOSs) { write(w, EOS); }
+
+        const auto& dep = model.dep;
+        w.put(dep.F);
+        for (const auto& row : dep.funcs) {
+            for (const auto& func : row) { write(w, func); }
+        }
+        w.put(static_cast<std::uint64_t>(dep.groups.size()));
+        for (const auto& group : dep.groups) {
+            w.put(static_cast<std::uint64_t>(group.i)); w.put(static_cast<std::uint64_t>(group.j));
+            w.put(static_cast<std::uint64_t>(group.pairs.size()));
+            for (const auto& pair : group.pairs) {
+                w.put(static_cast<std::uint64_t>(pair.i)); w.put(static_cast<std::uint64_t>(pair.j)); w.put(pair.F);
+            }
+        }
+        w.put(model.get_meta());
+    }
+    static MultiFluidModel read_model(BinaryReader& r) {
+        using Departure = std::decay_t<decltype(std::declval<MultiFluidModel>().dep)>;
+        auto redfunc = read_reducing(r);
+        const auto N = static_cast<std::uint64_t>(redfunc.Tc.size());
+
+        if (r.get_size() != N) {
+            throw teqp::InvalidArgument("The number of pure fluid EOS does not match the number of components");
+        }
+        std::vector<EOSTerms> EOSs(N);
+        for (auto& EOS : EOSs) { read(r, EOS); }
+
+        Eigen::MatrixXd F;
+        r.get(F);
+        if (static_cast<std::uint64_t>(F.rows()) != N || static_cast<std::uint64_t>(F.cols()) != N) {
+            throw teqp::InvalidArgument("The F matrix does not match the number of components");
+        }
+        std::vector<std::vector<DepartureTerms>> funcs(N, std::vector<DepartureTerms>(N));
+        for (auto& row : funcs) {
+            for (auto& func : row) { read(r, func); }
+        }
+        auto index = [&r, N]() {
+            auto i = r.get_size();
+            if (i >= N) { throw teqp::InvalidArgument("Index of binary pair is out of range"); }
+            return static_cast<std::size_t>(i);
+        };
+        std::vector<typename Departure::DepartureGroup> groups(r.get_count(3*sizeof(std::uint64_t)));
+        for (auto& group : groups) {
+            group.i = index(); group.j = index();
+            group.pairs.resize(r.get_count(3*sizeof(std::uint64_t)));
+            for (auto& pair : group.pairs) {
+                pair.i = index(); pair.j = index(); r.get(pair.F);
+            }
+        }
+        std::string meta;
+        r.get(meta);
+        if (!r.at_end()) {
+            throw teqp::InvalidArgument("The binary tables of the model have trailing data");
+        }
+
+        MultiFluidModel model(std::move(redfunc), CorrespondingStatesContribution(std::move(EOSs)), Departure(std::move(F), std::move(funcs), std::move(groups)));
+        model.set_meta(meta);
+        return model;
+    }
+};
+
+}
+
+/// Write the built tables of the model to a contiguous buffer, from which it can be constructed again with multifluid_from_binary
+inline std::vector<std::uint8_t> multifluid_to_binary(const MultiFluidModel& model) {
+    internal::BinaryWriter w;
+    internal::MultiFluidBinaryIO::write(w, model);
+    return std::move(w.buffer);
+}
+
+/// Construct the model from the tables written by multifluid_to_binary, which must fill the range [begin, end) exactly
+inline MultiFluidModel multifluid_from_binary(const std::uint8_t* begin, const std::uint8_t* end) {
+    internal::BinaryReader r(begin, end);
+    return internal::MultiFluidBinaryIO::read_model(r);
+}
+
+}; // namespace teqp
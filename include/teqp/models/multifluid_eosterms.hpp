@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <optional>
+
 #include "teqp/types.hpp"
 
 namespace teqp {
@@ -342,11 +345,240 @@ public:
 };
 
 
+namespace internal {
+
+struct MultiFluidBinaryIO; // Defined in multifluid_binary.hpp
+
+/// Append the entries of src to the end of dest
+inline void append_to(Eigen::ArrayXd& dest, const Eigen::ArrayXd& src) {
+    auto N = dest.size();
+    dest.conservativeResize(N + src.size());
+    dest.tail(src.size()) = src;
+}
+
+/// True if the arrays have the same length and identical entries
+inline bool same_entries(const Eigen::ArrayXd& a, const Eigen::ArrayXd& b) {
+    return a.size() == b.size() && (a == b).all();
+}
+
+/// The scaled derivative \f$x^k{\rm d}^k(\ln x)/{\rm d}x^k = (-1)^{k-1}(k-1)!\f$, for k=1..4
+inline double scaled_log_derivative(int k) {
+    constexpr double c[] = { 0.0, 1.0, -1.0, 2.0, -6.0 };
+    return c[k];
+}
+
+/// The scaled derivative \f$x^k{\rm d}^k(x^l)/{\rm d}x^k = l(l-1)\cdots(l-k+1)x^l\f$, divided by \f$x^l\f$
+inline Eigen::ArrayXd falling_factorial(const Eigen::ArrayXd& l, int k) {
+    Eigen::ArrayXd o = Eigen::ArrayXd::Ones(l.size());
+    for (auto i = 0; i < k; ++i) {
+        o *= l - i;
+    }
+    return o;
+}
+
+/// The scaled derivatives of the exponent of a term, \f$a_k = x^k{\rm d}^kA/{\rm d}x^k\f$, stored at index k
+using ScaledDerivatives = std::array<Eigen::ArrayXd, 5>;
+
+/**
+The factor \f$x^k{\rm d}^k\exp(A)/{\rm d}x^k\f$ divided by \f$\exp(A)\f$, obtained from the scaled derivatives of the exponent
+with the complete Bell polynomials
+*/
+template<int k>
+Eigen::ArrayXd exp_derivative_factor(const ScaledDerivatives& a, Eigen::Index N) {
+    static_assert(k >= 0 && k <= 4, "Only derivatives up to 4th order are available");
+    if constexpr (k == 0) {
+        return Eigen::ArrayXd::Ones(N);
+    }
+    else if constexpr (k == 1) {
+        return a[1];
+    }
+    else if constexpr (k == 2) {
+        return a[2] + a[1].square();
+    }
+    else if constexpr (k == 3) {
+        return a[3] + 3.0*a[1]*a[2] + a[1].cube();
+    }
+    else {
+        return a[4] + 4.0*a[1]*a[3] + 3.0*a[2].square() + 6.0*a[1].square()*a[2] + a[1].square().square();
+    }
+}
+
+/**
+The scaled derivatives, for k=1..K, of \f$c\ln x - g x^l\f$, the form of the exponent in tau or delta of the power and
+double exponential terms; xl is \f$x^l\f$
+*/
+template<int K>
+ScaledDerivatives log_power_derivatives(const Eigen::ArrayXd& c, const Eigen::ArrayXd& g, const Eigen::ArrayXd& l, const Eigen::ArrayXd& xl) {
+    ScaledDerivatives a;
+    for (auto k = 1; k <= K; ++k) {
+        a[k] = c*scaled_log_derivative(k) - g*falling_factorial(l, k)*xl;
+    }
+    return a;
+}
+
+/**
+The scaled derivatives, for k=1..K, of \f$c\ln x - \eta(x-\epsilon)^2 - \beta(x-\gamma)\f$, the form of the exponent in tau
+or delta of the Gaussian terms
+*/
+template<int K>
+ScaledDerivatives log_gaussian_derivatives(double x, const Eigen::ArrayXd& c, const Eigen::ArrayXd& eta, const Eigen::ArrayXd& epsilon, const Eigen::ArrayXd& beta) {
+    ScaledDerivatives a;
+    for (auto k = 1; k <= K; ++k) {
+        a[k] = c*scaled_log_derivative(k);
+    }
+    if constexpr (K >= 1) { a[1] -= 2.0*eta*x*(x - epsilon) + beta*x; }
+    if constexpr (K >= 2) { a[2] -= 2.0*eta*x*x; }
+    return a;
+}
+
+/**
+Terms of the kinds JustPower, Power, and Exponential in struct-of-arrays layout, evaluated as
+\f$ \alpha^{\rm r}=\displaystyle\sum_i n_i \exp(t_i\ln\tau + d_i\ln\delta - c_i\delta^{l_i})\f$
+*/
+struct PowerTermsSoA {
+    Eigen::ArrayXd n, t, d, c, l;
+    void append(const Eigen::ArrayXd& n_, const Eigen::ArrayXd& t_, const Eigen::ArrayXd& d_, const Eigen::ArrayXd& c_, const Eigen::ArrayXd& l_) {
+        append_to(n, n_); append_to(t, t_); append_to(d, d_); append_to(c, c_); append_to(l, l_);
+    }
+    double alphar(double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        return (n * (t * lntau + d * lndelta - c * (l * lndelta).exp()).exp()).sum();
+    }
+    /// The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$
+    template<int iT, int iD>
+    double alphar_deriv(double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        const Eigen::ArrayXd deltal = (l * lndelta).exp(), zero = Eigen::ArrayXd::Zero(n.size());
+        auto a = log_power_derivatives<iT>(t, zero, zero, zero);
+        auto b = log_power_derivatives<iD>(d, c, l, deltal);
+        return (n * (t * lntau + d * lndelta - c * deltal).exp() * exp_derivative_factor<iT>(a, n.size()) * exp_derivative_factor<iD>(b, n.size())).sum();
+    }
+    bool operator==(const PowerTermsSoA& o) const {
+        return same_entries(n, o.n) && same_entries(t, o.t) && same_entries(d, o.d) && same_entries(c, o.c) && same_entries(l, o.l);
+    }
+};
+
+/**
+Terms of the kinds DoubleExponential and Lemmon2005 in struct-of-arrays layout, evaluated as
+\f$ \alpha^{\rm r}=\displaystyle\sum_i n_i \exp(t_i\ln\tau + d_i\ln\delta - g_{d,i}\delta^{l_{d,i}} - g_{t,i}\tau^{l_{t,i}})\f$
+*/
+struct DoubleExponentialTermsSoA {
+    Eigen::ArrayXd n, t, d, gd, ld, gt, lt;
+    void append(const Eigen::ArrayXd& n_, const Eigen::ArrayXd& t_, const Eigen::ArrayXd& d_, const Eigen::ArrayXd& gd_, const Eigen::ArrayXd& ld_, const Eigen::ArrayXd& gt_, const Eigen::ArrayXd& lt_) {
+        append_to(n, n_); append_to(t, t_); append_to(d, d_); append_to(gd, gd_); append_to(ld, ld_); append_to(gt, gt_); append_to(lt, lt_);
+    }
+    double alphar(double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        return (n * (t * lntau + d * lndelta - gd * (ld * lndelta).exp() - gt * (lt * lntau).exp()).exp()).sum();
+    }
+    /// The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$
+    template<int iT, int iD>
+    double alphar_deriv(double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        const Eigen::ArrayXd deltald = (ld * lndelta).exp(), tault = (lt * lntau).exp();
+        auto a = log_power_derivatives<iT>(t, gt, lt, tault);
+        auto b = log_power_derivatives<iD>(d, gd, ld, deltald);
+        return (n * (t * lntau + d * lndelta - gd * deltald - gt * tault).exp() * exp_derivative_factor<iT>(a, n.size()) * exp_derivative_factor<iD>(b, n.size())).sum();
+    }
+    bool operator==(const DoubleExponentialTermsSoA& o) const {
+        return same_entries(n, o.n) && same_entries(t, o.t) && same_entries(d, o.d) && same_entries(gd, o.gd) && same_entries(ld, o.ld) && same_entries(gt, o.gt) && same_entries(lt, o.lt);
+    }
+};
+
+/**
+Terms of the kinds Gaussian and GERG2004 in struct-of-arrays layout, evaluated as
+\f$ \alpha^{\rm r}=\displaystyle\sum_i n_i \exp(t_i\ln\tau + d_i\ln\delta - \eta_i(\delta-\epsilon_i)^2 - \beta_{\tau,i}(\tau-\gamma_{\tau,i})^2 - \beta_{\delta,i}(\delta-\gamma_{\delta,i}))\f$
+*/
+struct GaussianTermsSoA {
+    Eigen::ArrayXd n, t, d, eta, epsilon, betatau, gammatau, betadelta, gammadelta;
+    void append(const Eigen::ArrayXd& n_, const Eigen::ArrayXd& t_, const Eigen::ArrayXd& d_, const Eigen::ArrayXd& eta_, const Eigen::ArrayXd& epsilon_, const Eigen::ArrayXd& betatau_, const Eigen::ArrayXd& gammatau_, const Eigen::ArrayXd& betadelta_, const Eigen::ArrayXd& gammadelta_) {
+        append_to(n, n_); append_to(t, t_); append_to(d, d_); append_to(eta, eta_); append_to(epsilon, epsilon_);
+        append_to(betatau, betatau_); append_to(gammatau, gammatau_); append_to(betadelta, betadelta_); append_to(gammadelta, gammadelta_);
+    }
+    double alphar(double tau, double delta, double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        return (n * (t * lntau + d * lndelta - eta * (delta - epsilon).square() - betatau * (tau - gammatau).square() - betadelta * (delta - gammadelta)).exp()).sum();
+    }
+    /// The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$
+    template<int iT, int iD>
+    double alphar_deriv(double tau, double delta, double lntau, double lndelta) const {
+        if (n.size() == 0) { return 0.0; }
+        const Eigen::ArrayXd zero = Eigen::ArrayXd::Zero(n.size());
+        auto a = log_gaussian_derivatives<iT>(tau, t, betatau, gammatau, zero);
+        auto b = log_gaussian_derivatives<iD>(delta, d, eta, epsilon, betadelta);
+        return (n * (t * lntau + d * lndelta - eta * (delta - epsilon).square() - betatau * (tau - gammatau).square() - betadelta * (delta - gammadelta)).exp() * exp_derivative_factor<iT>(a, n.size()) * exp_derivative_factor<iD>(b, n.size())).sum();
+    }
+    bool operator==(const GaussianTermsSoA& o) const {
+        return same_entries(n, o.n) && same_entries(t, o.t) && same_entries(d, o.d) && same_entries(eta, o.eta) && same_entries(epsilon, o.epsilon)
+            && same_entries(betatau, o.betatau) && same_entries(gammatau, o.gammatau) && same_entries(betadelta, o.betadelta) && same_entries(gammadelta, o.gammadelta);
+    }
+};
+
+}
+
+/**
+A container of the terms of an EOS (or departure function), each of which is one of the types in Args
+
+The terms of the kinds with an exponential form (JustPower, Power, Exponential, DoubleExponential, Lemmon2005, Gaussian, GERG2004)
+are also flattened, as they are added, into struct-of-arrays groups by kind. When the arguments are doubles, these groups are evaluated
+with vectorized Eigen expressions that share \f$\ln\tau\f$ and \f$\ln\delta\f$, and only the remaining terms are visited one by one. For
+all other numerical types, and at zero density, all the terms are visited (see alphar_visit).
+*/
 template<typename... Args>
 class EOSTermContainer {  
 private:
+    friend struct internal::MultiFluidBinaryIO;
     using varEOSTerms = std::variant<Args...>;
     std::vector<varEOSTerms> coll;
+    
+    internal::PowerTermsSoA power;
+    internal::DoubleExponentialTermsSoA doubleexponential;
+    internal::GaussianTermsSoA gaussian;
+    std::vector<std::size_t> unflattened; ///< Indices into coll of the terms that are not in the struct-of-arrays groups
+    
+    /// Add the term to its struct-of-arrays group; returns false if it does not belong to any group
+    template<typename Instance>
+    bool flatten(const Instance& e) {
+        using Z = Eigen::ArrayXd;
+        if constexpr (std::is_same_v<Instance, JustPowerEOSTerm>) {
+            power.append(e.n, e.t, e.d, Z::Zero(e.n.size()), Z::Zero(e.n.size()));
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, PowerEOSTerm>) {
+            if (e.l_i.size() != e.n.size()) { return false; } // Left to throw at evaluation time
+            power.append(e.n, e.t, e.d, e.c, e.l_i.template cast<double>());
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, ExponentialEOSTerm>) {
+            if (e.l_i.size() != e.n.size()) { return false; }
+            power.append(e.n, e.t, e.d, e.g, e.l_i.template cast<double>());
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, DoubleExponentialEOSTerm>) {
+            if (e.ld_i.size() != e.n.size()) { return false; }
+            doubleexponential.append(e.n, e.t, e.d, e.gd, e.ld_i.template cast<double>(), e.gt, e.lt);
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, Lemmon2005EOSTerm>) {
+            if (e.l_i.size() != e.n.size()) { return false; }
+            doubleexponential.append(e.n, e.t, e.d, Z::Ones(e.n.size()), e.l_i.template cast<double>(), Z::Ones(e.n.size()), e.m);
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, GaussianEOSTerm>) {
+            gaussian.append(e.n, e.t, e.d, e.eta, e.epsilon, e.beta, e.gamma, Z::Zero(e.n.size()), Z::Zero(e.n.size()));
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, GERG2004EOSTerm>) {
+            gaussian.append(e.n, e.t, e.d, e.eta, e.epsilon, Z::Zero(e.n.size()), Z::Zero(e.n.size()), e.beta, e.gamma);
+            return true;
+        }
+        else if constexpr (std::is_same_v<Instance, NullEOSTerm>) {
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
 public:
 
     auto size() const { return coll.size(); }
@@ -354,10 +586,27 @@ public:
     template<typename Instance>
     auto add_term(Instance&& instance) {
         coll.emplace_back(instance);
+        if (!flatten(static_cast<const std::decay_t<Instance>&>(instance))) {
+            unflattened.push_back(coll.size() - 1);
+        }
+    }
+
+    /// True if no term can contribute, either because there are none or because they are all NullEOSTerm
+    bool is_null() const {
+        return power.n.size() == 0 && doubleexponential.n.size() == 0 && gaussian.n.size() == 0 && unflattened.empty();
+    }
+    
+    /**
+     True if the other container is known to give the same contribution. Only containers whose terms are all in the
+     struct-of-arrays groups can be compared; for the others false is returned
+     */
+    bool has_same_terms(const EOSTermContainer& other) const {
+        return unflattened.empty() && other.unflattened.empty() && power == other.power && doubleexponential == other.doubleexponential && gaussian == other.gaussian;
     }
 
+    /// Evaluate the contribution by visiting each term in turn, valid for all numerical types
     template <class Tau, class Delta>
-    auto alphar(const Tau& tau, const Delta& delta) const {
+    auto alphar_visit(const Tau& tau, const Delta& delta) const {
         std::common_type_t <Tau, Delta> ar = 0.0;
         for (const auto& term : coll) {
             auto contrib = std::visit([&](auto& t) { return t.alphar(tau, delta); }, term);
@@ -365,6 +614,40 @@ public:
         }
         return ar;
     }
+
+    /// Evaluate the contribution for double arguments from the struct-of-arrays groups; delta must be positive
+    double alphar_flattened(const double tau, const double delta) const {
+        const double lntau = log(tau), lndelta = log(delta);
+        double ar = power.alphar(lntau, lndelta) + doubleexponential.alphar(lntau, lndelta) + gaussian.alphar(tau, delta, lntau, lndelta);
+        for (auto i : unflattened) {
+            ar += std::visit([&](auto& t) { return static_cast<double>(t.alphar(tau, delta)); }, coll[i]);
+        }
+        return ar;
+    }
+
+    /**
+     The derivative \f$\tau^{i_T}\delta^{i_D}\partial^{i_T+i_D}\alpha^{\rm r}/\partial\tau^{i_T}\partial\delta^{i_D}\f$ in closed form from the
+     struct-of-arrays groups, for orders up to 4 in each variable. No value is returned if some of the terms are not in the groups,
+     or if tau or delta is not positive
+     */
+    template<int iT, int iD>
+    std::optional<double> alphar_taudelta(const double tau, const double delta) const {
+        if (!unflattened.empty() || !(tau > 0) || !(delta > 0)) {
+            return std::nullopt;
+        }
+        const double lntau = log(tau), lndelta = log(delta);
+        return power.template alphar_deriv<iT, iD>(lntau, lndelta) + doubleexponential.template alphar_deriv<iT, iD>(lntau, lndelta) + gaussian.template alphar_deriv<iT, iD>(tau, delta, lntau, lndelta);
+    }
+
+    template <class Tau, class Delta>
+    auto alphar(const Tau& tau, const Delta& delta) const {
+        if constexpr (std::is_same_v<Tau, double> && std::is_same_v<Delta, double>) {
+            if (delta > 0) {
+                return alphar_flattened(tau, delta);
+            }
+        }
+        return alphar_visit(tau, delta);
+    }
 };
 
 using EOSTerms = EOSTermContainer<JustPowerEOSTerm, PowerEOSTerm, GaussianEOSTerm, NonAnalyticEOSTerm, Lemmon2005EOSTerm, GaoBEOSTerm, ExponentialEOSTerm, DoubleExponentialEOSTerm>;
@@ -256,9 +256,12 @@ namespace teqp {
     };
 
 
+    namespace internal { struct MultiFluidBinaryIO; } // Defined in multifluid_binary.hpp
+
     template<typename... Args>
     class ReducingTermContainer {
     private:
+        friend struct internal::MultiFluidBinaryIO;
         const std::variant<Args...> term;
         auto get_Tc() const { return std::visit([](const auto& t) { return std::cref(t.Tc); }, term); }
         auto get_vc() const { return std::visit([](const auto& t) { return std::cref(t.vc); }, term); }
@@ -12,7 +12,9 @@
 #include "teqp/constants.hpp"
 #include "teqp/json_tools.hpp"
 #include "teqp/models/saft/polar_terms.hpp"
+#include "teqp/models/saft/association.hpp"
 #include <optional>
+#include <array>
 
 namespace teqp {
 namespace PCSAFT {
@@ -28,6 +30,9 @@ struct SAFTCoeffs {
            nmu = 0, ///< number of dipolar segments
            Qstar2 = 0, ///< nondimensional, the reduced quadrupole squared
            nQ = 0; ///< number of quadrupolar segments
+    double epsilon_AB_over_k = 0, ///< [K] association energy
+           kappa_AB = 0; ///< nondimensional, association volume
+    std::vector<std::string> sites; ///< The association sites, one entry per site, like ["e", "H"] for a 2B fluid
 };
 
 /// Manager class for PCSAFT coefficients
@@ -83,22 +88,22 @@ auto C2(const Eta& eta, Mbar mbar) {
         + (1.0 - mbar) * (2.0 * eta * eta * eta + 12.0 * eta * eta - 48.0 * eta + 40.0) / pow((1.0 - eta) * (2.0 - eta), 3)
         ));
 }
-/// Eqn. A.18
+/// Eqn. A.18; the coefficients have a fixed size, so nothing is allocated on the heap
 template<typename TYPE>
 auto get_a(TYPE mbar) {
-    static Eigen::ArrayXd a_0 = (Eigen::ArrayXd(7) << 0.9105631445, 0.6361281449, 2.6861347891, -26.547362491, 97.759208784, -159.59154087, 91.297774084).finished();
-    static Eigen::ArrayXd a_1 = (Eigen::ArrayXd(7) << -0.3084016918, 0.1860531159, -2.5030047259, 21.419793629, -65.255885330, 83.318680481, -33.746922930).finished();
-    static Eigen::ArrayXd a_2 = (Eigen::ArrayXd(7) << -0.0906148351, 0.4527842806, 0.5962700728, -1.7241829131, -4.1302112531, 13.776631870, -8.6728470368).finished();
-    return forceeval(a_0.cast<TYPE>().array() + ((mbar - 1.0) / mbar) * a_1.cast<TYPE>().array() + ((mbar - 1.0) / mbar * (mbar - 2.0) / mbar) * a_2.cast<TYPE>().array()).eval();
+    static const Eigen::Array<double, 7, 1> a_0 = (Eigen::Array<double, 7, 1>() << 0.9105631445, 0.6361281449, 2.6861347891, -26.547362491, 97.759208784, -159.59154087, 91.297774084).finished();
+    static const Eigen::Array<double, 7, 1> a_1 = (Eigen::Array<double, 7, 1>() << -0.3084016918, 0.1860531159, -2.5030047259, 21.419793629, -65.255885330, 83.318680481, -33.746922930).finished();
+    static const Eigen::Array<double, 7, 1> a_2 = (Eigen::Array<double, 7, 1>() << -0.0906148351, 0.4527842806, 0.5962700728, -1.7241829131, -4.1302112531, 13.776631870, -8.6728470368).finished();
+    return Eigen::Array<TYPE, 7, 1>(a_0.cast<TYPE>() + ((mbar - 1.0) / mbar) * a_1.cast<TYPE>() + ((mbar - 1.0) / mbar * (mbar - 2.0) / mbar) * a_2.cast<TYPE>());
 }
-/// Eqn. A.19
+/// Eqn. A.19; the coefficients have a fixed size, so nothing is allocated on the heap
 template<typename TYPE>
 auto get_b(TYPE mbar) {
     // See https://stackoverflow.com/a/35170514/1360263
-    static Eigen::ArrayXd b_0 = (Eigen::ArrayXd(7) << 0.7240946941, 2.2382791861, -4.0025849485, -21.003576815, 26.855641363, 206.55133841, -355.60235612).finished();
-    static Eigen::ArrayXd b_1 = (Eigen::ArrayXd(7) << -0.5755498075, 0.6995095521, 3.8925673390, -17.215471648, 192.67226447, -161.82646165, -165.20769346).finished();
-    static Eigen::ArrayXd b_2 = (Eigen::ArrayXd(7) << 0.0976883116, -0.2557574982, -9.1558561530, 20.642075974, -38.804430052, 93.626774077, -29.666905585).finished();
-    return forceeval(b_0.cast<TYPE>().array() + (mbar - 1.0) / mbar * b_1.cast<TYPE>().array() + (mbar - 1.0) / mbar * (mbar - 2.0) / mbar * b_2.cast<TYPE>().array()).eval();
+    static const Eigen::Array<double, 7, 1> b_0 = (Eigen::Array<double, 7, 1>() << 0.7240946941, 2.2382791861, -4.0025849485, -21.003576815, 26.855641363, 206.55133841, -355.60235612).finished();
+    static const Eigen::Array<double, 7, 1> b_1 = (Eigen::Array<double, 7, 1>() << -0.5755498075, 0.6995095521, 3.8925673390, -17.215471648, 192.67226447, -161.82646165, -165.20769346).finished();
+    static const Eigen::Array<double, 7, 1> b_2 = (Eigen::Array<double, 7, 1>() << 0.0976883116, -0.2557574982, -9.1558561530, 20.642075974, -38.804430052, 93.626774077, -29.666905585).finished();
+    return Eigen::Array<TYPE, 7, 1>(b_0.cast<TYPE>() + (mbar - 1.0) / mbar * b_1.cast<TYPE>() + (mbar - 1.0) / mbar * (mbar - 2.0) / mbar * b_2.cast<TYPE>());
 }
 /// Residual contribution to alphar from hard-sphere (Eqn. A.6)
 template<typename VecType>
@@ -123,6 +128,14 @@ auto gij_HS(const zVecType& zeta, const dVecType& d,
     return forceeval(1.0 / (Upsilon)+d[i] * d[j] / (d[i] + d[j]) * 3.0 * zeta[2] / pow(Upsilon, 2)
         + pow(d[i] * d[j] / (d[i] + d[j]), 2) * 2.0 * pow(zeta[2], 2) / pow(Upsilon, 3));
 }
+/// Term from Eqn. A.7 for i=j, for which d_i*d_j/(d_i+d_j) reduces to d_i/2
+template<typename zVecType, typename dType>
+auto gii_HS(const zVecType& zeta, const dType& di) {
+    auto Upsilon = 1.0 - zeta[3];
+    auto dhalf = di / 2.0;
+    return forceeval(1.0 / (Upsilon) + dhalf * 3.0 * zeta[2] / pow(Upsilon, 2)
+        + pow(dhalf, 2) * 2.0 * pow(zeta[2], 2) / pow(Upsilon, 3));
+}
 /// Eqn. A.16, Eqn. A.29
 template <typename Eta, typename MbarType>
 auto get_I1(const Eta& eta, MbarType mbar) {
@@ -169,18 +182,6 @@ auto sumproduct(const VecType1& v1, const VecType2& v2, const VecType3& v3) {
     return forceeval((v1.template cast<ResultType>().array() * v2.template cast<ResultType>().array() * v3.template cast<ResultType>().array()).sum());
 }
 
-/// Parameters for model evaluation
-template<typename NumType, typename ProductType>
-class SAFTCalc {
-public:
-    // Just temperature dependent things
-    Eigen::ArrayX<NumType> d;
-
-    // These things also have composition dependence
-    ProductType m2_epsilon_sigma3_bar, ///< Eq. A. 12
-                m2_epsilon2_sigma3_bar; ///< Eq. A. 13
-};
-
 /***
  * \brief This class provides the evaluation of the hard chain contribution from classic PC-SAFT
  */
@@ -192,10 +193,43 @@ protected:
         sigma_Angstrom, ///<
         epsilon_over_k; ///< depth of pair potential divided by Boltzman constant
     const Eigen::ArrayXXd kmat; ///< binary interaction parameter matrix
+    const Eigen::ArrayXXd mmeps_sigma3, ///< m_i*m_j*(epsilon_ij/k)*sigma_ij^3, the temperature-independent part of Eq. A.12
+        mmeps2_sigma3; ///< m_i*m_j*(epsilon_ij/k)^2*sigma_ij^3, the temperature-independent part of Eq. A.13
+    
+    /// Build the matrix of m_i*m_j*(epsilon_ij/k)^power*sigma_ij^3 with the combining rules of Eq. A.5
+    auto get_pair_matrix(int power) const {
+        auto N = m.size();
+        Eigen::ArrayXXd o(N, N);
+        for (auto i = 0; i < N; ++i) {
+            for (auto j = 0; j < N; ++j) {
+                auto sigma_ij = 0.5 * sigma_Angstrom[i] + 0.5 * sigma_Angstrom[j];
+                auto eij_over_k = sqrt(epsilon_over_k[i] * epsilon_over_k[j]) * (1.0 - kmat(i,j));
+                o(i, j) = m[i] * m[j] * pow(eij_over_k, power) * pow(sigma_ij, 3);
+            }
+        }
+        return o;
+    }
+    
+    /// The quadratic form x^T*A*x, accumulated column by column so that no temporary is allocated
+    template<typename VecType>
+    static auto quadratic_form(const Eigen::ArrayXXd& A, const VecType& x) {
+        using X = std::decay_t<decltype(x[0])>;
+        X summer = 0.0;
+        for (auto i = 0; i < x.size(); ++i) {
+            summer += x[i] * (A.col(i).template cast<X>() * x.array()).sum();
+        }
+        return summer;
+    }
 
 public:
+    /// Temperature-dependent segment diameter of component i, in A
+    template<typename TTYPE>
+    auto get_di(const TTYPE& T, std::size_t i) const {
+        return forceeval(sigma_Angstrom[i]*(1.0 - 0.12 * exp(-3.0*epsilon_over_k[i]/T)));
+    }
+    
     PCSAFTHardChainContribution(const Eigen::ArrayX<double> &m, const Eigen::ArrayX<double> &mminus1, const Eigen::ArrayX<double> &sigma_Angstrom, const Eigen::ArrayX<double> &epsilon_over_k, const Eigen::ArrayXXd &kmat)
-    : m(m), mminus1(mminus1), sigma_Angstrom(sigma_Angstrom), epsilon_over_k(epsilon_over_k), kmat(kmat) {}
+    : m(m), mminus1(mminus1), sigma_Angstrom(sigma_Angstrom), epsilon_over_k(epsilon_over_k), kmat(kmat), mmeps_sigma3(get_pair_matrix(1)), mmeps2_sigma3(get_pair_matrix(2)) {}
     
     PCSAFTHardChainContribution& operator=( const PCSAFTHardChainContribution& ) = delete; // non copyable
     
@@ -210,20 +244,10 @@ public:
         
         using TRHOType = std::common_type_t<std::decay_t<TTYPE>, std::decay_t<RhoType>, std::decay_t<decltype(mole_fractions[0])>, std::decay_t<decltype(m[0])>>;
         
-        SAFTCalc<TTYPE, TRHOType> c;
-        c.m2_epsilon_sigma3_bar = static_cast<TRHOType>(0.0);
-        c.m2_epsilon2_sigma3_bar = static_cast<TRHOType>(0.0);
-        c.d.resize(N);
-        for (std::size_t i = 0; i < N; ++i) {
-            c.d[i] = sigma_Angstrom[i]*(1.0 - 0.12 * exp(-3.0*epsilon_over_k[i]/T)); // [A]
-            for (std::size_t j = 0; j < N; ++j) {
-                // Eq. A.5
-                auto sigma_ij = 0.5 * sigma_Angstrom[i] + 0.5 * sigma_Angstrom[j];
-                auto eij_over_k = sqrt(epsilon_over_k[i] * epsilon_over_k[j]) * (1.0 - kmat(i,j));
-                c.m2_epsilon_sigma3_bar = c.m2_epsilon_sigma3_bar + mole_fractions[i] * mole_fractions[j] * m[i] * m[j] * eij_over_k / T * pow(sigma_ij, 3);
-                c.m2_epsilon2_sigma3_bar = c.m2_epsilon2_sigma3_bar + mole_fractions[i] * mole_fractions[j] * m[i] * m[j] * pow(eij_over_k / T, 2) * pow(sigma_ij, 3);
-            }
-        }
+        // Eqs. A.12 and A.13; the composition-dependent sums are formed with the precomputed
+        // pair matrices and the temperature is only divided out once at the end
+        TRHOType m2_epsilon_sigma3_bar = quadratic_form(mmeps_sigma3, mole_fractions) / T;
+        TRHOType m2_epsilon2_sigma3_bar = quadratic_form(mmeps2_sigma3, mole_fractions) / (T*T);
         auto mbar = (mole_fractions.template cast<TRHOType>().array()*m.template cast<TRHOType>().array()).sum();
         
         /// Convert from molar density to number density in molecules/Angstrom^3
@@ -232,14 +256,24 @@ public:
         constexpr double MY_PI = EIGEN_PI;
         double pi6 = (MY_PI / 6.0);
         
-        /// Evaluate the components of zeta
-        using ta = std::common_type_t<decltype(pi6), decltype(m[0]), decltype(c.d[0]), decltype(rho_A3)>;
-        std::vector<ta> zeta(4);
+        // Temperature-dependent segment diameter
+        auto get_d = [&](std::size_t i) -> TTYPE { return get_di(T, i); }; // [A]
+        
+        /// Evaluate the components of zeta, Eqn A.8
+        using ta = std::common_type_t<TRHOType, RhoType>;
+        std::array<TRHOType, 4> xmdn;
+        xmdn.fill(static_cast<TRHOType>(0.0));
+        for (std::size_t i = 0; i < N; ++i) {
+            TTYPE di = get_d(i);
+            TRHOType xmdi = mole_fractions[i] * m[i];
+            for (std::size_t n = 0; n < 4; ++n) {
+                xmdn[n] += xmdi;
+                xmdi *= di;
+            }
+        }
+        std::array<ta, 4> zeta;
         for (std::size_t n = 0; n < 4; ++n) {
-            // Eqn A.8
-            auto dn = c.d.pow(n).eval();
-            TRHOType xmdn = forceeval((mole_fractions.template cast<TRHOType>().array()*m.template cast<TRHOType>().array()*dn.template cast<TRHOType>().array()).sum());
-            zeta[n] = forceeval(pi6*rho_A3*xmdn);
+            zeta[n] = forceeval(pi6*rho_A3*xmdn[n]);
         }
         
         /// Packing fraction is the 4-th value in zeta, at index 3
@@ -248,26 +282,28 @@ public:
         auto [I1, etadI1deta] = get_I1(eta, mbar);
         auto [I2, etadI2deta] = get_I2(eta, mbar);
         
-        // Hard chain contribution from G&S
-        using tt = std::common_type_t<decltype(zeta[0]), decltype(c.d[0])>;
-        Eigen::ArrayX<tt> lngii_hs(mole_fractions.size());
-        for (auto i = 0; i < lngii_hs.size(); ++i) {
-            lngii_hs[i] = log(gij_HS(zeta, c.d, i, i));
+        // Hard chain contribution from G&S; the diameters are recalculated rather than stored
+        using tt = std::common_type_t<decltype(zeta[0]), TRHOType>;
+        tt summer_lngii = 0.0;
+        for (std::size_t i = 0; i < N; ++i) {
+            summer_lngii += mole_fractions[i] * mminus1[i] * log(gii_HS(zeta, get_d(i)));
         }
-        auto alphar_hc = forceeval(mbar * get_alphar_hs(zeta) - sumproduct(mole_fractions, mminus1, lngii_hs)); // Eq. A.4
+        auto alphar_hc = forceeval(mbar * get_alphar_hs(zeta) - summer_lngii); // Eq. A.4
         
         // Dispersive contribution
-        auto alphar_disp = forceeval(-2 * MY_PI * rho_A3 * I1 * c.m2_epsilon_sigma3_bar - MY_PI * rho_A3 * mbar * C1(eta, mbar) * I2 * c.m2_epsilon2_sigma3_bar);
+        auto alphar_disp = forceeval(-2 * MY_PI * rho_A3 * I1 * m2_epsilon_sigma3_bar - MY_PI * rho_A3 * mbar * C1(eta, mbar) * I2 * m2_epsilon2_sigma3_bar);
                                      
         using eta_t = decltype(eta);
         using hc_t = decltype(alphar_hc);
         using disp_t = decltype(alphar_disp);
+        using zeta_t = decltype(zeta);
         struct PCSAFTHardChainContributionTerms{
             eta_t eta;
             hc_t alphar_hc;
             disp_t alphar_disp;
+            zeta_t zeta;
         };
-        return PCSAFTHardChainContributionTerms{forceeval(eta), forceeval(alphar_hc), forceeval(alphar_disp)};
+        return PCSAFTHardChainContributionTerms{forceeval(eta), forceeval(alphar_hc), forceeval(alphar_disp), zeta};
     }
 };
 
@@ -292,6 +328,7 @@ protected:
     PCSAFTHardChainContribution hardchain;
     std::optional<PCSAFTDipolarContribution> dipolar; // Can be present or not
     std::optional<PCSAFTQuadrupolarContribution> quadrupolar; // Can be present or not
+    std::optional<association::Association> association; // Can be present or not
 
     void check_kmat(std::size_t N) {
         if (kmat.cols() != kmat.rows()) {
@@ -355,9 +392,31 @@ protected:
         }
         return PCSAFTQuadrupolarContribution(m, sigma_Angstrom, epsilon_over_k, Qstar2, nQ);
     }
+    auto build_association(const std::vector<SAFTCoeffs> &coeffs, const std::optional<nlohmann::json>& association_flags) -> std::optional<association::Association>{
+        std::vector<std::vector<std::string>> molecule_sites;
+        std::size_t Nsites = 0;
+        for (const auto &coeff : coeffs) {
+            molecule_sites.push_back(coeff.sites);
+            Nsites += coeff.sites.size();
+        }
+        if (Nsites == 0){
+            return std::nullopt; // No association contribution is present
+        }
+        // Combining rules of Wolbach and Sandler; kappa_ij*sigma_ij^3 is the bonding volume in A^3
+        auto N = coeffs.size();
+        Eigen::ArrayXXd epsilon_AB_over_k(N, N), volume_AB(N, N);
+        for (auto i = 0U; i < N; ++i) {
+            for (auto j = 0U; j < N; ++j) {
+                epsilon_AB_over_k(i, j) = (coeffs[i].epsilon_AB_over_k + coeffs[j].epsilon_AB_over_k)/2.0;
+                volume_AB(i, j) = sqrt(coeffs[i].kappa_AB*coeffs[j].kappa_AB)*pow(coeffs[i].sigma_Angstrom*coeffs[j].sigma_Angstrom, 1.5);
+            }
+        }
+        auto options = (association_flags) ? association::get_association_options(association_flags.value()) : association::AssociationOptions{};
+        return association::Association(molecule_sites, epsilon_AB_over_k, volume_AB, options);
+    }
 public:
     PCSAFTMixture(const std::vector<std::string> &names, const Eigen::ArrayXXd& kmat = {}) : PCSAFTMixture(get_coeffs_from_names(names), kmat){};
-    PCSAFTMixture(const std::vector<SAFTCoeffs> &coeffs, const Eigen::ArrayXXd &kmat = {}) : kmat(kmat), hardchain(build_hardchain(coeffs)), dipolar(build_dipolar(coeffs)), quadrupolar(build_quadrupolar(coeffs)) {};
+    PCSAFTMixture(const std::vector<SAFTCoeffs> &coeffs, const Eigen::ArrayXXd &kmat = {}, const std::optional<nlohmann::json>& association_flags = std::nullopt) : kmat(kmat), hardchain(build_hardchain(coeffs)), dipolar(build_dipolar(coeffs)), quadrupolar(build_quadrupolar(coeffs)), association(build_association(coeffs, association_flags)) {};
     
 //    PCSAFTMixture( const PCSAFTMixture& ) = delete; // non construction-copyable
     PCSAFTMixture& operator=( const PCSAFTMixture& ) = delete; // non copyable
@@ -366,6 +425,7 @@ public:
     auto get_sigma_Angstrom() const { return sigma_Angstrom; }
     auto get_epsilon_over_k_K() const { return epsilon_over_k; }
     auto get_kmat() const { return kmat; }
+    const auto& get_association() const { return association; }
 
     auto print_info() {
         std::string s = std::string("i m sigma / A e/kB / K \n  ++++++++++++++") + "\n";
@@ -407,6 +467,15 @@ public:
             auto valsquad = quadrupolar.value().eval(T, rho_A3, vals.eta, mole_fractions);
             alphar += valsquad.alpha;
         }
+        // If association is present, add its contribution, with the contact value of the hard-sphere
+        // radial distribution function from Eqn. A.7 for the pair of components
+        if (association){
+            auto gij = [&](std::size_t i, std::size_t j){
+                std::array<TTYPE, 2> d{hardchain.get_di(T, i), hardchain.get_di(T, j)};
+                return gij_HS(vals.zeta, d, 0, 1);
+            };
+            alphar += association.value().alphar(T, rho_A3, mole_fractions, gij);
+        }
         return forceeval(alphar);
     }
 };
@@ -442,12 +511,21 @@ inline auto PCSAFTfactory(const nlohmann::json& spec) {
                 c.Qstar2 = j.at("(Q^*)^2");
                 c.nQ = j.at("nQ");
             }
+            if (j.contains("sites")){
+                c.sites = j.at("sites").get<std::vector<std::string>>();
+                c.epsilon_AB_over_k = j.at("epsilon_AB_over_k");
+                c.kappa_AB = j.at("kappa_AB");
+            }
             coeffs.push_back(c);
         }
         if (kmat && kmat.value().rows() != coeffs.size()){
             throw teqp::InvalidArgument("Provided length of coeffs of " + std::to_string(coeffs.size()) + " does not match the dimension of the kmat of " + std::to_string(kmat.value().rows()));
         }
-        return PCSAFTMixture(coeffs, kmat.value_or(Eigen::ArrayXXd{}));
+        std::optional<nlohmann::json> association_flags = std::nullopt;
+        if (spec.contains("association_flags")){
+            association_flags = spec["association_flags"];
+        }
+        return PCSAFTMixture(coeffs, kmat.value_or(Eigen::ArrayXXd{}), association_flags);
     }
     else{
         throw std::invalid_argument("you must provide names or coeffs, but not both");
@@ -0,0 +1,321 @@
+#pragma once
+
+/**
+ This header contains methods that pertain to the association contribution to SAFT models,
+ following the first-order thermodynamic perturbation theory (TPT1) of Wertheim
+
+ The association term only needs the association strength between pairs of sites, so the bookkeeping of
+ the sites and the solver for the fractions of non-bonded sites are collected here, and the models
+ (PC-SAFT, SAFT-VR-Mie, ...) only provide the kernel of the association strength between components
+ */
+
+#include "teqp/types.hpp"
+#include "teqp/exceptions.hpp"
+#include "nlohmann/json.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace teqp{
+
+namespace association{
+
+/// Options controlling the sites that interact and the solver for the fractions of non-bonded sites
+struct AssociationOptions{
+    /// Which site types can bond with which; a site type that is not a key does not bond with anything
+    std::map<std::string, std::vector<std::string>> interaction_partners = {{"e", {"H"}}, {"H", {"e"}}, {"A", {"B"}}, {"B", {"A"}}};
+    double alpha = 0.5; ///< Damping factor of the successive substitution; the new value is alpha*X_old + (1-alpha)*X_new
+    int Nsubstitution = 5; ///< Number of successive substitution steps before switching to Newton
+    int maxiter = 100; ///< Maximum number of Newton steps
+    double tol = 1e-14; ///< Convergence tolerance on the largest change in the fraction of non-bonded sites
+};
+
+/// Read the AssociationOptions from JSON, keeping the defaults for any fields that are not provided
+inline auto get_association_options(const nlohmann::json& j){
+    AssociationOptions opt;
+    if (j.contains("interaction_partners")){
+        opt.interaction_partners = j.at("interaction_partners").get<std::map<std::string, std::vector<std::string>>>();
+    }
+    if (j.contains("alpha")){ opt.alpha = j.at("alpha"); }
+    if (j.contains("Nsubstitution")){ opt.Nsubstitution = j.at("Nsubstitution"); }
+    if (j.contains("maxiter")){ opt.maxiter = j.at("maxiter"); }
+    if (j.contains("tol")){ opt.tol = j.at("tol"); }
+    return opt;
+}
+
+/**
+ The unique sites in the mixture. The sites of a molecule that have the same type (the two H of water in
+ the 4C scheme, for instance) are identical, so only one fraction is solved for and the multiplicity
+ accounts for the rest
+ */
+struct AssociationSites{
+    std::vector<std::string> names; ///< The type of each unique site
+    std::vector<std::size_t> component; ///< The index of the component to which each unique site belongs
+    Eigen::ArrayXd multiplicity; ///< The number of sites of this type on the molecule
+    Eigen::ArrayXX<bool> interacts; ///< Whether the site in the row can bond with the site in the column
+
+    AssociationSites(const std::vector<std::vector<std::string>>& molecule_sites, const AssociationOptions& options){
+        std::vector<double> counts;
+        for (auto i = 0U; i < molecule_sites.size(); ++i){
+            std::map<std::string, int> counter;
+            for (const auto& site : molecule_sites[i]){
+                counter[site] += 1;
+            }
+            for (const auto& [site, count] : counter){
+                names.push_back(site);
+                component.push_back(i);
+                counts.push_back(count);
+            }
+        }
+        multiplicity = Eigen::Map<const Eigen::ArrayXd>(counts.data(), counts.size());
+
+        auto N = names.size();
+        interacts.resize(N, N);
+        for (auto k = 0U; k < N; ++k){
+            for (auto l = 0U; l < N; ++l){
+                auto it = options.interaction_partners.find(names[k]);
+                interacts(k, l) = (it != options.interaction_partners.end() && std::find(it->second.begin(), it->second.end(), names[l]) != it->second.end());
+            }
+        }
+        for (auto k = 0U; k < N; ++k){
+            for (auto l = 0U; l < N; ++l){
+                if (interacts(k, l) != interacts(l, k)){
+                    throw teqp::InvalidArgument("The interaction partners must be symmetric, but " + names[k] + " and " + names[l] + " are not");
+                }
+            }
+        }
+    }
+    auto size() const { return names.size(); }
+};
+
+namespace internal{
+
+/// The highest total order of the derivatives that teqp takes with multicomplex numbers through AbstractModel
+/// (ARXY_args and AR0N_args); the dimension of a multicomplex number is not part of its type
+constexpr int max_multicomplex_order = 6;
+
+/**
+ The number of chord steps needed to carry the solution for the site fractions, obtained in double precision, over to the numerical type T.
+
+ Each step makes one more order of the derivatives exact and reduces the error of the value by the relative precision of double, so:
+ - double needs none
+ - the autodiff types need as many as the order of their derivatives
+ - complex step derivatives need one
+ - extended precision types need enough to reach their number of binary digits
+ - multicomplex numbers of dimension up to max_multicomplex_order are exact; higher-order multicomplex derivatives through the
+   templated interface (VirialDerivatives::get_Bnvir<Nderiv> with Nderiv above 6, for instance) are not
+ */
+template<typename T>
+constexpr int propagation_steps(){
+    using namespace autodiff::detail;
+    using TT = std::decay_t<T>;
+    if constexpr (std::is_same_v<TT, double>){
+        return 0;
+    }
+    else if constexpr (isDual<TT> || isReal<TT>){
+        return NumberTraits<TT>::Order;
+    }
+    else if constexpr (is_complex_t<TT>()){
+        return 1;
+    }
+    else if constexpr (is_mcx_t<TT>()){
+        return max_multicomplex_order;
+    }
+    else{
+        constexpr int digits = std::numeric_limits<TT>::digits, double_digits = std::numeric_limits<double>::digits;
+        static_assert(digits > 0, "The number of digits of this numerical type is not known");
+        return (digits + double_digits - 1)/double_digits;
+    }
+}
+
+}
+
+/**
+ \brief Solve for the fractions of non-bonded sites
+
+ The mass-action equations \f$X_k(1+\sum_l M_{kl}X_l) = 1\f$, with \f$M_{kl} = \rho_N x_l n_l \Delta_{kl}\f$, are solved
+ with a few damped successive substitution steps followed by Newton's method, all in double precision.
+
+ For numerical types that carry derivatives, the derivatives of the fractions follow from the implicit
+ function theorem rather than from iterating with the derivative types. Starting from the converged
+ values, each step \f$X \leftarrow X - J^{-1}F(X)\f$, with \f$F\f$ evaluated in the derivative type and the
+ Jacobian \f$J\f$ at the solution in double precision, makes one more order of the derivatives exact; the
+ number of steps follows from the type (see internal::propagation_steps).
+
+ \param sites The unique sites
+ \param Delta The association strength between each pair of unique sites, in units of volume per molecule
+ \param rhoN The number density, in molecules per the unit of volume of Delta
+ \param molefrac The mole fractions of the components
+ \param options The solver options
+ */
+template<typename DeltaType, typename RhoType, typename VecType>
+auto solve_X(const AssociationSites& sites, const Eigen::ArrayXX<DeltaType>& Delta, const RhoType& rhoN, const VecType& molefrac, const AssociationOptions& options){
+    using MType = std::common_type_t<DeltaType, RhoType, std::decay_t<decltype(molefrac[0])>>;
+    const auto N = static_cast<Eigen::Index>(sites.size());
+    if (N == 0){
+        // No component has sites, so there is nothing to solve; the convergence check of the Newton
+        // steps below takes the maximum over the steps and must not be reached with an empty vector
+        return Eigen::ArrayX<MType>(0);
+    }
+
+    Eigen::ArrayXX<MType> M(N, N);
+    Eigen::MatrixXd M0(N, N);
+    for (auto k = 0; k < N; ++k){
+        for (auto l = 0; l < N; ++l){
+            M(k, l) = forceeval(rhoN*molefrac[sites.component[l]]*sites.multiplicity[l]*Delta(k, l));
+            M0(k, l) = static_cast<double>(getbaseval(M(k, l)));
+        }
+    }
+
+    // Damped successive substitution to get into the neighborhood of the solution
+    Eigen::VectorXd X = Eigen::VectorXd::Ones(N);
+    for (auto it = 0; it < options.Nsubstitution; ++it){
+        X = (options.alpha*X.array() + (1.0-options.alpha)/(1.0 + (M0*X).array())).matrix();
+    }
+    // Newton's method to polish
+    Eigen::MatrixXd J(N, N);
+    bool converged = false;
+    for (auto it = 0; it < options.maxiter; ++it){
+        Eigen::VectorXd MX = M0*X;
+        Eigen::VectorXd F = (X.array()*(1.0 + MX.array()) - 1.0).matrix();
+        J = X.asDiagonal()*M0;
+        J.diagonal() += (1.0 + MX.array()).matrix();
+        Eigen::VectorXd dX = J.partialPivLu().solve(F);
+        for (auto k = 0; k < N; ++k){
+            // The fractions are in (0, 1], so do not let a step leave that range
+            auto Xnew = X[k] - dX[k];
+            X[k] = (Xnew <= 0) ? X[k]/2.0 : std::min(Xnew, 1.0);
+        }
+        if (dX.cwiseAbs().maxCoeff() < options.tol){
+            converged = true;
+            break;
+        }
+    }
+    if (!converged){
+        throw teqp::IterationFailure("Fractions of non-bonded sites did not converge in " + std::to_string(options.maxiter) + " Newton steps");
+    }
+
+    // Propagate the derivatives with the Jacobian at the solution
+    Eigen::ArrayX<MType> Xg = X.array().template cast<MType>();
+    constexpr int Nsteps = internal::propagation_steps<MType>();
+    if constexpr (Nsteps > 0){
+        Eigen::VectorXd MX = M0*X;
+        J = X.asDiagonal()*M0;
+        J.diagonal() += (1.0 + MX.array()).matrix();
+        Eigen::MatrixXd Jinv = J.inverse();
+        Eigen::ArrayX<MType> F(N);
+        for (auto step = 0; step < Nsteps; ++step){
+            for (auto k = 0; k < N; ++k){
+                MType summer = 0.0;
+                for (auto l = 0; l < N; ++l){
+                    summer += M(k, l)*Xg[l];
+                }
+                F[k] = forceeval(Xg[k]*(1.0 + summer) - 1.0);
+            }
+            for (auto k = 0; k < N; ++k){
+                MType summer = 0.0;
+                for (auto l = 0; l < N; ++l){
+                    summer += Jinv(k, l)*F[l];
+                }
+                Xg[k] = forceeval(Xg[k] - summer);
+            }
+        }
+    }
+    return Xg;
+}
+
+/**
+ \brief Expand the association strength between components to the matrix between the unique sites
+ \param sites The unique sites
+ \param Deltaij Callable returning the association strength between components i and j, for sites that can bond
+ */
+template<typename DeltaFunc>
+auto get_site_Delta(const AssociationSites& sites, const DeltaFunc& Deltaij){
+    using DeltaType = std::decay_t<decltype(Deltaij(0, 0))>;
+    const auto N = static_cast<Eigen::Index>(sites.size());
+    Eigen::ArrayXX<DeltaType> Delta(N, N);
+    for (auto k = 0; k < N; ++k){
+        for (auto l = k; l < N; ++l){
+            Delta(k, l) = (sites.interacts(k, l)) ? Deltaij(sites.component[k], sites.component[l]) : static_cast<DeltaType>(0.0);
+            Delta(l, k) = Delta(k, l);
+        }
+    }
+    return Delta;
+}
+
+/**
+ \brief The contribution to the residual Helmholtz energy from the fractions of non-bonded sites
+ \f[
+ \alpha^{\rm r}_{\rm assoc} = \sum_i x_i \sum_{A\in i} n_A\left(\ln X_A - \frac{X_A}{2} + \frac{1}{2}\right)
+ \f]
+ */
+template<typename XType, typename VecType>
+auto get_alphar(const AssociationSites& sites, const Eigen::ArrayX<XType>& X, const VecType& molefrac){
+    std::common_type_t<XType, std::decay_t<decltype(molefrac[0])>> summer = 0.0;
+    for (auto k = 0; k < X.size(); ++k){
+        summer += molefrac[sites.component[k]]*sites.multiplicity[k]*(log(X[k]) - X[k]/2.0 + 0.5);
+    }
+    return forceeval(summer);
+}
+
+/**
+ \brief The association contribution of Wertheim's TPT1, for arbitrary site schemes and cross-association
+
+ The association strength between site A on molecule i and site B on molecule j is
+ \f[
+ \Delta^{A_iB_j} = g_{ij}\,V_{ij}\left[\exp\left(\frac{\varepsilon_{ij}}{k_BT}\right)-1\right]
+ \f]
+ where \f$g_{ij}\f$ is the kernel that the model provides (the contact value of the hard-sphere radial distribution
+ function for PC-SAFT, the integral \f$I_{ij}\f$ of Dufal et al. for SAFT-VR-Mie), and the energy \f$\varepsilon_{ij}/k_B\f$ and the bonding volume \f$V_{ij}\f$ are matrices in the components, with
+ the combining rules already applied by the model
+ */
+class Association{
+private:
+    const AssociationSites sites;
+    const Eigen::ArrayXXd epsilon_AB_over_k; ///< [K] association energy between components
+    const Eigen::ArrayXXd volume_AB; ///< bonding volume between components, in the units of volume of the number density
+    const AssociationOptions options;
+
+public:
+    Association(const std::vector<std::vector<std::string>>& molecule_sites, const Eigen::ArrayXXd& epsilon_AB_over_k, const Eigen::ArrayXXd& volume_AB, const AssociationOptions& options = {})
+    : sites(molecule_sites, options), epsilon_AB_over_k(epsilon_AB_over_k), volume_AB(volume_AB), options(options) {
+        auto N = molecule_sites.size();
+        if (epsilon_AB_over_k.rows() != N || epsilon_AB_over_k.cols() != N || volume_AB.rows() != N || volume_AB.cols() != N){
+            throw teqp::InvalidArgument("The association energy and volume matrices must be square, with the number of components as dimension");
+        }
+    }
+
+    const auto& get_sites() const { return sites; }
+
+    /// The association strength between each pair of unique sites, given the kernel of the model in gij(i, j)
+    template<typename TType, typename GFunc>
+    auto get_Delta(const TType& T, const GFunc& gij) const {
+        return get_site_Delta(sites, [&](std::size_t i, std::size_t j){
+            return forceeval(gij(i, j)*volume_AB(i, j)*(exp(epsilon_AB_over_k(i, j)/T) - 1.0));
+        });
+    }
+
+    /// The fractions of non-bonded sites, in the order of the unique sites
+    template<typename TType, typename RhoType, typename VecType, typename GFunc>
+    auto get_X(const TType& T, const RhoType& rhoN, const VecType& molefrac, const GFunc& gij) const {
+        return solve_X(sites, get_Delta(T, gij), rhoN, molefrac, options);
+    }
+
+    /**
+     \brief The contribution to the residual Helmholtz energy, see get_alphar
+     \param T Temperature, in K
+     \param rhoN Number density, in molecules per the unit of volume of the bonding volume
+     \param molefrac Mole fractions
+     \param gij Callable returning the kernel of the association strength between components i and j
+     */
+    template<typename TType, typename RhoType, typename VecType, typename GFunc>
+    auto alphar(const TType& T, const RhoType& rhoN, const VecType& molefrac, const GFunc& gij) const {
+        return get_alphar(sites, get_X(T, rhoN, molefrac, gij), molefrac);
+    }
+};
+
+}
+}
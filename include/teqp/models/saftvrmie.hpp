@@ -13,8 +13,11 @@
 #include "teqp/constants.hpp"
 #include "teqp/math/quadrature.hpp"
 #include "teqp/models/saft/polar_terms.hpp"
+#include "teqp/models/saft/association.hpp"
 #include <optional>
 #include <variant>
+#include <algorithm>
+#include <array>
 
 namespace teqp {
 namespace SAFTVRMie {
@@ -30,7 +33,10 @@ struct SAFTVRMieCoeffs {
         mustar2 = 0, ///< nondimensional, the reduced dipole moment squared
         nmu = 0, ///< number of dipolar segments
         Qstar2 = 0, ///< nondimensional, the reduced quadrupole squared
-        nQ = 0; ///< number of quadrupolar segments
+        nQ = 0, ///< number of quadrupolar segments
+        epsilon_AB_over_k = 0, ///< [K] association energy
+        K_AB_Angstrom3 = 0; ///< [A^3] association bonding volume
+    std::vector<std::string> sites; ///< The association sites, one entry per site, like ["e", "e", "H", "H"] for a 4C fluid
     std::string BibTeXKey; ///< The BibTeXKey for the reference for these coefficients
 };
 
@@ -81,6 +87,122 @@ public:
     }
 };
 
+/**
+ A piecewise Chebyshev expansion of the hard-sphere diameter \f$d_{ii}(T)\f$ of one component, fit at construction to the
+ values obtained by quadrature. The intervals are evenly spaced in \f$\ln T\f$, so finding the interval is O(1).
+
+ The expansions are evaluated with Clenshaw's method for any numerical type, so derivatives with respect to T
+ (autodiff, complex step, multicomplex) are the derivatives of the expansion
+ */
+class DiameterSurrogate {
+private:
+    struct Interval {
+        double Tmin, Tmax;
+        Eigen::ArrayXd coeff;
+    };
+    std::vector<Interval> intervals;
+    double lnTmin, lnTmax, dlnT;
+public:
+    /**
+     \param f The function that returns the exact value of d(T) for a double T
+     \param Tmin The minimum temperature of the expansions, in K
+     \param Tmax The maximum temperature of the expansions, in K
+     \param Nintervals The number of intervals
+     \param degree The degree of the expansion in each interval
+     */
+    template<typename Function>
+    DiameterSurrogate(const Function& f, double Tmin, double Tmax, int Nintervals, int degree)
+        : lnTmin(log(Tmin)), lnTmax(log(Tmax)), dlnT((log(Tmax) - log(Tmin))/Nintervals)
+    {
+        if (!(Tmin > 0) || !(Tmax > Tmin)) {
+            throw teqp::InvalidArgument("The temperature range of the diameter expansions must satisfy 0 < Tmin < Tmax");
+        }
+        if (Nintervals < 1 || degree < 2) {
+            throw teqp::InvalidArgument("The diameter expansions need at least one interval and a degree of at least 2");
+        }
+        constexpr double MY_PI = static_cast<double>(EIGEN_PI);
+        for (auto k = 0; k < Nintervals; ++k) {
+            double a = exp(lnTmin + k*dlnT), b = (k == Nintervals-1) ? Tmax : exp(lnTmin + (k+1)*dlnT);
+            // Values at the Chebyshev-Lobatto nodes, and the coefficients from the discrete cosine transform of them
+            Eigen::ArrayXd fnodes(degree + 1);
+            for (auto n = 0; n <= degree; ++n) {
+                double x = cos(MY_PI*n/degree);
+                fnodes[n] = f((b - a)/2.0*x + (b + a)/2.0);
+            }
+            Eigen::ArrayXd coeff(degree + 1);
+            for (auto j = 0; j <= degree; ++j) {
+                double summer = 0;
+                for (auto n = 0; n <= degree; ++n) {
+                    double w = (n == 0 || n == degree) ? 0.5 : 1.0;
+                    summer += w*fnodes[n]*cos(MY_PI*j*n/degree);
+                }
+                coeff[j] = 2.0/degree*summer*((j == 0 || j == degree) ? 0.5 : 1.0);
+            }
+            intervals.push_back(Interval{a, b, coeff});
+        }
+    }
+    
+    /// True if T (in K) is within the range of the expansions
+    bool contains(double T) const {
+        return T >= intervals.front().Tmin && T <= intervals.back().Tmax;
+    }
+    
+    /// Evaluate the expansion; the base value of T must be within the range of the expansions
+    template<typename TType>
+    TType operator()(const TType& T) const {
+        double Tbase = getbaseval(T);
+        auto k = std::clamp(static_cast<int>((log(Tbase) - lnTmin)/dlnT), 0, static_cast<int>(intervals.size()) - 1);
+        const auto& I = intervals[k];
+        TType x = (2.0*T - (I.Tmax + I.Tmin))/(I.Tmax - I.Tmin);
+        const auto Norder = static_cast<int>(I.coeff.size()) - 1;
+        TType u_k = 0.0, u_kp1 = I.coeff[Norder], u_kp2 = 0.0;
+        for (auto j = Norder - 1; j > 0; --j) {
+            u_k = forceeval(2.0*x*u_kp1 - u_kp2 + I.coeff[j]);
+            u_kp2 = u_kp1; u_kp1 = u_k;
+        }
+        return forceeval(I.coeff[0] + x*u_kp1 - u_kp2);
+    }
+};
+
+/**
+ The integral \f$I_{ij}\f$ in the association strength \f$\Delta_{ij} = F_{ij}K_{ij}I_{ij}\f$ of SAFT-VR-Mie, from Dufal et al.,
+ Mol. Phys., 2015, correlated for the Lennard-Jones fluid as
+ \f[
+ I_{ij} = \sum_{p=0}^{10}\sum_{q=0}^{10-p}c_{pq}(\rho_s\sigma_x^3)^p(T^*_{ij})^q
+ \f]
+ with \f$T^*_{ij} = k_BT/\varepsilon_{ij}\f$ and \f$\sigma_x^3 = \sum_i\sum_j x_{s,i}x_{s,j}\sigma_{ij}^3\f$
+ */
+struct DufalAssociationIntegral{
+    
+    /// The coefficients \f$c_{pq}\f$, with p in the row and q in the column
+    const Eigen::Matrix<double, 11, 11> c{(Eigen::Matrix<double, 11, 11>() <<
+        7.56425183020431e-02, -1.28667137050961e-01, 1.28350632316055e-01, -7.25321780970292e-02, 2.57782547511452e-02, -6.01170055221687e-03, 9.33363147191978e-04, -9.55607377143667e-05, 6.19576039900837e-06, -2.30466608213628e-07, 3.74605718435540e-09,
+        1.34228218276565e-01, -1.82682168504886e-01, 7.71662412959262e-02, -7.17458641164565e-04, -8.72427344283170e-03, 2.97971836051287e-03, -4.84863997651451e-04, 4.35262491516424e-05, -2.07789181640066e-06, 4.13749349344802e-08, 0,
+        -5.65116428942893e-01, 1.00930692226792e+00, -6.60166945915607e-01, 2.14492212294301e-01, -3.88462990166792e-02, 4.06016982985030e-03, -2.39515566373142e-04, 7.25488368831468e-06, -8.58904640281928e-08, 0, 0,
+        -3.87336382687019e-01, -2.11614570109503e-01, 4.50442894490509e-01, -1.76931752538907e-01, 3.17171522104923e-02, -2.91368915845693e-03, 1.30193710011706e-04, -2.14505500786531e-06, 0, 0, 0,
+        2.13713180911797e+00, -2.02798460133021e+00, 3.36709255682693e-01, 1.18106507393722e-03, -6.00058423301506e-03, 6.26343952584415e-04, -2.03636395699819e-05, 0, 0, 0, 0,
+        -3.00527494795524e-01, 2.89920714512243e+00, -5.67134839686498e-01, 5.18085125423494e-02, -2.39326776760414e-03, 4.15107362643844e-05, 0, 0, 0, 0, 0,
+        -6.21028065719194e+00, -1.92883360342573e+00, 2.84109761066570e-01, -1.57606767372364e-02, 3.68599073256615e-04, 0, 0, 0, 0, 0, 0,
+        1.16083532818029e+01, 7.42215544511197e-01, -8.23976531246117e-02, 1.86167650098254e-03, 0, 0, 0, 0, 0, 0, 0,
+        -1.02632535542427e+01, -1.25035689035085e-01, 1.14299144831867e-02, 0, 0, 0, 0, 0, 0, 0, 0,
+        4.65297446837297e+00, -1.92518067137033e-03, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        -8.67296219639940e-01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0).finished()};
+    
+    /// The integral at the reduced temperature \f$T^*_{ij}\f$ and reduced density \f$\rho_s\sigma_x^3\f$, with Horner's method in both variables
+    template<typename TType, typename RhoType>
+    auto get_I(const TType& Tstar, const RhoType& rhostar) const {
+        std::common_type_t<TType, RhoType> outer = 0.0;
+        for (auto p = 10; p >= 0; --p){
+            TType inner = 0.0;
+            for (auto q = 10 - p; q >= 0; --q){
+                inner = forceeval(inner*Tstar + c(p, q));
+            }
+            outer = forceeval(outer*rhostar + inner);
+        }
+        return outer;
+    }
+};
+
 /// Things that only depend on the components themselves, but not on composition, temperature, or density
 struct SAFTVRMieChainContributionTerms{
     private:
@@ -236,6 +358,79 @@ struct SAFTVRMieChainContributionTerms{
         return get_cij(lambda_r_ij + lambda_a_ij);
     }
     
+    /// The exponents of the pair potential that appear in a_1, a_2 and the chain term
+    enum ExponentIndex { kA = 0, kR, k2A, k2R, kAR, kNexponents };
+    
+    /**
+     Everything about an \f$ij\f$ pair that depends only on the parameters, stored contiguously, one entry per pair with \f$i\leq j\f$,
+     so that the per-call loop over the pairs only does the state-dependent arithmetic
+     */
+    struct PairConstants {
+        std::size_t i, j;
+        double factor; ///< 1 for i == j, 2 otherwise because the off-diagonal terms contribute twice
+        double sigma, sigma3, epsilon, C;
+        double eps2piC; ///< \f$2\pi\epsilon_{ij}C_{ij}\f$, for a_1
+        double a2pre; ///< \f$0.5\epsilon_{ij}C_{ij}^2(2\pi\epsilon_{ij})\f$, for a_2
+        double f1, f2, f3; ///< Coefficients of \f$\chi_{ij}\f$
+        double a3pre, f5, f6; ///< \f$-\epsilon_{ij}^3 f_4\f$ and the coefficients in the exponential of a_3
+        double gammacpre; ///< \f$\phi_{7,0}(1-\tanh(\phi_{7,1}(\phi_{7,2}-\alpha_{ij})))\f$, for \f$\gamma_{c,ij}\f$
+        std::array<double, kNexponents> lambda; ///< The exponents, indexed by ExponentIndex
+        std::array<std::array<double, 4>, kNexponents> c; ///< The coefficients of Eq. A17 for each exponent
+    };
+    
+    std::vector<PairConstants> get_pairs() const {
+        std::vector<PairConstants> o;
+        constexpr double MY_PI = static_cast<double>(EIGEN_PI);
+        auto phi7 = phi.col(6);
+        for (auto i = 0U; i < N; ++i){
+            for (auto j = i; j < N; ++j){
+                PairConstants p;
+                p.i = i; p.j = j;
+                p.factor = (i == j) ? 1.0 : 2.0;
+                p.sigma = sigma_ij(i,j); p.sigma3 = POW3(p.sigma);
+                p.epsilon = epsilon_ij(i,j); p.C = C_ij(i,j);
+                p.eps2piC = 2.0*MY_PI*p.epsilon*p.C;
+                p.a2pre = 0.5*p.epsilon*POW2(p.C)*(2.0*MY_PI*p.epsilon);
+                p.f1 = fkij[1](i,j); p.f2 = fkij[2](i,j); p.f3 = fkij[3](i,j);
+                p.a3pre = -POW3(p.epsilon)*fkij[4](i,j); p.f5 = fkij[5](i,j); p.f6 = fkij[6](i,j);
+                p.gammacpre = phi7(0)*(-tanh(phi7(1)*(phi7(2)-alpha_ij(i,j)))+1.0);
+                const double la = lambda_a_ij(i,j), lr = lambda_r_ij(i,j);
+                p.lambda = {la, lr, 2.0*la, 2.0*lr, la + lr};
+                const std::array<const std::vector<Eigen::ArrayXXd>*, kNexponents> cs = {&canij, &crnij, &c2anij, &c2rnij, &carnij};
+                for (auto k = 0; k < kNexponents; ++k){
+                    for (auto n = 0; n < 4; ++n){
+                        p.c[k][n] = (*cs[k])[n](i,j);
+                    }
+                }
+                o.push_back(p);
+            }
+        }
+        return o;
+    }
+    
+    /**
+     Build the Chebyshev expansions of the diameters if the flags contain an entry like
+     \code
+     "dii_surrogate": {"Tmin / K": 50, "Tmax / K": 2000}
+     \endcode
+     optionally with "Nintervals" and "degree". Otherwise no expansions are built and the diameters are always obtained by quadrature
+     */
+    std::vector<DiameterSurrogate> get_dii_surrogates(const std::optional<nlohmann::json>& flags) const {
+        std::vector<DiameterSurrogate> surrogates;
+        if (!flags || !flags.value().contains("dii_surrogate")) {
+            return surrogates;
+        }
+        const nlohmann::json& j = flags.value().at("dii_surrogate");
+        double Tmin = j.at("Tmin / K"), Tmax = j.at("Tmax / K");
+        int Nintervals = j.value("Nintervals", static_cast<int>(ceil(log(Tmax/Tmin)/log(1.25))));
+        int degree = j.value("degree", 12);
+        for (auto i = 0U; i < N; ++i) {
+            auto f = [this, i](double T) { return get_dii(i, T); };
+            surrogates.emplace_back(f, Tmin, Tmax, Nintervals, degree);
+        }
+        return surrogates;
+    }
+    
     EpsilonijFlags get_epsilon_ij(const std::optional<nlohmann::json>& flags){
         if (flags){
             const nlohmann::json& j = flags.value();
@@ -260,6 +455,9 @@ struct SAFTVRMieChainContributionTerms{
 
     const std::vector<Eigen::ArrayXXd> crnij, canij, c2rnij, c2anij, carnij;
     const std::vector<Eigen::ArrayXXd> fkij; // Matrices of parameters
+    
+    const std::vector<DiameterSurrogate> dii_surrogates; ///< The optional Chebyshev expansions of the diameters, one per component
+    const std::vector<PairConstants> pairs; ///< The parameter-only quantities of the pairs with i <= j
 
     SAFTVRMieChainContributionTerms(
             const Eigen::ArrayXd& m,
@@ -277,7 +475,9 @@ struct SAFTVRMieChainContributionTerms{
         sigma_ij(get_sigma_ij()), epsilon_ij(get_epsilon_ij()),
         crnij(get_crnij()), canij(get_canij()),
         c2rnij(get_c2rnij()), c2anij(get_c2anij()), carnij(get_carnij()),
-        fkij(get_fkij())
+        fkij(get_fkij()),
+        dii_surrogates(get_dii_surrogates(flags)),
+        pairs(get_pairs())
     {}
     
     /// Get the matrix of \f$\varepsilon_{ij}/k_B\f$ with the entries in K
@@ -378,8 +578,16 @@ struct SAFTVRMieChainContributionTerms{
     template <typename TType>
     auto get_dmat(const TType &T) const{
         Eigen::Array<TType, Eigen::Dynamic, Eigen::Dynamic> d(N,N);
-        // For the pure components, by integration
+        // For the pure components, by integration, or from the expansions if they were built and T is within their range.
+        // The expansions are only accurate to double precision, so they are not used for extended precision types
+        constexpr bool double_precision = std::is_same_v<std::decay_t<decltype(getbaseval(T))>, double>;
         for (auto i = 0; i < N; ++i){
+            if constexpr (double_precision){
+                if (!dii_surrogates.empty() && dii_surrogates[i].contains(getbaseval(T))){
+                    d(i,i) = dii_surrogates[i](T);
+                    continue;
+                }
+            }
             d(i,i) = get_dii(i, T);
         }
         // The cross terms, using the linear mixing rule
@@ -426,11 +634,10 @@ struct SAFTVRMieChainContributionTerms{
         
         NumType summer_zeta_x = 0.0;
         TRHOType summer_zeta_x_bar = 0.0;
-        for (auto i = 0; i < N; ++i){
-            for (auto j = 0; j < N; ++j){
-                summer_zeta_x += xs(i)*xs(j)*powi(dmat(i,j), 3)*rhos;
-                summer_zeta_x_bar += xs(i)*xs(j)*powi(sigma_ij(i,j), 3);
-            }
+        for (const auto& p : pairs){
+            auto xxf = forceeval(xs(p.i)*xs(p.j)*p.factor);
+            summer_zeta_x += xxf*powi(dmat(p.i,p.j), 3)*rhos;
+            summer_zeta_x_bar += xxf*p.sigma3;
         }
         
         auto zeta_x = forceeval(pi6*summer_zeta_x); // Eq. A13
@@ -447,8 +654,8 @@ struct SAFTVRMieChainContributionTerms{
         auto k2 = forceeval(-3.0*POW2(zeta_x)/(8.0*X2));
         auto k3 = forceeval((-POW4(zeta_x) + 3.0*POW2(zeta_x) + 3.0*zeta_x)/(6.0*X3));
         
-        // Pre-calculate the cubes of the diameters
-        auto dmat3 = dmat.array().pow(3).eval();
+        // Powers of zeta_x, for the effective packing fractions of Eq. A17
+        const std::array<NumType, 4> zeta_x_pow = {zeta_x, POW2(zeta_x), POW3(zeta_x), POW4(zeta_x)};
         
         NumType a1kB = 0.0;
         NumType a2kB2 = 0.0;
@@ -458,145 +665,100 @@ struct SAFTVRMieChainContributionTerms{
         NumType K_HS = get_KHS(zeta_x);
         NumType rho_dK_HS_drho = get_rhos_dK_HS_drhos(zeta_x);
         
-        for (auto i = 0; i < N; ++i){
-            for (auto j = i; j < N; ++j){
-                NumType x_0_ij = sigma_ij(i,j)/dmat(i, j);
+        // Per-exponent quantities of one pair; each is evaluated once per pair and reused in a_1, a_2 and the chain term
+        std::array<NumType, kNexponents> one_term, rhosda1_term;
+        
+        for (const auto& p : pairs){
+            const auto i = p.i, j = p.j;
+            NumType x_0_ij = p.sigma/dmat(i, j);
+            NumType x_0_ij3 = POW3(x_0_ij);
+            NumType dmat3 = POW3(dmat(i, j));
+            
+            for (auto k = 0; k < kNexponents; ++k){
+                const double lambda_ij = p.lambda[k];
+                // The powers x_0^(3-lambda) and x_0^(4-lambda) are obtained from the one pow call
+                NumType x_0_lambda = pow(x_0_ij, lambda_ij);
+                NumType x_0_3mlambda = x_0_ij3/x_0_lambda;
+                NumType I = forceeval(-(x_0_3mlambda-1.0)/(lambda_ij-3.0)); // Eq. A14
+                NumType J = forceeval(-(x_0_3mlambda*x_0_ij*(lambda_ij-3.0)-x_0_3mlambda*(lambda_ij-4.0)-1.0)/((lambda_ij-3.0)*(lambda_ij-4.0))); // Eq. A15
+                NumType Bhatij = this->get_Bhatij(zeta_x, X, I, J);
+                const auto& c = p.c[k];
+                NumType zeta_x_eff = c[0]*zeta_x_pow[0] + c[1]*zeta_x_pow[1] + c[2]*zeta_x_pow[2] + c[3]*zeta_x_pow[3];
+                one_term[k] = forceeval(x_0_lambda*(Bhatij + this->get_a1Shatij(zeta_x_eff, lambda_ij)));
                 
-                // -----------------------
-                // Calculations for a_1/kB
-                // -----------------------
+                if (i == j){
+                    // Bhat = B*rho*kappa; diff(Bhat, rho) = Bhat + rho*dBhat/drho; kappa = 2*pi*eps*d^3
+                    // This is the function for the partial derivative rhos*(da1ij/drhos),
+                    // divided by 2*PI*d_ij^3*epsilon*rhos
+                    NumType dzeta_x_eff_dzetax = c[0] + c[1]*2.0*zeta_x + c[2]*3.0*zeta_x_pow[1] + c[3]*4.0*zeta_x_pow[2];
+                    auto rhosda1Sdrhos = this->get_rhoda1Shatijdrho(zeta_x, zeta_x_eff, dzeta_x_eff_dzetax, lambda_ij);
+                    auto rhosdBdrhos = this->get_rhodBijdrho(zeta_x, X, I, J, Bhatij);
+                    rhosda1_term[k] = forceeval(x_0_lambda*(rhosda1Sdrhos + rhosdBdrhos));
+                }
+            }
+            
+            // -----------------------
+            // Calculations for a_1/kB
+            // -----------------------
+            
+            NumType a1ij = p.eps2piC*rhos*dmat3*(one_term[kA] - one_term[kR]); // divided by k_B
+            a1kB += xs(i)*xs(j)*a1ij*p.factor;
+            
+            // --------------------------
+            // Calculations for a_2/k_B^2
+            // --------------------------
+            
+            NumType chi_ij = p.f1*zeta_x_bar + p.f2*zeta_x_bar5 + p.f3*zeta_x_bar8;
+            auto a2ij = K_HS*(1.0+chi_ij)*p.a2pre*rhos*dmat3*(
+                 one_term[k2A] - 2.0*one_term[kAR] + one_term[k2R]
+            ); // divided by k_B^2
+            a2kB2 += xs(i)*xs(j)*a2ij*p.factor; // Eq. A19
+            
+            // --------------------------
+            // Calculations for a_3/k_B^3
+            // --------------------------
+            auto a3ij = p.a3pre*zeta_x_bar*exp(p.f5*zeta_x_bar + p.f6*POW2(zeta_x_bar)); // divided by k_B^3
+            a3kB3 += xs(i)*xs(j)*a3ij*p.factor; // Eq. A25
+            
+            if (i == j){
+                // ------------------
+                // Chain contribution
+                // ------------------
                 
-                auto I = [&x_0_ij](double lambda_ij){
-                    return forceeval(-(pow(x_0_ij, 3-lambda_ij)-1.0)/(lambda_ij-3.0)); // Eq. A14
-                };
-                auto J = [&x_0_ij](double lambda_ij){
-                    return forceeval(-(pow(x_0_ij, 4-lambda_ij)*(lambda_ij-3.0)-pow(x_0_ij, 3.0-lambda_ij)*(lambda_ij-4.0)-1.0)/((lambda_ij-3.0)*(lambda_ij-4.0))); // Eq. A15
-                };
-                auto Bhatij_a = this->get_Bhatij(zeta_x, X, I(lambda_a_ij(i,j)), J(lambda_a_ij(i,j)));
-                auto Bhatij_2a = this->get_Bhatij(zeta_x, X, I(2*lambda_a_ij(i,j)), J(2*lambda_a_ij(i,j)));
-                auto Bhatij_r = this->get_Bhatij(zeta_x, X, I(lambda_r_ij(i,j)), J(lambda_r_ij(i,j)));
-                auto Bhatij_2r = this->get_Bhatij(zeta_x, X, I(2*lambda_r_ij(i,j)), J(2*lambda_r_ij(i,j)));
-                auto Bhatij_ar = this->get_Bhatij(zeta_x, X, I(lambda_a_ij(i,j)+lambda_r_ij(i,j)), J(lambda_a_ij(i,j)+lambda_r_ij(i,j)));
-                                                 
-                auto one_term =  [this, &x_0_ij, &I, &J, &zeta_x, &X](double lambda_ij, const NumType& zeta_x_eff){
-                    return forceeval(
-                       pow(x_0_ij, lambda_ij)*(
-                         this->get_Bhatij(zeta_x, X, I(lambda_ij), J(lambda_ij))
-                       + this->get_a1Shatij(zeta_x_eff, lambda_ij)
-                       )
-                     );
-                };
-                NumType zeta_x_eff_r = crnij[0](i,j)*zeta_x + crnij[1](i,j)*POW2(zeta_x) + crnij[2](i,j)*POW3(zeta_x) + crnij[3](i,j)*POW4(zeta_x);
-                NumType zeta_x_eff_a = canij[0](i,j)*zeta_x + canij[1](i,j)*POW2(zeta_x) + canij[2](i,j)*POW3(zeta_x) + canij[3](i,j)*POW4(zeta_x);
-                NumType dzeta_x_eff_dzetax_r = crnij[0](i,j) + crnij[1](i,j)*2*zeta_x + crnij[2](i,j)*3*POW2(zeta_x) + crnij[3](i,j)*4*POW3(zeta_x);
-                NumType dzeta_x_eff_dzetax_a = canij[0](i,j) + canij[1](i,j)*2*zeta_x + canij[2](i,j)*3*POW2(zeta_x) + canij[3](i,j)*4*POW3(zeta_x);
-
-                NumType a1ij = 2.0*MY_PI*rhos*dmat3(i,j)*epsilon_ij(i,j)*C_ij(i,j)*(
-                    one_term(lambda_a_ij(i,j), zeta_x_eff_a) - one_term(lambda_r_ij(i,j), zeta_x_eff_r)
-                ); // divided by k_B
-                                    
-                NumType contribution = xs(i)*xs(j)*a1ij;
-                double factor = (i == j) ? 1.0 : 2.0; // Off-diagonal terms contribute twice
-                a1kB += contribution*factor;
+                // Eq. A29
+                auto gdHSii = exp(k0 + k1*x_0_ij + k2*POW2(x_0_ij) + k3*x_0_ij3);
                 
-                // --------------------------
-                // Calculations for a_2/k_B^2
-                // --------------------------
+                // The g1 terms
+                // ....
                 
-                NumType zeta_x_eff_2r = c2rnij[0](i,j)*zeta_x + c2rnij[1](i,j)*POW2(zeta_x) + c2rnij[2](i,j)*POW3(zeta_x) + c2rnij[3](i,j)*POW4(zeta_x);
-                NumType zeta_x_eff_2a = c2anij[0](i,j)*zeta_x + c2anij[1](i,j)*POW2(zeta_x) + c2anij[2](i,j)*POW3(zeta_x) + c2anij[3](i,j)*POW4(zeta_x);
-                NumType zeta_x_eff_ar = carnij[0](i,j)*zeta_x + carnij[1](i,j)*POW2(zeta_x) + carnij[2](i,j)*POW3(zeta_x) + carnij[3](i,j)*POW4(zeta_x);
-                NumType dzeta_x_eff_dzetax_2r = c2rnij[0](i,j) + c2rnij[1](i,j)*2*zeta_x + c2rnij[2](i,j)*3*POW2(zeta_x) + c2rnij[3](i,j)*4*POW3(zeta_x);
-                NumType dzeta_x_eff_dzetax_ar = carnij[0](i,j) + carnij[1](i,j)*2*zeta_x + carnij[2](i,j)*3*POW2(zeta_x) + carnij[3](i,j)*4*POW3(zeta_x);
-                NumType dzeta_x_eff_dzetax_2a = c2anij[0](i,j) + c2anij[1](i,j)*2*zeta_x + c2anij[2](i,j)*3*POW2(zeta_x) + c2anij[3](i,j)*4*POW3(zeta_x);
+                // The second part (not the partial) that goes in g_{1,ii}, divided by 2*PI*d_ij^3*epsilon*rhos
+                auto g1_noderivterm = -p.C*(p.lambda[kA]*one_term[kA] - p.lambda[kR]*one_term[kR]);
+                // This is rhos*d(a_1ij)/drhos/(2*pi*d^3*eps*rhos)
+                auto da1iidrhos_term = p.C*(rhosda1_term[kA] - rhosda1_term[kR]);
+                auto g1ii = 3.0*da1iidrhos_term + g1_noderivterm;
                 
-                NumType chi_ij = fkij[1](i,j)*zeta_x_bar + fkij[2](i,j)*zeta_x_bar5 + fkij[3](i,j)*zeta_x_bar8;
-                auto a2ij = 0.5*K_HS*(1.0+chi_ij)*epsilon_ij(i,j)*POW2(C_ij(i,j))*(2*MY_PI*rhos*dmat3(i,j)*epsilon_ij(i,j))*(
-                     one_term(2.0*lambda_a_ij(i,j), zeta_x_eff_2a)
-                  -2.0*one_term(lambda_a_ij(i,j)+lambda_r_ij(i,j), zeta_x_eff_ar)
-                    +one_term(2.0*lambda_r_ij(i,j), zeta_x_eff_2r)
-                ); // divided by k_B^2
-                                    
-                NumType contributiona2 = xs(i)*xs(j)*a2ij; // Eq. A19
-                a2kB2 += contributiona2*factor;
+                // The g2 terms
+                // ....
                 
-                // --------------------------
-                // Calculations for a_3/k_B^3
-                // --------------------------
-                auto a3ij = -POW3(epsilon_ij(i,j))*fkij[4](i,j)*zeta_x_bar*exp(
-                     fkij[5](i,j)*zeta_x_bar + fkij[6](i,j)*POW2(zeta_x_bar)
-                ); // divided by k_B^3
-                NumType contributiona3 = xs(i)*xs(j)*a3ij; // Eq. A25
-                a3kB3 += contributiona3*factor;
+                // This is the second part (not the partial deriv.) that goes in g_{2,ii},
+                // divided by 2*PI*d_ij^3*epsilon*rhos
+                auto g2_noderivterm = -POW2(p.C)*K_HS*(
+                   p.lambda[kA]*one_term[k2A] - p.lambda[kAR]*one_term[kAR] + p.lambda[kR]*one_term[k2R]
+                );
+                // This is [rhos*d(a_2ij/(1+chi_ij))/drhos]/(2*pi*d^3*eps*rhos)
+                auto da2iidrhos_term = 0.5*POW2(p.C)*(
+                    rho_dK_HS_drho*(one_term[k2A] - 2.0*one_term[kAR] + one_term[k2R])
+                    +K_HS*(rhosda1_term[k2A] - 2.0*rhosda1_term[kAR] + rhosda1_term[k2R])
+                );
+                auto g2MCAij = 3.0*da2iidrhos_term + g2_noderivterm;
                 
-                if (i == j){
-                    // ------------------
-                    // Chain contribution
-                    // ------------------
-                    
-                    // Eq. A29
-                    auto gdHSii = exp(k0 + k1*x_0_ij + k2*POW2(x_0_ij) + k3*POW3(x_0_ij));
-                    
-                    // The g1 terms
-                    // ....
-                    
-                    // This is the function for the second part (not the partial) that goes in g_{1,ii},
-                    // divided by 2*PI*d_ij^3*epsilon*rhos
-                    auto g1_term = [&one_term](double lambda_ij, const NumType& zeta_x_eff){
-                        return forceeval(lambda_ij*one_term(lambda_ij, zeta_x_eff));
-                    };
-                    auto g1_noderivterm = -C_ij(i,i)*(g1_term(lambda_a_ij(i,i), zeta_x_eff_a)-g1_term(lambda_r_ij(i,i), zeta_x_eff_r));
-                    
-                    // Bhat = B*rho*kappa; diff(Bhat, rho) = Bhat + rho*dBhat/drho; kappa = 2*pi*eps*d^3
-                    // This is the function for the partial derivative rhos*(da1ij/drhos),
-                    // divided by 2*PI*d_ij^3*epsilon*rhos
-                    auto rhosda1iidrhos_term = [this, &x_0_ij, &I, &J, &zeta_x, &X](double lambda_ij, const NumType& zeta_x_eff, const NumType& dzetaxeff_dzetax, const NumType& Bhatij){
-                        auto I_ = I(lambda_ij);
-                        auto J_ = J(lambda_ij);
-                        auto rhosda1Sdrhos = this->get_rhoda1Shatijdrho(zeta_x, zeta_x_eff, dzetaxeff_dzetax, lambda_ij);
-                        auto rhosdBdrhos = this->get_rhodBijdrho(zeta_x, X, I_, J_, Bhatij);
-                        return forceeval(pow(x_0_ij, lambda_ij)*(rhosda1Sdrhos + rhosdBdrhos));
-                    };
-                    // This is rhos*d(a_1ij)/drhos/(2*pi*d^3*eps*rhos)
-                    auto da1iidrhos_term = C_ij(i,j)*(
-                         rhosda1iidrhos_term(lambda_a_ij(i,i), zeta_x_eff_a, dzeta_x_eff_dzetax_a, Bhatij_a)
-                        -rhosda1iidrhos_term(lambda_r_ij(i,i), zeta_x_eff_r, dzeta_x_eff_dzetax_r, Bhatij_r)
-                    );
-                    auto g1ii = 3.0*da1iidrhos_term + g1_noderivterm;
-                    
-                    // The g2 terms
-                    // ....
-                    
-                    // This is the second part (not the partial deriv.) that goes in g_{2,ii},
-                    // divided by 2*PI*d_ij^3*epsilon*rhos
-                    auto g2_noderivterm = -POW2(C_ij(i,i))*K_HS*(
-                       lambda_a_ij(i,j)*one_term(2*lambda_a_ij(i,j), zeta_x_eff_2a)
-                       -(lambda_a_ij(i,j)+lambda_r_ij(i,j))*one_term(lambda_a_ij(i,j)+lambda_r_ij(i,j), zeta_x_eff_ar)
-                       +lambda_r_ij(i,j)*one_term(2*lambda_r_ij(i,j), zeta_x_eff_2r)
-                    );
-                    // This is [rhos*d(a_2ij/(1+chi_ij))/drhos]/(2*pi*d^3*eps*rhos)
-                    auto da2iidrhos_term = 0.5*POW2(C_ij(i,j))*(
-                        rho_dK_HS_drho*(
-                            one_term(2.0*lambda_a_ij(i,j), zeta_x_eff_2a)
-                            -2.0*one_term(lambda_a_ij(i,j)+lambda_r_ij(i,j), zeta_x_eff_ar)
-                            +one_term(2.0*lambda_r_ij(i,j), zeta_x_eff_2r))
-                        +K_HS*(
-                            rhosda1iidrhos_term(2.0*lambda_a_ij(i,i), zeta_x_eff_2a, dzeta_x_eff_dzetax_2a, Bhatij_2a)
-                            -2.0*rhosda1iidrhos_term(lambda_a_ij(i,i)+lambda_r_ij(i,i), zeta_x_eff_ar, dzeta_x_eff_dzetax_ar, Bhatij_ar)
-                            +rhosda1iidrhos_term(2.0*lambda_r_ij(i,i), zeta_x_eff_2r, dzeta_x_eff_dzetax_2r, Bhatij_2r)
-                            )
-                        );
-                    auto g2MCAij = 3.0*da2iidrhos_term + g2_noderivterm;
-                    
-                    auto betaepsilon = epsilon_ij(i,i)/T; // (1/(kB*T))/epsilon
-                    auto theta = exp(betaepsilon)-1.0;
-                    auto phi7 = phi.col(6);
-                    auto gamma_cij = phi7(0)*(-tanh(phi7(1)*(phi7(2)-alpha_ij(i,j)))+1.0)*zeta_x_bar*theta*exp(phi7(3)*zeta_x_bar + phi7(4)*POW2(zeta_x_bar)); // Eq. A37
-                    auto g2ii = (1.0+gamma_cij)*g2MCAij;
-                    
-                    NumType giiMie = gdHSii*exp((betaepsilon*g1ii + POW2(betaepsilon)*g2ii)/gdHSii);
-                    alphar_chain -= molefracs[i]*(m[i]-1.0)*log(giiMie);
-                }
+                auto betaepsilon = p.epsilon/T; // (1/(kB*T))/epsilon
+                auto theta = exp(betaepsilon)-1.0;
+                auto gamma_cij = p.gammacpre*zeta_x_bar*theta*exp(phi(3,6)*zeta_x_bar + phi(4,6)*POW2(zeta_x_bar)); // Eq. A37
+                auto g2ii = (1.0+gamma_cij)*g2MCAij;
+                
+                NumType giiMie = gdHSii*exp((betaepsilon*g1ii + POW2(betaepsilon)*g2ii)/gdHSii);
+                alphar_chain -= molefracs[i]*(m[i]-1.0)*log(giiMie);
             }
         }
         
@@ -744,6 +906,8 @@ private:
     std::vector<std::string> names;
     const SAFTVRMieChainContributionTerms terms;
     const std::optional<SAFTpolar::multipolar_contributions_variant> polar; // Can be present or not
+    const std::optional<association::Association> association; // Can be present or not
+    const DufalAssociationIntegral Iij;
 
     static void check_kmat(const Eigen::ArrayXXd& kmat, std::size_t N) {
         if (kmat.size() == 0){
@@ -805,10 +969,36 @@ public:
         }
     }
     
+    /**
+     Build the association term if any of the components has association sites, with the combining rules of Dufal et al.:
+     \f$\varepsilon^{\rm HB}_{ij} = \sqrt{\varepsilon^{\rm HB}_{ii}\varepsilon^{\rm HB}_{jj}}\f$ and \f$K_{ij} = ((K_{ii}^{1/3} + K_{jj}^{1/3})/2)^3\f$
+     */
+    static auto build_association(const std::vector<SAFTVRMieCoeffs> &coeffs, const std::optional<nlohmann::json>& association_flags = std::nullopt) -> std::optional<association::Association>{
+        std::vector<std::vector<std::string>> molecule_sites;
+        std::size_t Nsites = 0;
+        for (const auto &coeff : coeffs) {
+            molecule_sites.push_back(coeff.sites);
+            Nsites += coeff.sites.size();
+        }
+        if (Nsites == 0){
+            return std::nullopt; // No association contribution is present
+        }
+        auto N = coeffs.size();
+        Eigen::ArrayXXd epsilon_AB_over_k(N, N), K_AB(N, N);
+        for (auto i = 0U; i < N; ++i) {
+            for (auto j = 0U; j < N; ++j) {
+                epsilon_AB_over_k(i, j) = sqrt(coeffs[i].epsilon_AB_over_k*coeffs[j].epsilon_AB_over_k);
+                K_AB(i, j) = POW3((cbrt(coeffs[i].K_AB_Angstrom3) + cbrt(coeffs[j].K_AB_Angstrom3))/2.0);
+            }
+        }
+        auto options = (association_flags) ? association::get_association_options(association_flags.value()) : association::AssociationOptions{};
+        return association::Association(molecule_sites, epsilon_AB_over_k, K_AB, options);
+    }
+    
 public:
     SAFTVRMieMixture(const std::vector<std::string> &names, const std::optional<Eigen::ArrayXXd>& kmat = std::nullopt, const std::optional<nlohmann::json>&flags = std::nullopt) : SAFTVRMieMixture(get_coeffs_from_names(names), kmat, flags){};
-    SAFTVRMieMixture(const std::vector<SAFTVRMieCoeffs> &coeffs, const std::optional<Eigen::ArrayXXd> &kmat = std::nullopt, const std::optional<nlohmann::json>&flags = std::nullopt) : terms(build_chain(coeffs, kmat, flags)), polar(build_polar(coeffs)) {};
-    SAFTVRMieMixture(SAFTVRMieChainContributionTerms&& terms, std::optional<SAFTpolar::multipolar_contributions_variant> &&polar = std::nullopt) : terms(std::move(terms)), polar(std::move(polar)) {};
+    SAFTVRMieMixture(const std::vector<SAFTVRMieCoeffs> &coeffs, const std::optional<Eigen::ArrayXXd> &kmat = std::nullopt, const std::optional<nlohmann::json>&flags = std::nullopt, const std::optional<nlohmann::json>& association_flags = std::nullopt) : terms(build_chain(coeffs, kmat, flags)), polar(build_polar(coeffs)), association(build_association(coeffs, association_flags)) {};
+    SAFTVRMieMixture(SAFTVRMieChainContributionTerms&& terms, std::optional<SAFTpolar::multipolar_contributions_variant> &&polar = std::nullopt, std::optional<association::Association> &&association = std::nullopt) : terms(std::move(terms)), polar(std::move(polar)), association(std::move(association)) {};
     
     
 //    PCSAFTMixture( const PCSAFTMixture& ) = delete; // non construction-copyable
@@ -823,6 +1013,8 @@ public:
     // Checker for whether a polar term is present
     bool has_polar() const{ return polar.has_value(); }
     
+    const auto& get_association() const { return association; }
+    
     const auto& get_terms() const { return terms; }
     auto get_core_calcs(double T, double rhomolar, const Eigen::ArrayXd& mole_fractions) const {
         auto val = terms.get_core_calcs(T, rhomolar, mole_fractions);
@@ -912,6 +1104,18 @@ public:
            alphar += std::visit(visitor, polar.value());
        }
         
+        // If association is present, add its contribution, with the integral I_ij of Dufal et al. in
+        // the place of the contact value of the radial distribution function
+        if (association){
+            constexpr double MY_PI = static_cast<double>(EIGEN_PI);
+            auto rhostar = forceeval(vals.zeta_x_bar*6.0/MY_PI); // rho_s*sigma_x^3
+            auto I = [&](std::size_t i, std::size_t j){
+                return forceeval(Iij.get_I(forceeval(T/terms.epsilon_ij(i, j)), rhostar));
+            };
+            RhoType rho_A3 = rhomolar*N_A*1e-30;
+            alphar += association.value().alphar(T, rho_A3, mole_fractions, I);
+        }
+        
         return forceeval(alphar);
     }
 };
@@ -923,12 +1127,17 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
         kmat = build_square_matrix(spec["kmat"]);
     }
     
+    std::optional<nlohmann::json> SAFTVRMie_flags = std::nullopt;
+    if (spec.contains("SAFTVRMie_flags")){
+        SAFTVRMie_flags = spec["SAFTVRMie_flags"];
+    }
+    
     if (spec.contains("names")){
         std::vector<std::string> names = spec["names"];
         if (kmat && kmat.value().rows() != names.size()){
             throw teqp::InvalidArgument("Provided length of names of " + std::to_string(names.size()) + " does not match the dimension of the kmat of " + std::to_string(kmat.value().rows()));
         }
-        return SAFTVRMieMixture(names, kmat);
+        return SAFTVRMieMixture(names, kmat, SAFTVRMie_flags);
     }
     else if (spec.contains("coeffs")){
         bool something_polar = false;
@@ -942,6 +1151,11 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
             c.lambda_r = j.at("lambda_r");
             c.lambda_a = j.at("lambda_a");
             c.BibTeXKey = j.at("BibTeXKey");
+            if (j.contains("sites")){
+                c.sites = j.at("sites").get<std::vector<std::string>>();
+                c.epsilon_AB_over_k = j.at("epsilon_AB_over_k");
+                c.K_AB_Angstrom3 = j.at("K_AB_Angstrom3");
+            }
             
             // These are legacy definitions of the polar moments
             if (j.contains("(mu^*)^2") && j.contains("nmu")){
@@ -962,10 +1176,14 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
         if (kmat && kmat.value().rows() != coeffs.size()){
             throw teqp::InvalidArgument("Provided length of coeffs of " + std::to_string(coeffs.size()) + " does not match the dimension of the kmat of " +  std::to_string(kmat.value().rows()));
         }
-        
+        std::optional<nlohmann::json> association_flags = std::nullopt;
+        if (spec.contains("association_flags")){
+            association_flags = spec["association_flags"];
+        }
+        auto association = SAFTVRMieMixture::build_association(coeffs, association_flags);
         if (!something_polar){
             // Nonpolar, just m, epsilon, sigma and possibly a kmat matrix with kij coefficients
-            return SAFTVRMieMixture(SAFTVRMieMixture::build_chain(coeffs, kmat));
+            return SAFTVRMieMixture(SAFTVRMieMixture::build_chain(coeffs, kmat, SAFTVRMie_flags), std::nullopt, std::move(association));
         }
         else{
             // Polar term is also provided, along with the chain terms
@@ -973,10 +1191,6 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
             if (spec.contains("polar_model")){
                 polar_model = spec["polar_model"];
             }
-            std::optional<nlohmann::json> SAFTVRMie_flags = std::nullopt;
-            if (spec.contains("SAFTVRMie_flags")){
-                SAFTVRMie_flags = spec["SAFTVRMie_flags"];
-            }
             std::optional<nlohmann::json> polar_flags = std::nullopt;
             if (spec.contains("polar_flags")){
                 polar_flags = spec["polar_flags"];
@@ -1046,44 +1260,44 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
                 auto mustar2 = (mustar2factor*mu_Cm.pow(2)/(ms*epsks*sigma_ms.pow(3))).eval();
                 auto Qstar2 = (Qstar2factor*Q_Cm2.pow(2)/(ms*epsks*sigma_ms.pow(5))).eval();
                 auto polar = MultipolarContributionGrossVrabec(ms, sigma_ms*1e10, epsks, mustar2, nmu, Qstar2, nQ);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             if (polar_model == "GubbinsTwu+Luckas"){
                 using MCGTL = MultipolarContributionGubbinsTwu<LuckasJIntegral, LuckasKIntegral>;
                 auto mubar2 = (mustar2factor*mu_Cm.pow(2)/(epsks*sigma_ms.pow(3))).eval();
                 auto Qbar2 = (Qstar2factor*Q_Cm2.pow(2)/(epsks*sigma_ms.pow(5))).eval();
                 auto polar = MCGTL(sigma_ms, epsks, mubar2, Qbar2, multipolar_rhostar_approach::use_packing_fraction);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             if (polar_model == "GubbinsTwu+GubbinsTwu"){
                 using MCGG = MultipolarContributionGubbinsTwu<GubbinsTwuJIntegral, GubbinsTwuKIntegral>;
                 auto mubar2 = (mustar2factor*mu_Cm.pow(2)/(epsks*sigma_ms.pow(3))).eval();
                 auto Qbar2 = (Qstar2factor*Q_Cm2.pow(2)/(epsks*sigma_ms.pow(5))).eval();
                 auto polar = MCGG(sigma_ms, epsks, mubar2, Qbar2, multipolar_rhostar_approach::use_packing_fraction);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             if (polar_model == "GubbinsTwu+Gottschalk"){
                 using MCGG = MultipolarContributionGubbinsTwu<GottschalkJIntegral, GottschalkKIntegral>;
                 auto mubar2 = (mustar2factor*mu_Cm.pow(2)/(epsks*sigma_ms.pow(3))).eval();
                 auto Qbar2 = (Qstar2factor*Q_Cm2.pow(2)/(epsks*sigma_ms.pow(5))).eval();
                 auto polar = MCGG(sigma_ms, epsks, mubar2, Qbar2, multipolar_rhostar_approach::use_packing_fraction);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             
             if (polar_model == "GrayGubbins+GubbinsTwu"){
                 using MCGG = MultipolarContributionGrayGubbins<GubbinsTwuJIntegral, GubbinsTwuKIntegral>;
                 auto polar = MCGG(sigma_ms, epsks, SIGMAIJ, EPSKIJ, mu_Cm, Q_Cm2, polar_flags);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
 //            if (polar_model == "GrayGubbins+Gottschalk"){
 //                using MCGG = MultipolarContributionGrayGubbins<GottschalkJIntegral, GottschalkKIntegral>;
 //                auto polar = MCGG(sigma_ms, epsks, mu_Cm, Q_Cm2, polar_flags);
-//                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+//                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
 //            }
             if (polar_model == "GrayGubbins+Luckas"){
                 using MCGG = MultipolarContributionGrayGubbins<LuckasJIntegral, LuckasKIntegral>;
                 auto polar = MCGG(sigma_ms, epsks, SIGMAIJ, EPSKIJ, mu_Cm, Q_Cm2, polar_flags);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             
             
@@ -1092,14 +1306,14 @@ inline auto SAFTVRMiefactory(const nlohmann::json & spec){
                 auto mubar2 = (mustar2factor*mu_Cm.pow(2)/(epsks*sigma_ms.pow(3))).eval();
                 auto Qbar2 = (Qstar2factor*Q_Cm2.pow(2)/(epsks*sigma_ms.pow(5))).eval();
                 auto polar = MCGTL(sigma_ms, epsks, mubar2, Qbar2, multipolar_rhostar_approach::calculate_Gubbins_rhostar);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             if (polar_model == "GubbinsTwu+GubbinsTwu+GubbinsTwuRhostar"){
                 using MCGG = MultipolarContributionGubbinsTwu<GubbinsTwuJIntegral, GubbinsTwuKIntegral>;
                 auto mubar2 = (mustar2factor*mu_Cm.pow(2)/(epsks*sigma_ms.pow(3))).eval();
                 auto Qbar2 = (Qstar2factor*Q_Cm2.pow(2)/(epsks*sigma_ms.pow(5))).eval();
                 auto polar = MCGG(sigma_ms, epsks, mubar2, Qbar2, multipolar_rhostar_approach::calculate_Gubbins_rhostar);
-                return SAFTVRMieMixture(std::move(chain), std::move(polar));
+                return SAFTVRMieMixture(std::move(chain), std::move(polar), std::move(association));
             }
             throw teqp::InvalidArgument("didn't understand this polar_model:"+polar_model);
         }
@@ -3,6 +3,9 @@
 #include "teqp/constants.hpp"
 #include "teqp/types.hpp"
 #include "teqp/exceptions.hpp"
+#include "teqp/models/cubicsuperancillary.hpp"
+
+#include <tuple>
 
 namespace teqp {
 /*
@@ -42,6 +45,19 @@ public:
     double p(double T, double v) {
         return Ru*T/(v - b) - a/(v*v);
     }
+    
+    /// Return a tuple of the saturation pressure and the saturated liquid and vapor densities from the superancillary equations of Bell and Deiters
+    std::tuple<double, double, double> superanc_VLE_T(double T, std::size_t ifluid = 0) const {
+        if (ifluid != 0) {
+            throw teqp::InvalidArgument("ifluid must be 0 for this pure fluid model");
+        }
+        const double Ttilde = Ru*T*b/a;
+        return std::make_tuple(
+            CubicSuperAncillary::supercubic(CubicSuperAncillary::VDW_CODE, CubicSuperAncillary::P_CODE, Ttilde)*a/(b*b),
+            CubicSuperAncillary::supercubic(CubicSuperAncillary::VDW_CODE, CubicSuperAncillary::RHOL_CODE, Ttilde)/b,
+            CubicSuperAncillary::supercubic(CubicSuperAncillary::VDW_CODE, CubicSuperAncillary::RHOV_CODE, Ttilde)/b
+        );
+    }
 };
 
 /// A slightly more involved implementation of van der Waals, this time with mixture properties
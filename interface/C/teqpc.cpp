@@ -6,8 +6,12 @@
 #include <unordered_map>
 #include <variant>
 #include <atomic>
+#include <mutex>
+#include <memory>
+#include <limits>
 
 #include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/batch.hpp"
 #include "teqp/exceptions.hpp"
 
 // Define empty macros so that no exporting happens
@@ -34,7 +38,61 @@ using namespace teqp;
 // The max possible index is 18,446,744,073,709,551,615
 std::atomic<long long int> next_index{ 0 };
 
-std::unordered_map<unsigned long long int, std::shared_ptr<teqp::cppinterface::AbstractModel>> library;
+/**
+ The registry of the models that have been built, keyed by their uuid
+
+ The registry is safe to use from multiple threads. The map is never modified in place; instead, writers (add and remove) copy
+ the map under a mutex, publish the new copy as an immutable snapshot, and then bump the generation counter. Readers keep a
+ thread-local copy of the snapshot and only reload it when the generation has changed, so the read path in the steady state is
+ an atomic load of the generation counter and a hash lookup, without any locking. The shared_ptr returned by get keeps the model
+ alive for the duration of a call even if the model is concurrently freed in another thread.
+
+ The cost is that building or freeing a model is O(N) in the number of models, and that a freed model is only destroyed once every
+ thread holding an older snapshot has made another lookup (or exited)
+ */
+class ModelRegistry{
+private:
+    using LibraryMap = std::unordered_map<unsigned long long int, std::shared_ptr<teqp::cppinterface::AbstractModel>>;
+    std::mutex write_mutex;
+    std::shared_ptr<const LibraryMap> snapshot = std::make_shared<const LibraryMap>();
+    std::atomic<unsigned long long int> generation{ 0 };
+    
+    template<typename Modifier>
+    void modify(const Modifier& modifier){
+        std::lock_guard<std::mutex> lock(write_mutex);
+        auto newmap = std::make_shared<LibraryMap>(*std::atomic_load(&snapshot));
+        modifier(*newmap);
+        std::atomic_store(&snapshot, std::shared_ptr<const LibraryMap>(std::move(newmap)));
+        generation.fetch_add(1, std::memory_order_release);
+    }
+public:
+    void add(const unsigned long long int uuid, std::shared_ptr<teqp::cppinterface::AbstractModel>&& model){
+        modify([&](LibraryMap& m){ m.emplace(uuid, std::move(model)); });
+    }
+    void remove(const unsigned long long int uuid){
+        modify([&](LibraryMap& m){ m.erase(uuid); });
+    }
+    std::shared_ptr<const teqp::cppinterface::AbstractModel> get(const unsigned long long int uuid) const {
+        // Only one registry exists, so the thread-local cache need not be keyed by the instance
+        struct ThreadCache{
+            unsigned long long int generation = std::numeric_limits<unsigned long long int>::max();
+            std::shared_ptr<const LibraryMap> snapshot;
+        };
+        thread_local ThreadCache cache;
+        const auto gen = generation.load(std::memory_order_acquire);
+        if (gen != cache.generation){
+            cache.snapshot = std::atomic_load(&snapshot);
+            cache.generation = gen;
+        }
+        auto it = cache.snapshot->find(uuid);
+        if (it == cache.snapshot->end()){
+            throw teqpcException(40, "Unable to find model with uuid of " + std::to_string(uuid));
+        }
+        return it->second;
+    }
+};
+
+ModelRegistry library;
 
 void exception_handler(int& errcode, char* message_buffer, const int buffer_length)
 {
@@ -57,7 +115,7 @@ EXPORT_CODE int CONVENTION build_model(const char* j, long long int* uuid, char*
         nlohmann::json json = nlohmann::json::parse(j);
         long long int uid = next_index++;
         try {
-            library.emplace(std::make_pair(uid, cppinterface::make_model(json)));
+            library.add(uid, cppinterface::make_model(json));
         }
         catch (std::exception &e) {
             throw teqpcException(30, "Unable to load with error:" + std::string(e.what()));
@@ -73,7 +131,7 @@ EXPORT_CODE int CONVENTION build_model(const char* j, long long int* uuid, char*
 EXPORT_CODE int CONVENTION free_model(const long long int uuid, char* errmsg, int errmsg_length) {
     int errcode = 0;
     try {
-        library.erase(uuid);
+        library.remove(uuid);
     }
     catch (...) {
         exception_handler(errcode, errmsg, errmsg_length);
@@ -87,7 +145,196 @@ EXPORT_CODE int CONVENTION get_Arxy(const long long int uuid, const int NT, cons
         // Make an Eigen view of the double buffer
         Eigen::Map<const Eigen::ArrayXd> molefrac_(molefrac, Ncomp);
         // Call the function
-        *val = library.at(uuid)->get_Arxy(NT, ND, T, rho, molefrac_);
+        *val = library.get(uuid)->get_Arxy(NT, ND, T, rho, molefrac_);
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/*
+ * The vectorized functions below operate on a batch of N states. All the buffers are owned by the caller and are not copied.
+ * Arrays of vectors (mole fractions, molar concentrations) and matrices are stored contiguously in row-major (C) order, one
+ * state after the other. If Nthreads is greater than 1, the batch is split over that many threads
+ */
+
+using RowMajorArrayXXd = Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+void check_batch_buffers(const int N, const int Ncomp, std::initializer_list<const void*> buffers){
+    if (N < 0 || Ncomp < 1){
+        throw teqpcException(50, "Invalid batch dimensions of N=" + std::to_string(N) + " and Ncomp=" + std::to_string(Ncomp));
+    }
+    for (auto* b : buffers){
+        if (b == nullptr){
+            throw teqpcException(51, "A buffer passed to a vectorized function is a null pointer");
+        }
+    }
+}
+
+/**
+ * Call f(i, rhovec_i) for each of the N vectors of molar concentrations in the buffer rhovecs of shape (N, Ncomp)
+ * A buffer for the molar concentrations is allocated once per chunk of states
+ */
+template<typename Func>
+void for_each_rhovec(const double* rhovecs, const int N, const int Ncomp, const int Nthreads, const Func& f){
+    cppinterface::parallel_for_chunks(N, Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+        Eigen::ArrayXd rhovec(Ncomp);
+        for (auto i = istart; i < iend; ++i){
+            rhovec = Eigen::Map<const Eigen::ArrayXd>(rhovecs + i*Ncomp, Ncomp);
+            f(i, rhovec);
+        }
+    });
+}
+
+/**
+ * Evaluate Arxy for N states
+ * molefracs is of shape (Nmolefrac_rows, Ncomp), where Nmolefrac_rows is either N (one composition per state) or 1 (shared composition)
+ */
+EXPORT_CODE int CONVENTION get_Arxy_many(const long long int uuid, const int NT, const int ND, const double* T, const double* rho, const int N, const double* molefracs, const int Nmolefrac_rows, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, Ncomp, {T, rho, molefracs, out});
+        if (Nmolefrac_rows != N && Nmolefrac_rows != 1){
+            throw teqpcException(50, "Nmolefrac_rows must be either N or 1");
+        }
+        Eigen::Map<const Eigen::ArrayXd> T_(T, N), rho_(rho, N);
+        Eigen::Map<Eigen::ArrayXd> out_(out, N);
+        // The AbstractModel takes column-major mole fractions, the (small) transposition is the only copy
+        Eigen::ArrayXXd molefracs_ = Eigen::Map<const RowMajorArrayXXd>(molefracs, Nmolefrac_rows, Ncomp);
+        library.get(uuid)->get_Arxy_many(NT, ND, T_, rho_, molefracs_, out_, Nthreads);
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/// Fugacity coefficients at N states; rhovecs and out are both of shape (N, Ncomp)
+EXPORT_CODE int CONVENTION get_fugacity_coefficients_many(const long long int uuid, const double* T, const double* rhovecs, const int N, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, Ncomp, {T, rhovecs, out});
+        auto model = library.get(uuid);
+        for_each_rhovec(rhovecs, N, Ncomp, Nthreads, [&](const Eigen::Index i, const Eigen::ArrayXd& rhovec){
+            Eigen::Map<Eigen::ArrayXd>(out + i*Ncomp, Ncomp) = model->get_fugacity_coefficients(T[i], rhovec);
+        });
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/// Gradient of Psir w.r.t. the molar concentrations at N states; rhovecs and out are both of shape (N, Ncomp)
+EXPORT_CODE int CONVENTION build_Psir_gradient_many(const long long int uuid, const double* T, const double* rhovecs, const int N, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, Ncomp, {T, rhovecs, out});
+        auto model = library.get(uuid);
+        for_each_rhovec(rhovecs, N, Ncomp, Nthreads, [&](const Eigen::Index i, const Eigen::ArrayXd& rhovec){
+            Eigen::Map<Eigen::ArrayXd>(out + i*Ncomp, Ncomp) = model->build_Psir_gradient_autodiff(T[i], rhovec);
+        });
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/// Hessian of Psir w.r.t. the molar concentrations at N states; rhovecs is of shape (N, Ncomp) and out is of shape (N, Ncomp, Ncomp)
+EXPORT_CODE int CONVENTION build_Psir_Hessian_many(const long long int uuid, const double* T, const double* rhovecs, const int N, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, Ncomp, {T, rhovecs, out});
+        auto model = library.get(uuid);
+        for_each_rhovec(rhovecs, N, Ncomp, Nthreads, [&](const Eigen::Index i, const Eigen::ArrayXd& rhovec){
+            Eigen::Map<RowMajorArrayXXd>(out + i*Ncomp*Ncomp, Ncomp, Ncomp) = model->build_Psir_Hessian_autodiff(T[i], rhovec);
+        });
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/**
+ * Logarithms of the fugacity coefficients and compressibility factors at N states from one derivative pass per state; rhovecs, lnphi,
+ * dlnphidT and dlnphidp are of shape (N, Ncomp), Z is of length N, and ndlnphidn is of shape (N, Ncomp, Ncomp). The derivatives are only
+ * calculated if their buffer is not a null pointer
+ */
+EXPORT_CODE int CONVENTION get_ln_fugacity_coefficients_fused_many(const long long int uuid, const double* T, const double* rhovecs, const int N, const int Ncomp, double* lnphi, double* Z, double* dlnphidT, double* dlnphidp, double* ndlnphidn, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, Ncomp, {T, rhovecs, lnphi, Z});
+        FugacityFlags flags;
+        flags.dT = (dlnphidT != nullptr);
+        flags.dp = (dlnphidp != nullptr);
+        flags.dn = (ndlnphidn != nullptr);
+        auto model = library.get(uuid);
+        for_each_rhovec(rhovecs, N, Ncomp, Nthreads, [&](const Eigen::Index i, const Eigen::ArrayXd& rhovec){
+            auto o = model->get_ln_fugacity_coefficients_fused(T[i], rhovec, flags);
+            Eigen::Map<Eigen::ArrayXd>(lnphi + i*Ncomp, Ncomp) = o.lnphi;
+            Z[i] = o.Z;
+            if (flags.dT){ Eigen::Map<Eigen::ArrayXd>(dlnphidT + i*Ncomp, Ncomp) = o.dlnphidT; }
+            if (flags.dp){ Eigen::Map<Eigen::ArrayXd>(dlnphidp + i*Ncomp, Ncomp) = o.dlnphidp; }
+            if (flags.dn){ Eigen::Map<RowMajorArrayXXd>(ndlnphidn + i*Ncomp*Ncomp, Ncomp, Ncomp) = o.ndlnphidn; }
+        });
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/**
+ * Pure fluid VLE at N temperatures, starting from the guess values in rhoL and rhoV, with the solutions written into rhoLout and rhoVout
+ * The outcome of each state is written into status: 0 for success, otherwise the error code, in which case rhoLout and rhoVout are NaN for
+ * that state. A state that fails does not stop the others; the return value is only non-zero if the arguments are invalid
+ */
+EXPORT_CODE int CONVENTION pure_VLE_T_many(const long long int uuid, const double* T, const double* rhoL, const double* rhoV, const int N, const int maxiter, double* rhoLout, double* rhoVout, int* status, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, 1, {T, rhoL, rhoV, rhoLout, rhoVout, status});
+        auto model = library.get(uuid);
+        cppinterface::parallel_for_chunks(N, Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+            for (auto i = istart; i < iend; ++i){
+                try{
+                    auto soln = model->pure_VLE_T(T[i], rhoL[i], rhoV[i], maxiter);
+                    rhoLout[i] = soln[0];
+                    rhoVout[i] = soln[1];
+                    status[i] = 0;
+                }
+                // The message of the failure of each state is not retained, only its code, as in exception_handler
+                catch (teqpcException& e){
+                    rhoLout[i] = rhoVout[i] = std::numeric_limits<double>::quiet_NaN();
+                    status[i] = e.code;
+                }
+                catch (std::exception&){
+                    rhoLout[i] = rhoVout[i] = std::numeric_limits<double>::quiet_NaN();
+                    status[i] = 9999;
+                }
+            }
+        });
+    }
+    catch (...) {
+        exception_handler(errcode, errmsg, errmsg_length);
+    }
+    return errcode;
+}
+
+/// Saturation pressure and saturated liquid and vapor densities of the pure component ifluid at N temperatures from the superancillary equations; out is of shape (N, 3)
+EXPORT_CODE int CONVENTION superanc_VLE_T_many(const long long int uuid, const double* T, const int N, const int ifluid, double* out, const int Nthreads, char* errmsg, int errmsg_length) {
+    int errcode = 0;
+    try {
+        check_batch_buffers(N, 1, {T, out});
+        if (ifluid < 0){
+            throw teqpcException(50, "ifluid must be non-negative");
+        }
+        Eigen::Map<const Eigen::ArrayXd> T_(T, N);
+        // out is row-major, so the rows are 3 apart and the columns are adjacent
+        Eigen::Map<EMatrixd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> out_(out, N, 3, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(1, 3));
+        library.get(uuid)->superanc_VLE_T_many(T_, static_cast<std::size_t>(ifluid), out_, Nthreads);
     }
     catch (...) {
         exception_handler(errcode, errmsg, errmsg_length);
@@ -97,8 +344,10 @@ EXPORT_CODE int CONVENTION get_Arxy(const long long int uuid, const int NT, cons
 
 #if defined(TEQPC_CATCH)
 
+#include <thread>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_approx.hpp>
 
 #include "teqp/json_tools.hpp"
 
@@ -330,6 +579,139 @@ TEST_CASE("Use of C interface","[teqpc]") {
     };
     
 }
+
+TEST_CASE("Vectorized functions of the C interface", "[teqpc][batch]") {
+    constexpr int errmsg_length = 300;
+    char errmsg[errmsg_length] = "";
+    long long int uuid;
+    std::string j = R"({"kind": "PR", "model": {"Tcrit / K": [190.564, 305.32], "pcrit / Pa": [4599200, 4872200], "acentric": [0.011, 0.099]}})";
+    REQUIRE(build_model(j.c_str(), &uuid, errmsg, errmsg_length) == 0);
+    
+    const int N = 50, Ncomp = 2;
+    std::vector<double> T(N), rho(N), molefracs(N*Ncomp), rhovecs(N*Ncomp);
+    for (auto i = 0; i < N; ++i){
+        T[i] = 200.0 + 4.0*i; rho[i] = 100.0*(i+1);
+        molefracs[i*Ncomp] = 0.01 + 0.98*i/(N-1); molefracs[i*Ncomp+1] = 1-molefracs[i*Ncomp];
+        rhovecs[i*Ncomp] = rho[i]*molefracs[i*Ncomp]; rhovecs[i*Ncomp+1] = rho[i]*molefracs[i*Ncomp+1];
+    }
+    for (int Nthreads : {1, 3}){
+        std::vector<double> Ar11(N), phi(N*Ncomp), H(N*Ncomp*Ncomp);
+        REQUIRE(get_Arxy_many(uuid, 1, 1, &T[0], &rho[0], N, &molefracs[0], N, Ncomp, &Ar11[0], Nthreads, errmsg, errmsg_length) == 0);
+        REQUIRE(get_fugacity_coefficients_many(uuid, &T[0], &rhovecs[0], N, Ncomp, &phi[0], Nthreads, errmsg, errmsg_length) == 0);
+        REQUIRE(build_Psir_Hessian_many(uuid, &T[0], &rhovecs[0], N, Ncomp, &H[0], Nthreads, errmsg, errmsg_length) == 0);
+        for (auto i = 0; i < N; ++i){
+            double val = -1;
+            REQUIRE(get_Arxy(uuid, 1, 1, T[i], rho[i], &molefracs[i*Ncomp], Ncomp, &val, errmsg, errmsg_length) == 0);
+            CHECK(Ar11[i] == Catch::Approx(val));
+            CHECK(H[i*Ncomp*Ncomp + 1] == H[i*Ncomp*Ncomp + 2]); // Symmetric
+        }
+        // Without the derivatives, the fused kernel gives the same fugacity coefficients
+        std::vector<double> lnphi(N*Ncomp), Z(N), ndlnphidn(N*Ncomp*Ncomp);
+        REQUIRE(get_ln_fugacity_coefficients_fused_many(uuid, &T[0], &rhovecs[0], N, Ncomp, &lnphi[0], &Z[0], nullptr, nullptr, &ndlnphidn[0], Nthreads, errmsg, errmsg_length) == 0);
+        for (auto k = 0; k < N*Ncomp; ++k){
+            CHECK(exp(lnphi[k]) == Catch::Approx(phi[k]).epsilon(1e-12));
+        }
+        for (auto i = 0; i < N; ++i){
+            // Gibbs-Duhem: sum_i x_i*n*dln(phi_i)/dn_j = 0
+            CHECK(molefracs[i*Ncomp]*ndlnphidn[i*Ncomp*Ncomp] + molefracs[i*Ncomp+1]*ndlnphidn[i*Ncomp*Ncomp + 2] == Catch::Approx(0).margin(1e-10));
+        }
+    }
+    // Shared composition
+    std::vector<double> Ar01(N);
+    REQUIRE(get_Arxy_many(uuid, 0, 1, &T[0], &rho[0], N, &molefracs[0], 1, Ncomp, &Ar01[0], 1, errmsg, errmsg_length) == 0);
+    double val = -1;
+    REQUIRE(get_Arxy(uuid, 0, 1, T[N-1], rho[N-1], &molefracs[0], Ncomp, &val, errmsg, errmsg_length) == 0);
+    CHECK(Ar01[N-1] == Catch::Approx(val));
+    
+    // Bad inputs are reported as errors
+    CHECK(get_Arxy_many(uuid, 0, 1, &T[0], &rho[0], N, &molefracs[0], 2, Ncomp, &Ar01[0], 1, errmsg, errmsg_length) != 0);
+    CHECK(get_Arxy_many(uuid, 0, 1, &T[0], nullptr, N, &molefracs[0], N, Ncomp, &Ar01[0], 1, errmsg, errmsg_length) != 0);
+    
+    // Pure fluid VLE reports the outcome of each state
+    long long int uuidpure;
+    std::string jpure = R"({"kind": "PR", "model": {"Tcrit / K": [190.564], "pcrit / Pa": [4599200], "acentric": [0.011]}})";
+    REQUIRE(build_model(jpure.c_str(), &uuidpure, errmsg, errmsg_length) == 0);
+    const int Nsat = 4;
+    std::vector<double> Tsat = {100.0, 120.0, 140.0, 160.0}, rhoLg(Nsat, 25000.0), rhoVg(Nsat, 100.0), rhoLout(Nsat), rhoVout(Nsat);
+    std::vector<int> status(Nsat, -1);
+    REQUIRE(pure_VLE_T_many(uuidpure, &Tsat[0], &rhoLg[0], &rhoVg[0], Nsat, 10, &rhoLout[0], &rhoVout[0], &status[0], 2, errmsg, errmsg_length) == 0);
+    for (auto i = 0; i < Nsat; ++i){
+        CHECK(status[i] == 0);
+        CHECK(rhoLout[i] > rhoVout[i]);
+    }
+    // The rows of the superancillary output are psat, rhoL, rhoV of each temperature
+    std::vector<double> sat(Nsat*3);
+    REQUIRE(superanc_VLE_T_many(uuidpure, &Tsat[0], Nsat, 0, &sat[0], 2, errmsg, errmsg_length) == 0);
+    for (auto i = 0; i < Nsat; ++i){
+        CHECK(sat[i*3] > 0);
+        CHECK(sat[i*3+1] == Catch::Approx(rhoLout[i]));
+        CHECK(sat[i*3+2] == Catch::Approx(rhoVout[i]));
+    }
+    // For the binary model the pure fluid VLE fails at each state, which does not fail the call
+    REQUIRE(pure_VLE_T_many(uuid, &Tsat[0], &rhoLg[0], &rhoVg[0], Nsat, 10, &rhoLout[0], &rhoVout[0], &status[0], 2, errmsg, errmsg_length) == 0);
+    for (auto i = 0; i < Nsat; ++i){
+        CHECK(status[i] != 0);
+        CHECK(std::isnan(rhoLout[i]));
+    }
+    REQUIRE(free_model(uuidpure, errmsg, errmsg_length) == 0);
+    REQUIRE(free_model(uuid, errmsg, errmsg_length) == 0);
+}
+
+TEST_CASE("Concurrent building, freeing, and calling of models in C interface", "[teqpc][threads]") {
+    constexpr int errmsg_length = 300;
+    char errmsg[errmsg_length] = "";
+    long long int uuidPR;
+    std::string jPR = R"({"kind": "PR", "model": {"Tcrit / K": [190], "pcrit / Pa": [3.5e6], "acentric": [0.11]}})";
+    REQUIRE(build_model(jPR.c_str(), &uuidPR, errmsg, errmsg_length) == 0);
+    double expected = -1;
+    const double molefrac[1] = { 1.0 };
+    REQUIRE(get_Arxy(uuidPR, 0, 1, 300.0, 3.0e-6, molefrac, 1, &expected, errmsg, errmsg_length) == 0);
+    
+    std::atomic<bool> stop{ false };
+    std::atomic<long long int> last_built{ -1 };
+    std::atomic<int> bad_builds{ 0 }, bad_calls{ 0 }, good_calls{ 0 };
+    
+    // Threads that build and free models in a loop
+    auto builder = [&]() {
+        char msg[errmsg_length] = "";
+        std::string j = R"({"kind":"vdW1", "model":{"a":1.0, "b":2.0}})";
+        for (auto i = 0; i < 200; ++i) {
+            long long int uuid;
+            if (build_model(j.c_str(), &uuid, msg, errmsg_length) != 0) { bad_builds++; continue; }
+            last_built = uuid;
+            if (free_model(uuid, msg, errmsg_length) != 0) { bad_builds++; }
+        }
+    };
+    // Threads that evaluate the persistent model, and also models that might be freed at any moment
+    auto caller = [&]() {
+        char msg[errmsg_length] = "";
+        while (!stop) {
+            double val = -1;
+            if (get_Arxy(uuidPR, 0, 1, 300.0, 3.0e-6, molefrac, 1, &val, msg, errmsg_length) != 0 || val != expected) {
+                bad_calls++;
+            }
+            else {
+                good_calls++;
+            }
+            // Allowed to fail if the model was freed already, but must not crash
+            get_Arxy(last_built.load(), 0, 1, 300.0, 3.0e-6, molefrac, 1, &val, msg, errmsg_length);
+        }
+    };
+    std::vector<std::thread> builders, callers;
+    for (auto i = 0; i < 4; ++i) { callers.emplace_back(caller); }
+    for (auto i = 0; i < 4; ++i) { builders.emplace_back(builder); }
+    for (auto& t : builders) { t.join(); }
+    stop = true;
+    for (auto& t : callers) { t.join(); }
+    
+    CHECK(bad_builds == 0);
+    CHECK(bad_calls == 0);
+    CHECK(good_calls > 0);
+    // Freeing the persistent model means that it can no longer be called
+    REQUIRE(free_model(uuidPR, errmsg, errmsg_length) == 0);
+    double val = -1;
+    CHECK(get_Arxy(uuidPR, 0, 1, 300.0, 3.0e-6, molefrac, 1, &val, errmsg, errmsg_length) != 0);
+}
 #else 
 int main() {
 }
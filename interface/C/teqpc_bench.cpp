@@ -6,9 +6,11 @@
 #include <unordered_map>
 
 // Prototypes of the functions exposed by the shared library
-extern "C" int build_model(const char* j, char* uuid, char* errmsg, int errmsg_length);
-extern "C" int free_model(const char* uid, char* errmsg, int errmsg_length);
-extern "C" int get_Arxy(const char* uid, const int NT, const int ND, const double T, const double rho, const double* molefrac, const int Ncomp, double* val, char* errmsg, int errmsg_length);
+extern "C" int build_model(const char* j, long long int* uuid, char* errmsg, int errmsg_length);
+extern "C" int free_model(const long long int uuid, char* errmsg, int errmsg_length);
+extern "C" int get_Arxy(const long long int uuid, const int NT, const int ND, const double T, const double rho, const double* molefrac, const int Ncomp, double* val, char* errmsg, int errmsg_length);
+extern "C" int get_Arxy_many(const long long int uuid, const int NT, const int ND, const double* T, const double* rho, const int N, const double* molefracs, const int Nmolefrac_rows, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length);
+extern "C" int get_fugacity_coefficients_many(const long long int uuid, const double* T, const double* rhovecs, const int N, const int Ncomp, double* out, const int Nthreads, char* errmsg, int errmsg_length);
 
 TEST_CASE("teqpc profiling", "[teqpc]")
 {
@@ -34,8 +36,9 @@ TEST_CASE("teqpc profiling", "[teqpc]")
         }
     )";
     // Build the model
-    char uid[40], errstr[200];
-    int errcode = build_model(model, uid, errstr, 200);
+    long long int uid;
+    char errstr[200];
+    int errcode = build_model(model, &uid, errstr, 200);
 
     int NT = 0, ND = 1;
     double T = 300, rho = 0.5, out = -1;
@@ -47,7 +50,7 @@ TEST_CASE("teqpc profiling", "[teqpc]")
         return m["afhgruelghrueoighfeklnieaogfyeogafuril"];
     };
     BENCHMARK("build model") {
-        int errcode = build_model(model, uid, errstr, 200);
+        int errcode = build_model(model, &uid, errstr, 200);
         return uid;
     };
     BENCHMARK("call model") {
@@ -56,4 +59,29 @@ TEST_CASE("teqpc profiling", "[teqpc]")
         return out;
     };
     
-}
\ No newline at end of file
+    
+    // Per-state cost of the scalar path and the vectorized path for a batch of states
+    const int N = 1000, Ncomp = 2;
+    std::valarray<double> Ts(N), rhos(N), molefracs(N*Ncomp), rhovecs(N*Ncomp), outs(N), outphi(N*Ncomp);
+    for (auto i = 0; i < N; ++i){
+        Ts[i] = 250 + 0.1*i; rhos[i] = 0.5 + 0.01*i;
+        molefracs[i*Ncomp] = z[0]; molefracs[i*Ncomp+1] = z[1];
+        rhovecs[i*Ncomp] = rhos[i]*z[0]; rhovecs[i*Ncomp+1] = rhos[i]*z[1];
+    }
+    BENCHMARK("call model 1000 times") {
+        for (auto i = 0; i < N; ++i){
+            get_Arxy(uid, NT, ND, Ts[i], rhos[i], &(molefracs[i*Ncomp]), Ncomp, &(outs[i]), errstr, 200);
+        }
+        return outs[N-1];
+    };
+    for (int Nthreads : {1, 4}){
+        BENCHMARK("get_Arxy_many with 1000 states; Nthreads=" + std::to_string(Nthreads)) {
+            get_Arxy_many(uid, NT, ND, &(Ts[0]), &(rhos[0]), N, &(molefracs[0]), N, Ncomp, &(outs[0]), Nthreads, errstr, 200);
+            return outs[N-1];
+        };
+        BENCHMARK("get_fugacity_coefficients_many with 1000 states; Nthreads=" + std::to_string(Nthreads)) {
+            get_fugacity_coefficients_many(uid, &(Ts[0]), &(rhovecs[0]), N, Ncomp, &(outphi[0]), Nthreads, errstr, 200);
+            return outphi[N-1];
+        };
+    }
+}
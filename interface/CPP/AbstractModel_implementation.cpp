@@ -1,4 +1,6 @@
 #include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/derivs.hpp"
+#include "teqp/cpp/batch.hpp"
 #include "teqp/algorithms/critical_pure.hpp"
 #include "teqp/algorithms/VLE_pure.hpp"
 #include "teqp/algorithms/VLE.hpp"
@@ -22,8 +24,52 @@ namespace teqp{
         }
 
         EArray2 AbstractModel::pure_VLE_T(const double T, const double rhoL, const double rhoV, int maxiter) const {
+            if (has_superanc()){
+                EArray3 sat;
+                try{
+                    sat = superanc_VLE_T(T, 0);
+                }
+                catch(const std::invalid_argument&){
+                    // Outside the range of the superancillary equations, start from the guesses instead
+                    return teqp::pure_VLE_T(*this, T, rhoL, rhoV, maxiter);
+                }
+                return teqp::pure_VLE_T(*this, T, sat[1], sat[2], maxiter);
+            }
             return teqp::pure_VLE_T(*this, T, rhoL, rhoV, maxiter);
         }
+        
+        bool AbstractModel::has_superanc() const {
+            return false;
+        }
+        
+        EArray3 AbstractModel::superanc_VLE_T(const double, const std::size_t) const {
+            throw teqp::NotImplementedError("This model does not provide superancillary equations");
+        }
+        
+        void AbstractModel::superanc_VLE_T_many(const REArrayd& T, const std::size_t ifluid, Eigen::Ref<EMatrixd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> out, const std::optional<int>& Nthreads) const {
+            if (out.rows() != T.size() || out.cols() != 3){
+                throw teqp::InvalidArgument("out must be of shape (" + std::to_string(T.size()) + ", 3)");
+            }
+            parallel_for_chunks(T.size(), Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+                for (auto i = istart; i < iend; ++i){
+                    out.row(i) = superanc_VLE_T(T[i], ifluid).transpose();
+                }
+            });
+        }
+
+        void AbstractModel::get_ln_fugacity_coefficients_fused_many(const REArrayd& T, const REMatrixd& rhovecs, const FugacityFlags& flags, std::vector<FugacityCoefficients>& out, const std::optional<int>& Nthreads) const {
+            if (rhovecs.rows() != T.size()){
+                throw teqp::InvalidArgument("Number of rows of rhovecs (" + std::to_string(rhovecs.rows()) + ") does not match length of T (" + std::to_string(T.size()) + ")");
+            }
+            out.resize(T.size());
+            parallel_for_chunks(T.size(), Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+                EArrayd rhovec(rhovecs.cols());
+                for (auto i = istart; i < iend; ++i){
+                    rhovec = rhovecs.row(i).transpose();
+                    out[i] = get_ln_fugacity_coefficients_fused(T[i], rhovec, flags);
+                }
+            });
+        }
 
         double AbstractModel::dpsatdT_pure(const double T, const double rhoL, const double rhoV) const {
             return teqp::dpsatdT_pure(*this, T, rhoL, rhoV);
@@ -64,11 +110,25 @@ namespace teqp{
     nlohmann::json AbstractModel::trace_VLE_isobar_binary(const double p, const double T0, const EArrayd& rhovecL0, const EArrayd& rhovecV0, const std::optional<PVLEOptions> &options) const{
         return teqp::trace_VLE_isobar_binary(*this, p, T0, rhovecL0, rhovecV0, options);
     }
+    VLETraceColumns AbstractModel::trace_VLE_isotherm_binary_columns(const double T0, const EArrayd& rhovecL0, const EArrayd& rhovecV0, const std::optional<TVLEOptions> &options) const{
+        return teqp::trace_VLE_isotherm_binary_columns(*this, T0, rhovecL0, rhovecV0, options);
+    }
+    VLETraceColumns AbstractModel::trace_VLE_isobar_binary_columns(const double p, const double T0, const EArrayd& rhovecL0, const EArrayd& rhovecV0, const std::optional<PVLEOptions> &options) const{
+        return teqp::trace_VLE_isobar_binary_columns(*this, p, T0, rhovecL0, rhovecV0, options);
+    }
     
     nlohmann::json AbstractModel::trace_critical_arclength_binary(const double T0, const EArrayd& rhovec0, const std::optional<std::string>& filename, const std::optional<TCABOptions> &options) const {
         using crit = teqp::CriticalTracing<decltype(*this), double, std::decay_t<decltype(rhovec0)>>;
         return crit::trace_critical_arclength_binary(*this, T0, rhovec0, filename , options);
     }
+    CriticalTraceColumns AbstractModel::trace_critical_arclength_binary_columns(const double T0, const EArrayd& rhovec0, const std::optional<std::string>& filename, const std::optional<TCABOptions> &options) const {
+        using crit = teqp::CriticalTracing<decltype(*this), double, std::decay_t<decltype(rhovec0)>>;
+        return crit::trace_critical_arclength_binary_columns(*this, T0, rhovec0, filename , options);
+    }
+    std::size_t AbstractModel::trace_critical_arclength_binary_sink(const double T0, const EArrayd& rhovec0, const CriticalTraceSink& sink, const std::optional<TCABOptions> &options) const {
+        using crit = teqp::CriticalTracing<decltype(*this), double, std::decay_t<decltype(rhovec0)>>;
+        return crit::trace_critical_arclength_binary_sink(*this, T0, rhovec0, sink, options);
+    }
     EArrayd AbstractModel::get_drhovec_dT_crit(const double T, const REArrayd& rhovec) const {
         using crit = teqp::CriticalTracing<decltype(*this), double, std::decay_t<decltype(rhovec)>>;
         return crit::get_drhovec_dT_crit(*this, T, rhovec);
@@ -89,6 +149,25 @@ namespace teqp{
         using crit = teqp::CriticalTracing<decltype(*this), double, std::decay_t<decltype(rhovec)>>;
         return crit::get_minimum_eigenvalue_Psi_Hessian(*this, T, rhovec);
     }
+
+    nlohmann::json to_JSON(const VLETraceColumns& cols){
+        return teqp::VLE_trace_to_JSON(cols);
+    }
+    nlohmann::json to_JSON(const CriticalTraceColumns& cols){
+        return teqp::CriticalTracing<AbstractModel>::critical_trace_to_JSON(cols);
+    }
+    
+    StateProperties get_properties_Trho(const AbstractModel& residual, const AbstractModel& idealgas, const double T, const double rho, const REArrayd& molefrac){
+        const EArrayd z = molefrac;
+        return build_state_properties(residual.get_deriv_mat2(T, rho, z), idealgas.get_deriv_mat2(T, rho, z), residual.get_R(z), T, rho);
+    }
+    
+    void get_properties_Trho_many(const AbstractModel& residual, const AbstractModel& idealgas, const REArrayd& T, const REArrayd& rho, const REMatrixd& molefracs, std::vector<StateProperties>& out, const std::optional<int>& Nthreads){
+        out.resize(T.size());
+        for_each_state(T, rho, molefracs, Nthreads, [&](const Eigen::Index i, const double T_, const double rho_, const EArrayd& z){
+            out[i] = build_state_properties(residual.get_deriv_mat2(T_, rho_, z), idealgas.get_deriv_mat2(T_, rho_, z), residual.get_R(z), T_, rho_);
+        });
+    }
     
     }
 }
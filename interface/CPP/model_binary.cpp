@@ -0,0 +1,124 @@
+#include <fstream>
+#include <cstring>
+
+#include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/deriv_adapter.hpp"
+#include "teqp/models/multifluid_binary.hpp"
+#include "teqp/exceptions.hpp"
+
+namespace teqp {
+    namespace cppinterface {
+
+        namespace binary {
+            constexpr char magic[8] = "TEQPBIN";
+            constexpr std::uint32_t version = 2;
+            constexpr std::uint32_t encoding_UBJSON = 0;
+            constexpr std::uint32_t encoding_multifluid = 1;
+            constexpr std::size_t header_size = sizeof(magic) + 2*sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+            /// The contents of a file, checked against the header
+            struct Contents {
+                std::uint32_t encoding;
+                std::vector<std::uint8_t> buffer;
+                const std::uint8_t* begin() const { return buffer.data() + header_size; }
+                const std::uint8_t* end() const { return buffer.data() + buffer.size(); }
+                /// The range of the UBJSON of the specification in the payload; the tables of a multifluid model follow it
+                std::tuple<const std::uint8_t*, const std::uint8_t*> get_spec_range(const std::string& path) const {
+                    if (encoding == encoding_UBJSON) {
+                        return {begin(), end()};
+                    }
+                    std::uint64_t Nspec;
+                    if (static_cast<std::size_t>(end() - begin()) < sizeof(Nspec)) {
+                        throw teqp::InvalidArgument("The file " + path + " is truncated");
+                    }
+                    std::memcpy(&Nspec, begin(), sizeof(Nspec));
+                    const std::uint8_t* spec = begin() + sizeof(Nspec);
+                    if (Nspec > static_cast<std::uint64_t>(end() - spec)) {
+                        throw teqp::InvalidArgument("The file " + path + " is truncated");
+                    }
+                    return {spec, spec + Nspec};
+                }
+            };
+
+            inline Contents read(const std::string& path) {
+                std::ifstream ifs(path, std::ios::binary);
+                if (!ifs) {
+                    throw teqp::InvalidArgument("Unable to open the file " + path);
+                }
+                Contents c;
+                c.buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+                if (c.buffer.size() < header_size || std::memcmp(c.buffer.data(), magic, sizeof(magic)) != 0) {
+                    throw teqp::InvalidArgument("The file " + path + " is not a teqp binary model file");
+                }
+                std::uint32_t version;
+                std::uint64_t Nbytes;
+                const std::uint8_t* ptr = c.buffer.data() + sizeof(magic);
+                std::memcpy(&version, ptr, sizeof(version)); ptr += sizeof(version);
+                std::memcpy(&c.encoding, ptr, sizeof(c.encoding)); ptr += sizeof(c.encoding);
+                std::memcpy(&Nbytes, ptr, sizeof(Nbytes));
+                if (version != binary::version) {
+                    throw teqp::InvalidArgument("The format version " + std::to_string(version) + " of the file " + path + " is not supported; version " + std::to_string(binary::version) + " is expected");
+                }
+                if (c.encoding != encoding_UBJSON && c.encoding != encoding_multifluid) {
+                    throw teqp::InvalidArgument("The payload encoding " + std::to_string(c.encoding) + " of the file " + path + " is not supported");
+                }
+                if (c.buffer.size() - header_size != Nbytes) {
+                    throw teqp::InvalidArgument("The file " + path + " is truncated or has trailing data");
+                }
+                return c;
+            }
+        }
+
+        void save_binary(const nlohmann::json& spec, const std::string& path) {
+            nlohmann::json resolved = spec;
+            std::vector<std::uint8_t> payload;
+            std::uint32_t encoding = binary::encoding_UBJSON;
+            if (spec.at("kind") == "multifluid") {
+                resolved["model"] = make_self_contained_multifluid_spec(spec.at("model"));
+                auto tables = multifluid_to_binary(multifluidfactory(resolved.at("model")));
+                auto specbytes = nlohmann::json::to_ubjson(resolved, true, true);
+                std::uint64_t Nspec = specbytes.size();
+                auto p = reinterpret_cast<const std::uint8_t*>(&Nspec);
+                payload.assign(p, p + sizeof(Nspec));
+                payload.insert(payload.end(), specbytes.begin(), specbytes.end());
+                payload.insert(payload.end(), tables.begin(), tables.end());
+                encoding = binary::encoding_multifluid;
+            }
+            else {
+                // Build the model once so that a file that cannot be loaded is never written
+                build_model_ptr(resolved);
+                payload = nlohmann::json::to_ubjson(resolved, true, true);
+            }
+
+            std::uint64_t Nbytes = payload.size();
+            std::ofstream ofs(path, std::ios::binary);
+            if (!ofs) {
+                throw teqp::InvalidArgument("Unable to open the file " + path + " for writing");
+            }
+            ofs.write(binary::magic, sizeof(binary::magic));
+            ofs.write(reinterpret_cast<const char*>(&binary::version), sizeof(binary::version));
+            ofs.write(reinterpret_cast<const char*>(&encoding), sizeof(encoding));
+            ofs.write(reinterpret_cast<const char*>(&Nbytes), sizeof(Nbytes));
+            ofs.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(Nbytes));
+            if (!ofs) {
+                throw teqp::InvalidArgument("Unable to write the file " + path);
+            }
+        }
+
+        nlohmann::json load_binary_spec(const std::string& path) {
+            auto contents = binary::read(path);
+            auto [spec, specend] = contents.get_spec_range(path);
+            return nlohmann::json::from_ubjson(spec, specend);
+        }
+
+        std::unique_ptr<AbstractModel> load_binary(const std::string& path) {
+            auto contents = binary::read(path);
+            auto [spec, specend] = contents.get_spec_range(path);
+            if (contents.encoding == binary::encoding_multifluid) {
+                // The model is constructed from the tables that follow the specification, which is not parsed
+                return adapter::make_owned(multifluid_from_binary(specend, contents.end()));
+            }
+            return build_model_ptr(nlohmann::json::from_ubjson(spec, specend));
+        }
+    }
+}
@@ -4,6 +4,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/eigen.h>
+#include <pybind11/functional.h>
 
 #include "teqpversion.hpp"
 #include "teqp/ideal_eosterms.hpp"
@@ -13,6 +14,8 @@
 #include "teqp/models/multifluid_ancillaries.hpp"
 #include "teqp/algorithms/iteration.hpp"
 #include "teqp/cpp/deriv_adapter.hpp"
+#include "teqp/cpp/batch.hpp"
+#include "teqp/algorithms/superancillary.hpp"
 #include "teqp/models/fwd.hpp"
 
 namespace py = pybind11;
@@ -273,6 +276,51 @@ void init_teqp(py::module& m) {
         .def_readwrite("terminate_unstable", &PVLEOptions::terminate_unstable)
         ;
 
+    // The columnar outputs of the tracers; the arrays are exposed as read-only NumPy arrays that view the data without copying
+    py::class_<VLETraceColumns>(m, "VLETraceColumns")
+        .def_readonly("t", &VLETraceColumns::t)
+        .def_readonly("dt", &VLETraceColumns::dt)
+        .def_readonly("T", &VLETraceColumns::T)
+        .def_readonly("pL", &VLETraceColumns::pL)
+        .def_readonly("pV", &VLETraceColumns::pV)
+        .def_readonly("c", &VLETraceColumns::c)
+        .def_readonly("rhoL", &VLETraceColumns::rhoL)
+        .def_readonly("rhoV", &VLETraceColumns::rhoV)
+        .def_readonly("drhodt", &VLETraceColumns::drhodt)
+        .def_readonly("critL", &VLETraceColumns::critL)
+        .def_readonly("critV", &VLETraceColumns::critV)
+        .def_readonly("termination_reason", &VLETraceColumns::termination_reason)
+        .def("to_JSON", [](const VLETraceColumns& cols){ return teqp::cppinterface::to_JSON(cols); })
+        ;
+    py::class_<CriticalTraceColumns>(m, "CriticalTraceColumns")
+        .def_readonly("t", &CriticalTraceColumns::t)
+        .def_readonly("T", &CriticalTraceColumns::T)
+        .def_readonly("c", &CriticalTraceColumns::c)
+        .def_readonly("splus", &CriticalTraceColumns::splus)
+        .def_readonly("p", &CriticalTraceColumns::p)
+        .def_readonly("dTdt", &CriticalTraceColumns::dTdt)
+        .def_readonly("lambda1", &CriticalTraceColumns::lambda1)
+        .def_readonly("dirderiv_lambda1", &CriticalTraceColumns::dirderiv_lambda1)
+        .def_readonly("rhovec", &CriticalTraceColumns::rhovec)
+        .def_readonly("drhovecdt", &CriticalTraceColumns::drhovecdt)
+        .def_readonly("locally_stable", &CriticalTraceColumns::locally_stable)
+        .def("to_JSON", [](const CriticalTraceColumns& cols){ return teqp::cppinterface::to_JSON(cols); })
+        ;
+    py::class_<CriticalTracePoint>(m, "CriticalTracePoint")
+        .def_readonly("t", &CriticalTracePoint::t)
+        .def_readonly("dt", &CriticalTracePoint::dt)
+        .def_readonly("T", &CriticalTracePoint::T)
+        .def_readonly("c", &CriticalTracePoint::c)
+        .def_readonly("splus", &CriticalTracePoint::splus)
+        .def_readonly("p", &CriticalTracePoint::p)
+        .def_readonly("dTdt", &CriticalTracePoint::dTdt)
+        .def_readonly("lambda1", &CriticalTracePoint::lambda1)
+        .def_readonly("dirderiv_lambda1", &CriticalTracePoint::dirderiv_lambda1)
+        .def_readonly("rhovec", &CriticalTracePoint::rhovec)
+        .def_readonly("drhovecdt", &CriticalTracePoint::drhovecdt)
+        .def_readonly("locally_stable", &CriticalTracePoint::locally_stable)
+        ;
+
     // The options class for the finder of VLLE solutions from VLE tracing, not tied to a particular model
     py::class_<VLLE::VLLEFinderOptions>(m, "VLLEFinderOptions")
         .def(py::init<>())
@@ -329,6 +377,22 @@ void init_teqp(py::module& m) {
         .def_readonly("r", &MixVLEReturn::r)
         .def_readonly("initial_r", &MixVLEReturn::initial_r)
         ;
+
+    py::class_<FugacityFlags>(m, "FugacityFlags")
+        .def(py::init<>())
+        .def_readwrite("dT", &FugacityFlags::dT)
+        .def_readwrite("dp", &FugacityFlags::dp)
+        .def_readwrite("dn", &FugacityFlags::dn)
+        ;
+
+    py::class_<FugacityCoefficients>(m, "FugacityCoefficients")
+        .def(py::init<>())
+        .def_readonly("lnphi", &FugacityCoefficients::lnphi)
+        .def_readonly("Z", &FugacityCoefficients::Z)
+        .def_readonly("dlnphidT", &FugacityCoefficients::dlnphidT)
+        .def_readonly("dlnphidp", &FugacityCoefficients::dlnphidp)
+        .def_readonly("ndlnphidn", &FugacityCoefficients::ndlnphidn)
+        ;
     
     using namespace teqp::PCSAFT;
     py::class_<SAFTCoeffs>(m, "SAFTCoeffs")
@@ -350,6 +414,76 @@ void init_teqp(py::module& m) {
     add_multifluid_mutant(m);
     
     using am = teqp::cppinterface::AbstractModel;
+    
+    // Vectorized versions of the methods. The inputs are converted while the GIL is held, then the GIL is released while
+    // the loop over the states is carried out in C++ (possibly over multiple threads), writing directly into the NumPy output array
+    using molefrac_array = py::array_t<double, py::array::c_style | py::array::forcecast>;
+    // Mole fractions are either 1D (shared by all states) or 2D (one row per state)
+    auto to_molefrac_matrix = [](const molefrac_array& molefrac) -> Eigen::ArrayXXd {
+        if (molefrac.ndim() == 1){
+            return Eigen::Map<const Eigen::ArrayXd>(molefrac.data(), molefrac.shape(0)).transpose();
+        }
+        else if (molefrac.ndim() == 2){
+            using RowMajorArrayXXd = Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+            return Eigen::Map<const RowMajorArrayXXd>(molefrac.data(), molefrac.shape(0), molefrac.shape(1));
+        }
+        throw teqp::InvalidArgument("molefrac must be a 1D or 2D array");
+    };
+    auto get_Arxy_many = [to_molefrac_matrix](const am& self, const int NT, const int ND, const REArrayd& T, const REArrayd& rho, const molefrac_array& molefrac, const std::optional<int>& Nthreads){
+        const Eigen::ArrayXXd molefracs = to_molefrac_matrix(molefrac);
+        py::array_t<double> out(T.size());
+        Eigen::Map<Eigen::ArrayXd> out_(out.mutable_data(), T.size());
+        {
+            py::gil_scoped_release release;
+            self.get_Arxy_many(NT, ND, T, rho, molefracs, out_, Nthreads);
+        }
+        return out;
+    };
+    auto get_fugacity_coefficients_many = [](const am& self, const REArrayd& T, const molefrac_array& rhovecs, const std::optional<int>& Nthreads){
+        if (rhovecs.ndim() != 2 || rhovecs.shape(0) != T.size()){
+            throw teqp::InvalidArgument("rhovec must be a 2D array with one row per temperature");
+        }
+        const auto N = rhovecs.shape(0), Ncomp = rhovecs.shape(1);
+        py::array_t<double> out({N, Ncomp});
+        double* out_ = out.mutable_data();
+        const double* rhovecs_ = rhovecs.data();
+        {
+            py::gil_scoped_release release;
+            teqp::cppinterface::parallel_for_chunks(N, Nthreads, [&](const Eigen::Index istart, const Eigen::Index iend){
+                Eigen::ArrayXd rhovec(Ncomp);
+                for (auto i = istart; i < iend; ++i){
+                    rhovec = Eigen::Map<const Eigen::ArrayXd>(rhovecs_ + i*Ncomp, Ncomp);
+                    Eigen::Map<Eigen::ArrayXd>(out_ + i*Ncomp, Ncomp) = self.get_fugacity_coefficients(T[i], rhovec);
+                }
+            });
+        }
+        return out;
+    };
+    
+    auto get_ln_fugacity_coefficients_fused_many = [to_molefrac_matrix](const am& self, const REArrayd& T, const molefrac_array& rhovecs, const FugacityFlags& flags, const std::optional<int>& Nthreads){
+        if (rhovecs.ndim() != 2 || rhovecs.shape(0) != T.size()){
+            throw teqp::InvalidArgument("rhovec must be a 2D array with one row per temperature");
+        }
+        const Eigen::ArrayXXd rhovecs_ = to_molefrac_matrix(rhovecs);
+        std::vector<FugacityCoefficients> out;
+        {
+            py::gil_scoped_release release;
+            self.get_ln_fugacity_coefficients_fused_many(T, rhovecs_, flags, out, Nthreads);
+        }
+        return out;
+    };
+    
+    auto superanc_VLE_T_many = [](const am& self, const REArrayd& T, const std::size_t ifluid, const std::optional<int>& Nthreads){
+        py::array_t<double> out({static_cast<py::ssize_t>(T.size()), static_cast<py::ssize_t>(3)});
+        // The array is row-major, so the rows are 3 apart and the columns are adjacent
+        Eigen::Map<EMatrixd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>> out_(out.mutable_data(), T.size(), 3, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(1, 3));
+        {
+            py::gil_scoped_release release;
+            self.superanc_VLE_T_many(T, ifluid, out_, Nthreads);
+        }
+        return out;
+    };
+    
     py::class_<AbstractModel, std::unique_ptr<AbstractModel>>(m, "AbstractModel", py::dynamic_attr())
     
         .def("get_R", &am::get_R, "molefrac"_a.noconvert())
@@ -368,6 +502,11 @@ void init_teqp(py::module& m) {
         #define X(i) .def(stringify(get_Ar0 ## i ## n), &am::get_Ar0 ## i ## n, "T"_a, "rho"_a, "molefrac"_a.noconvert())
             AR0N_args
         #undef X
+        // Vectorized overloads taking arrays of T and rho, with molefrac either 1D (shared) or 2D (one row per state)
+        .def("get_Arxy", get_Arxy_many, "NT"_a, "ND"_a, "T"_a, "rho"_a, "molefrac"_a, py::arg_v("Nthreads", std::nullopt, "None"))
+        #define X(i,j) .def(stringify(get_Ar ## i ## j), [get_Arxy_many](const am& self, const REArrayd& T, const REArrayd& rho, const molefrac_array& molefrac, const std::optional<int>& Nthreads){ return get_Arxy_many(self, i, j, T, rho, molefrac, Nthreads); }, "T"_a, "rho"_a, "molefrac"_a, py::arg_v("Nthreads", std::nullopt, "None"))
+            ARXY_args
+        #undef X
         .def("get_neff", &am::get_neff, "T"_a, "rho"_a, "molefrac"_a.noconvert())
     
         // Methods that come from the isochoric derivatives formalism
@@ -380,6 +519,9 @@ void init_teqp(py::module& m) {
         .def("get_chempotVLE_autodiff", &am::get_chempotVLE_autodiff, "T"_a, "rhovec"_a.noconvert())
         .def("get_dchempotdT_autodiff", &am::get_dchempotdT_autodiff, "T"_a, "rhovec"_a.noconvert())
         .def("get_fugacity_coefficients", &am::get_fugacity_coefficients, "T"_a, "rhovec"_a.noconvert())
+        .def("get_fugacity_coefficients", get_fugacity_coefficients_many, "T"_a, "rhovec"_a, py::arg_v("Nthreads", std::nullopt, "None"))
+        .def("get_ln_fugacity_coefficients_fused", &am::get_ln_fugacity_coefficients_fused, "T"_a, "rhovec"_a.noconvert(), "flags"_a = FugacityFlags{})
+        .def("get_ln_fugacity_coefficients_fused", get_ln_fugacity_coefficients_fused_many, "T"_a, "rhovec"_a, "flags"_a = FugacityFlags{}, py::arg_v("Nthreads", std::nullopt, "None"))
         .def("get_partial_molar_volumes", &am::get_partial_molar_volumes, "T"_a, "rhovec"_a.noconvert())
     
         .def("get_deriv_mat2", &am::get_deriv_mat2, "T"_a, "rho"_a, "molefrac"_a.noconvert())
@@ -391,6 +533,8 @@ void init_teqp(py::module& m) {
     
         // Routines related to binary mixture critical curve tracing
         .def("trace_critical_arclength_binary", &am::trace_critical_arclength_binary, "T0"_a, "rhovec0"_a, py::arg_v("path", std::nullopt, "None"), py::arg_v("options", std::nullopt, "None"))
+        .def("trace_critical_arclength_binary_columns", &am::trace_critical_arclength_binary_columns, "T0"_a, "rhovec0"_a, py::arg_v("path", std::nullopt, "None"), py::arg_v("options", std::nullopt, "None"))
+        .def("trace_critical_arclength_binary_sink", &am::trace_critical_arclength_binary_sink, "T0"_a, "rhovec0"_a, "sink"_a, py::arg_v("options", std::nullopt, "None"))
         .def("get_criticality_conditions", &am::get_criticality_conditions, "T"_a, "rhovec"_a.noconvert())
         .def("eigen_problem", &am::eigen_problem, "T"_a, "rhovec"_a, py::arg_v("alignment_v0", std::nullopt, "None"))
         .def("get_minimum_eigenvalue_Psi_Hessian", &am::get_minimum_eigenvalue_Psi_Hessian, "T"_a, "rhovec"_a.noconvert())
@@ -398,6 +542,9 @@ void init_teqp(py::module& m) {
         .def("get_dp_dT_crit", &am::get_dp_dT_crit, "T"_a, "rhovec"_a.noconvert())
 
         .def("pure_VLE_T", &am::pure_VLE_T, "T"_a, "rhoL"_a, "rhoV"_a, "max_iter"_a)
+        .def("has_superanc", &am::has_superanc)
+        .def("superanc_VLE_T", &am::superanc_VLE_T, "T"_a, "ifluid"_a = 0)
+        .def("superanc_VLE_T", superanc_VLE_T_many, "T"_a, "ifluid"_a = 0, py::arg_v("Nthreads", std::nullopt, "None"))
         .def("dpsatdT_pure", &am::dpsatdT_pure, "T"_a, "rhoL"_a, "rhoV"_a)
 
         .def("get_drhovecdp_Tsat", &am::get_drhovecdp_Tsat, "T"_a, "rhovecL"_a.noconvert(), "rhovecV"_a.noconvert())
@@ -406,6 +553,8 @@ void init_teqp(py::module& m) {
     
         .def("trace_VLE_isotherm_binary", &am::trace_VLE_isotherm_binary, "T"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
         .def("trace_VLE_isobar_binary", &am::trace_VLE_isobar_binary, "p"_a, "T0"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
+        .def("trace_VLE_isotherm_binary_columns", &am::trace_VLE_isotherm_binary_columns, "T"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
+        .def("trace_VLE_isobar_binary_columns", &am::trace_VLE_isobar_binary_columns, "p"_a, "T0"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
         .def("mix_VLE_Tx", &am::mix_VLE_Tx, "T"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), "xspec"_a.noconvert(), "atol"_a, "reltol"_a, "axtol"_a, "relxtol"_a, "maxiter"_a)
         .def("mix_VLE_Tp", &am::mix_VLE_Tp, "T"_a, "p_given"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
         .def("mixture_VLE_px", &am::mixture_VLE_px, "p_spec"_a, "xmolar_spec"_a.noconvert(), "T0"_a, "rhovecL0"_a.noconvert(), "rhovecV0"_a.noconvert(), py::arg_v("options", std::nullopt, "None"))
@@ -414,7 +563,30 @@ void init_teqp(py::module& m) {
         .def("find_VLLE_T_binary", &am::find_VLLE_T_binary, "traces"_a, py::arg_v("options", std::nullopt, "None"))
     ;
     
+    // Superancillary equations of a pure fluid, built from any model
+    py::class_<PureSuperAncillary>(m, "PureSuperAncillary")
+        .def(py::init<const nlohmann::json&>())
+        .def("__call__", &PureSuperAncillary::operator(), "T"_a)
+        .def("__call__", [](const PureSuperAncillary& sa, const Eigen::ArrayXd& T){
+            Eigen::ArrayXXd out(T.size(), 3);
+            sa.eval_many(T.data(), out.col(0).data(), out.col(1).data(), out.col(2).data(), T.size());
+            return out;
+        }, "T"_a)
+        .def("to_json", &PureSuperAncillary::to_json)
+        .def_readonly("Tc", &PureSuperAncillary::Tc)
+        .def_readonly("rhoc", &PureSuperAncillary::rhoc)
+        .def_readonly("Tmin", &PureSuperAncillary::Tmin)
+        .def_readonly("Tmax", &PureSuperAncillary::Tmax)
+        ;
+    m.def("build_pure_superancillary", [](const AbstractModel& model, const nlohmann::json& spec){
+        py::gil_scoped_release release;
+        return build_pure_superancillary(model, spec);
+    }, "model"_a, "spec"_a);
+
     m.def("_make_model", &teqp::cppinterface::make_model);
+    m.def("save_binary", &teqp::cppinterface::save_binary, "spec"_a, "path"_a);
+    m.def("load_binary_spec", &teqp::cppinterface::load_binary_spec, "path"_a);
+    m.def("_load_binary", &teqp::cppinterface::load_binary, "path"_a);
     m.def("attach_model_specific_methods", &attach_model_specific_methods);
     
     using namespace teqp::iteration;
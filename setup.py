@@ -84,7 +84,7 @@ init_template  = r'''import os, warnings, functools
 
 # Bring all entities from the extension module into this namespace
 from .teqp import *
-from .teqp import _make_model, _build_multifluid_mutant
+from .teqp import _make_model, _build_multifluid_mutant, _load_binary
 
 def get_datapath():
     """Get the absolute path to the folder containing the root of multi-fluid data"""
@@ -126,6 +126,11 @@ def make_model(*args):
     attach_model_specific_methods(AS)
     return AS
 
+def load_binary(path):
+    AS = _load_binary(path)
+    attach_model_specific_methods(AS)
+    return AS
+
 def vdWEOS(Tc_K, pc_Pa):
     j = {
         "kind": "vdW",
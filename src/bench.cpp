@@ -4,8 +4,10 @@
 #include "teqp/models/vdW.hpp"
 #include "teqp/models/pcsaft.hpp"
 #include "teqp/models/cubics.hpp"
+#include "teqp/models/cubicsuperancillary.hpp"
 
 #include "teqp/derivs.hpp"
+#include "tests/autodiff_only.hpp"
 
 using namespace teqp;
 
@@ -162,3 +164,71 @@ TEST_CASE("Canonical cubic EOS derivatives", "[cubic]")
         return tdx::get_Ar10<ADBackends::multicomplex>(model, T, rho, z);
     };*/
 }
+
+TEST_CASE("Analytic vs. autodiff derivatives of a canonical cubic EOS", "[cubic][analytic]")
+{
+    std::valarray<double> Tc_K = { 190.564, 154.581, 150.687 },
+        pc_Pa = { 4599200, 5042800, 4863000 },
+        acentric = { 0.011, 0.022, -0.002 };
+    auto model = canonical_PR(Tc_K, pc_Pa, acentric);
+    AutodiffOnly<decltype(model)> ad{model};
+
+    double T = 300, rho = 2;
+    Eigen::ArrayXd z(3); z << 0.5, 0.3, 0.2;
+    Eigen::ArrayXd rhovec = rho*z;
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+
+    BENCHMARK("Ar21 w/ autodiff") {
+        return tdx::get_Ar21<ADBackends::autodiff>(model, T, rho, z);
+    };
+    BENCHMARK("Ar21 w/ analytic") {
+        return tdx::get_Ar21<ADBackends::analytic>(model, T, rho, z);
+    };
+    BENCHMARK("Arn0<3> w/ autodiff") {
+        return tdx::get_Arn0<3, ADBackends::autodiff>(model, T, rho, z);
+    };
+    BENCHMARK("Arn0<3> w/ analytic") {
+        return tdx::get_Arn0<3, ADBackends::analytic>(model, T, rho, z);
+    };
+    BENCHMARK("Psir Hessian w/ autodiff") {
+        return IsochoricDerivatives<decltype(ad), double, Eigen::ArrayXd>::build_Psir_Hessian_autodiff(ad, T, rhovec);
+    };
+    BENCHMARK("Psir Hessian w/ analytic") {
+        return IsochoricDerivatives<decltype(model), double, Eigen::ArrayXd>::build_Psir_Hessian_autodiff(model, T, rhovec);
+    };
+}
+
+TEST_CASE("Superancillary evaluation", "[cubic][superanc]")
+{
+    using namespace CubicSuperAncillary;
+    const auto& sa = PR_rhoV;
+    const double xmin = sa.exps.front().xmin, xmax = sa.exps.back().xmax;
+    std::vector<double> x(10000), y(x.size());
+    for (auto i = 0U; i < x.size(); ++i) {
+        x[i] = xmin + (xmax - xmin)*(i + 0.5)/x.size();
+    }
+    // The evaluation as it was done before the expansions were indexed: bisection over the expansions and
+    // Clenshaw's method on the coefficients of each Chebyshev
+    auto bisection = [&](double xx) {
+        int iL = 0, iR = static_cast<int>(sa.exps.size()) - 1;
+        while (iR - iL > 1) {
+            int iM = midpoint_Knuth(iL, iR);
+            if (xx >= sa.exps[iM].xmin) { iL = iM; } else { iR = iM; }
+        }
+        return sa.exps[(xx < sa.exps[iL].xmax) ? iL : iR].y(xx);
+    };
+    BENCHMARK("10000 rhoV, bisection") {
+        double s = 0;
+        for (auto xx : x) { s += bisection(xx); }
+        return s;
+    };
+    BENCHMARK("10000 rhoV, y") {
+        double s = 0;
+        for (auto xx : x) { s += sa.y(xx); }
+        return s;
+    };
+    BENCHMARK("10000 rhoV, y_many") {
+        sa.y_many(x.data(), y.data(), x.size());
+        return y[0];
+    };
+}
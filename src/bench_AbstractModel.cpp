@@ -5,6 +5,9 @@
 #include "teqp/cpp/derivs.hpp"
 #include "teqp/derivs.hpp"
 #include "teqp/cpp/deriv_adapter.hpp"
+#include "teqp/algorithms/superancillary.hpp"
+
+#include <filesystem>
 
 using namespace teqp;
 
@@ -45,6 +48,13 @@ TEST_CASE("multifluid derivatives", "[mf]")
     BENCHMARK("get_deriv_mat2") {
         return am->get_deriv_mat2(300.0, 3.0, z);
     };
+    BENCHMARK("nine separate Arxy calls for the same matrix") {
+        EArray33d mat;
+        #define X(i,j) if (i <= 2 && j <= 2){ mat(i,j) = am->get_Ar ## i ## j(300.0, 3.0, z); }
+            ARXY_args
+        #undef X
+        return mat;
+    };
     BENCHMARK("build_iteration_Jv") {
         auto mat = am->get_deriv_mat2(300.0, 3.0, z);
         auto mat2 = am->get_deriv_mat2(300.0, 3.0, z);
@@ -82,3 +92,115 @@ TEST_CASE("multifluid derivatives via DerivativeAdapter", "[mf]")
         return view(model)->get_Bnvir(4, 300, z);
     };
 }
+
+TEST_CASE("Pure fluid VLE of a cubic from the superancillary equations", "[cubic][superanc]")
+{
+    nlohmann::json j = {
+        {"kind", "PR"},
+        {"model", {
+            {"Tcrit / K", {150.687}},
+            {"pcrit / Pa", {4863000.0}},
+            {"acentric", {-0.002}}
+        }
+    }};
+    auto am = teqp::cppinterface::make_model(j);
+    auto sat = am->superanc_VLE_T(130.0);
+    Eigen::ArrayXd Ts = Eigen::ArrayXd::LinSpaced(1000, 100, 145);
+    EMatrixd out(Ts.size(), 3);
+    
+    BENCHMARK("superanc_VLE_T") {
+        return am->superanc_VLE_T(130.0);
+    };
+    BENCHMARK("pure_VLE_T w/o polishing") {
+        return am->pure_VLE_T(130.0, sat[1], sat[2], 0);
+    };
+    BENCHMARK("pure_VLE_T w/ 10 Newton steps") {
+        return am->pure_VLE_T(130.0, sat[1], sat[2], 10);
+    };
+    BENCHMARK("superanc_VLE_T_many w/ 1000 temperatures") {
+        am->superanc_VLE_T_many(Ts, 0, out);
+        return out(0, 0);
+    };
+}
+
+TEST_CASE("Pure fluid VLE of PC-SAFT from generated superancillary equations", "[PCSAFT][superanc]")
+{
+    nlohmann::json j = {
+        {"kind", "PCSAFT"},
+        {"model", {{"names", {"Methane"}}}}
+    };
+    auto am = teqp::cppinterface::make_model(j);
+    nlohmann::json spec = {{"Tmin", 91.0}, {"Tcguess", 195.0}, {"rhocguess", 10000.0}};
+    BENCHMARK("build_pure_superancillary, 1 thread") {
+        return build_pure_superancillary(*am, spec).p.exps.size();
+    };
+    spec["Nthreads"] = 4;
+    BENCHMARK("build_pure_superancillary, 4 threads") {
+        return build_pure_superancillary(*am, spec).p.exps.size();
+    };
+    auto sa = build_pure_superancillary(*am, spec);
+    auto sat = sa(150.0);
+    BENCHMARK("superancillary") {
+        return sa(150.0);
+    };
+    BENCHMARK("pure_VLE_T w/ 10 Newton steps") {
+        return am->pure_VLE_T(150.0, sat[1]*1.01, sat[2]*0.99, 10);
+    };
+}
+
+TEST_CASE("Fused fugacity coefficients of a PC-SAFT mixture", "[PCSAFT][fugacity]")
+{
+    nlohmann::json j = {
+        {"kind", "PCSAFT"},
+        {"model", {{"names", {"Methane", "Ethane", "Propane"}}}}
+    };
+    auto am = teqp::cppinterface::make_model(j);
+    double T = 250;
+    auto rhovec = (Eigen::ArrayXd(3) << 3000, 1000, 500).finished();
+    
+    // The previous path, in which Z came from a separate evaluation of Ar01
+    BENCHMARK("ln(phi) from the gradient and Ar01") {
+        auto rhotot = rhovec.sum();
+        Eigen::ArrayXd z = rhovec/rhotot;
+        double Z = 1.0 + am->get_Ar01(T, rhotot, z);
+        return (am->build_Psir_gradient_autodiff(T, rhovec)/(am->get_R(z)*T) - log(Z)).eval();
+    };
+    BENCHMARK("ln(phi), fused") {
+        return am->get_ln_fugacity_coefficients_fused(T, rhovec);
+    };
+    FugacityFlags flags; flags.dp = true; flags.dn = true;
+    BENCHMARK("ln(phi), d/dp and n*d/dn, fused") {
+        return am->get_ln_fugacity_coefficients_fused(T, rhovec, flags);
+    };
+    flags.dT = true;
+    BENCHMARK("ln(phi), d/dT, d/dp and n*d/dn, fused") {
+        return am->get_ln_fugacity_coefficients_fused(T, rhovec, flags);
+    };
+    // The derivative pass alone, for comparison with the assembly of the pressure and mole number derivatives
+    BENCHMARK("value, gradient and Hessian of Psir") {
+        return am->build_Psir_fgradHessian_autodiff(T, rhovec);
+    };
+}
+
+TEST_CASE("Loading a multifluid model from a binary file", "[mf][binary]")
+{
+    nlohmann::json spec = {
+        {"kind", "multifluid"},
+        {"model", {
+            {"components", {"Methane", "Ethane", "Nitrogen", "CarbonDioxide"}},
+            {"root", "../mycp"},
+            {"BIP", ""},
+            {"departure", ""}
+        }
+    }};
+    auto path = (std::filesystem::temp_directory_path() / "teqp_bench_model.bin").string();
+    teqp::cppinterface::save_binary(spec, path);
+    
+    BENCHMARK("make_model") {
+        return teqp::cppinterface::make_model(spec);
+    };
+    BENCHMARK("load_binary") {
+        return teqp::cppinterface::load_binary(path);
+    };
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_approx.hpp>
+
+#include "teqp/models/multifluid.hpp"
+#include "teqp/derivs.hpp"
+
+using namespace teqp;
+
+// The 21 components of GERG-2008, as their reference EOS in the fluid library
+const std::vector<std::string> GERG_components = {
+    "Methane", "Nitrogen", "CarbonDioxide", "Ethane", "n-Propane", "n-Butane", "IsoButane",
+    "n-Pentane", "Isopentane", "n-Hexane", "n-Heptane", "n-Octane", "n-Nonane", "n-Decane",
+    "Hydrogen", "Oxygen", "CarbonMonoxide", "Water", "HydrogenSulfide", "Helium", "Argon"
+};
+
+TEST_CASE("Struct-of-arrays vs. variant evaluation of the EOS terms", "[EOSTerms]")
+{
+    std::vector<EOSTerms> EOSs;
+    for (auto& name : GERG_components) {
+        auto model = build_multifluid_model({ name }, "../mycp");
+        EOSs.push_back(model.corr.get_EOS(0));
+    }
+    const double tau = 1.3, delta = 0.8;
+    for (const auto& eos : EOSs) {
+        CHECK(eos.alphar(tau, delta) == Catch::Approx(eos.alphar_visit(tau, delta)));
+    }
+
+    BENCHMARK("21 fluids, std::visit of each term") {
+        double s = 0;
+        for (const auto& eos : EOSs) { s += eos.alphar_visit(tau, delta); }
+        return s;
+    };
+    BENCHMARK("21 fluids, struct-of-arrays") {
+        double s = 0;
+        for (const auto& eos : EOSs) { s += eos.alphar_flattened(tau, delta); }
+        return s;
+    };
+}
+
+TEST_CASE("Scaling of the departure contribution with the number of components", "[departure]")
+{
+    const double tau = 1.3, delta = 0.8;
+    nlohmann::json flags = {{"estimate", "Lorentz-Berthelot"}};
+    for (std::size_t N = 2; N <= GERG_components.size(); ++N) {
+        std::vector<std::string> names(GERG_components.begin(), GERG_components.begin() + N);
+        auto model = build_multifluid_model(names, "../mycp", "", flags);
+        Eigen::ArrayXd z = Eigen::ArrayXd::Constant(N, 1.0/N);
+        auto counts = "N=" + std::to_string(N) + " (" + std::to_string(model.dep.get_Nactive()) + " active pairs, " + std::to_string(model.dep.get_Ndistinct()) + " distinct functions)";
+        
+        BENCHMARK(counts + ", active pairs grouped by function") {
+            return model.dep.alphar(tau, delta, z);
+        };
+        // The cost of the dense loop over all the pairs, as it was done before the pairs were grouped
+        BENCHMARK(counts + ", every pair evaluated") {
+            double s = 0;
+            for (auto i = 0U; i < N; ++i) {
+                for (auto j = i + 1; j < N; ++j) {
+                    s += z[i]*z[j]*model.dep.get_alpharij(i, j, tau, delta);
+                }
+            }
+            return s;
+        };
+    }
+}
+
+TEST_CASE("Analytic vs. autodiff derivatives of a multifluid model", "[analytic]")
+{
+    auto model = build_multifluid_model({ "Methane", "Ethane", "Nitrogen", "CarbonDioxide" }, "../mycp");
+    Eigen::ArrayXd z(4); z << 0.85, 0.08, 0.05, 0.02;
+    double T = 250, rho = 5000;
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    
+    BENCHMARK("Ar01 w/ autodiff") {
+        return tdx::get_Ar01<ADBackends::autodiff>(model, T, rho, z);
+    };
+    BENCHMARK("Ar01 w/ analytic") {
+        return tdx::get_Ar01<ADBackends::analytic>(model, T, rho, z);
+    };
+    BENCHMARK("Ar21 w/ autodiff") {
+        return tdx::get_Ar21<ADBackends::autodiff>(model, T, rho, z);
+    };
+    BENCHMARK("Ar21 w/ analytic") {
+        return tdx::get_Ar21<ADBackends::analytic>(model, T, rho, z);
+    };
+    BENCHMARK("Ar0n<4> w/ autodiff") {
+        return tdx::get_Ar0n<4, ADBackends::autodiff>(model, T, rho, z);
+    };
+    BENCHMARK("Ar0n<4> w/ analytic") {
+        return tdx::get_Ar0n<4, ADBackends::analytic>(model, T, rho, z);
+    };
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ Forwards R and alphar of a model but none of its closed-form kernels, so that has_analytic_Arxy and
+ has_analytic_Psir_derivs are false and all the derivatives are obtained with automatic differentiation.
+ Used by the tests and benchmarks to check or time the kernels of a model against autodiff. The model is held by reference.
+ */
+template<typename Model>
+struct AutodiffOnly {
+    const Model& model;
+    template<typename VecType>
+    auto R(const VecType& molefrac) const { return model.R(molefrac); }
+    template<typename TType, typename RhoType, typename VecType>
+    auto alphar(const TType& T, const RhoType& rho, const VecType& molefrac) const { return model.alphar(T, rho, molefrac); }
+};
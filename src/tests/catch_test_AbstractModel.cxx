@@ -0,0 +1,227 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+using Catch::Approx;
+
+#include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/cached_model.hpp"
+#include "teqp/cpp/batch.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace teqp;
+
+auto build_PR_binary_AbstractModel(){
+    auto j = nlohmann::json::parse(R"({
+        "kind": "PR",
+        "model": {
+            "Tcrit / K": [190.564, 305.32],
+            "pcrit / Pa": [4599200, 4872200],
+            "acentric": [0.011, 0.099]
+        }
+    })");
+    return teqp::cppinterface::make_model(j);
+}
+
+TEST_CASE("Runtime orders of Arxy use the same backend as get_Arxy", "[AbstractModel]")
+{
+    auto model = build_PR_binary_AbstractModel();
+    auto z = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+    double T = 300, rho = 3000;
+    #define X(i,j) CHECK(model->get_Arxy(i, j, T, rho, z) == model->get_Ar ## i ## j(T, rho, z));
+        ARXY_args
+    #undef X
+    CHECK_THROWS_AS(model->get_Arxy(5, 1, T, rho, z), teqp::InvalidArgument);
+}
+
+TEST_CASE("Batched evaluation of Arxy", "[AbstractModel][batch]")
+{
+    auto model = build_PR_binary_AbstractModel();
+    const Eigen::Index N = 101;
+    Eigen::ArrayXd T = Eigen::ArrayXd::LinSpaced(N, 200, 400);
+    Eigen::ArrayXd rho = Eigen::ArrayXd::LinSpaced(N, 1, 10000);
+    Eigen::ArrayXXd molefracs(N, 2);
+    molefracs.col(0) = Eigen::ArrayXd::LinSpaced(N, 0.01, 0.99);
+    molefracs.col(1) = 1.0 - molefracs.col(0);
+    Eigen::ArrayXd out(N);
+
+    SECTION("one composition per state"){
+        for (auto Nthreads : {1, 4}){
+            model->get_Arxy_many(1, 1, T, rho, molefracs, out, Nthreads);
+            for (auto i = 0; i < N; ++i){
+                Eigen::ArrayXd z = molefracs.row(i).transpose();
+                CHECK(out[i] == Approx(model->get_Ar11(T[i], rho[i], z)));
+            }
+        }
+    }
+    SECTION("shared composition"){
+        Eigen::ArrayXXd z0 = molefracs.row(3);
+        model->get_Arxy_many(0, 2, T, rho, z0, out);
+        Eigen::ArrayXd z = z0.row(0).transpose();
+        for (auto i = 0; i < N; ++i){
+            CHECK(out[i] == Approx(model->get_Ar02(T[i], rho[i], z)));
+        }
+    }
+    SECTION("bad inputs"){
+        Eigen::ArrayXd outshort(N-1);
+        CHECK_THROWS(model->get_Arxy_many(0, 1, T, rho, molefracs, outshort));
+        CHECK_THROWS(model->get_Arxy_many(0, 1, T, rho.head(N-1), molefracs, out));
+        CHECK_THROWS(model->get_Arxy_many(5, 1, T, rho, molefracs, out));
+    }
+    SECTION("empty batch"){
+        Eigen::ArrayXd empty(0), outempty(0);
+        Eigen::ArrayXXd nomolefracs(0, 2);
+        CHECK_NOTHROW(model->get_Arxy_many(0, 1, empty, empty, nomolefracs, outempty));
+    }
+}
+
+TEST_CASE("Fused matrix of derivatives matches individual derivatives", "[AbstractModel][derivmat]")
+{
+    auto model = build_PR_binary_AbstractModel();
+    double T = 300, rho = 3000;
+    auto z = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+    auto mat = model->get_deriv_mat2(T, rho, z);
+    CHECK(mat(0,0) == Approx(model->get_Ar00(T, rho, z)));
+    CHECK(mat(0,1) == Approx(model->get_Ar01(T, rho, z)));
+    CHECK(mat(0,2) == Approx(model->get_Ar02(T, rho, z)));
+    CHECK(mat(1,0) == Approx(model->get_Ar10(T, rho, z)));
+    CHECK(mat(1,1) == Approx(model->get_Ar11(T, rho, z)));
+    CHECK(mat(1,2) == Approx(model->get_Ar12(T, rho, z)));
+    CHECK(mat(2,0) == Approx(model->get_Ar20(T, rho, z)));
+    CHECK(mat(2,1) == Approx(model->get_Ar21(T, rho, z)));
+    CHECK(mat(2,2) == Approx(model->get_Ar22(T, rho, z)));
+}
+
+TEST_CASE("All properties in one call", "[AbstractModel][properties]")
+{
+    auto model = build_PR_binary_AbstractModel();
+    double c0 = 4.0;
+    using o = nlohmann::json::object_t;
+    nlohmann::json jterms = {
+        o{ {"type", "Lead"}, { "a_1", 1.0 }, { "a_2", 2.0 } },
+        o{ {"type", "LogT"}, { "a", -(c0 - 1) } }
+    };
+    nlohmann::json jpure = {{"R", 8.31446261815324}, {"terms", jterms}};
+    auto aig = teqp::cppinterface::make_model({{"kind", "IdealHelmholtz"}, {"model", {jpure, jpure}}});
+    
+    double T = 300, rho = 3000;
+    auto z = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+    auto props = teqp::cppinterface::get_properties_Trho(*model, *aig, T, rho, z);
+    double R = model->get_R(z);
+    CHECK(props.p == Approx(rho*R*T*(1.0 + model->get_Ar01(T, rho, z))));
+    CHECK(props.cv == Approx(R*(c0 - 1) - R*model->get_Ar20(T, rho, z)));
+    CHECK(props.h - props.u == Approx(props.p/rho));
+    CHECK(props.g - props.a == Approx(props.p/rho));
+    CHECK(props.cp > props.cv);
+    
+    SECTION("batched"){
+        Eigen::ArrayXd Ts = Eigen::ArrayXd::LinSpaced(11, 250, 350);
+        Eigen::ArrayXd rhos = Eigen::ArrayXd::Constant(11, rho);
+        Eigen::ArrayXXd zs = z.transpose();
+        std::vector<StateProperties> out;
+        teqp::cppinterface::get_properties_Trho_many(*model, *aig, Ts, rhos, zs, out, 2);
+        REQUIRE(out.size() == 11);
+        for (auto i = 0; i < Ts.size(); ++i){
+            auto single = teqp::cppinterface::get_properties_Trho(*model, *aig, Ts[i], rho, z);
+            CHECK(out[i].cp == Approx(single.cp));
+            CHECK(out[i].Mw2 == Approx(single.Mw2));
+        }
+    }
+}
+
+TEST_CASE("Cached derivatives", "[AbstractModel][cache]")
+{
+    auto ref = build_PR_binary_AbstractModel();
+    auto cached = teqp::cppinterface::make_cached(build_PR_binary_AbstractModel());
+    double T = 300, rho = 3000;
+    auto z = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+    
+    SECTION("Arxy"){
+        CHECK(cached->get_Ar01(T, rho, z) == Approx(ref->get_Ar01(T, rho, z)));
+        CHECK(cached->get_Ar02(T, rho, z) == Approx(ref->get_Ar02(T, rho, z)));
+        CHECK(cached->get_Ar11(T, rho, z) == Approx(ref->get_Ar11(T, rho, z)));
+        CHECK(cached->get_Ar02n(T, rho, z)[2] == Approx(ref->get_Ar02(T, rho, z)));
+        CHECK(cached->get_Ar03(T, rho, z) == Approx(ref->get_Ar03(T, rho, z)));
+        auto stats = cached->get_cache_stats();
+        CHECK(stats.misses == 1);
+        CHECK(stats.hits == 3);
+    }
+    SECTION("isochoric"){
+        Eigen::ArrayXd rhovec = rho*z;
+        auto phi = cached->get_fugacity_coefficients(T, rhovec);
+        auto phiref = ref->get_fugacity_coefficients(T, rhovec);
+        for (auto i = 0; i < 2; ++i){
+            CHECK(phi[i] == Approx(phiref[i]));
+        }
+        CHECK(cached->get_pr(T, rhovec) == Approx(ref->get_pr(T, rhovec)));
+        CHECK(cached->build_Psir_gradient_autodiff(T, rhovec)[1] == Approx(ref->build_Psir_gradient_autodiff(T, rhovec)[1]));
+        FugacityFlags flags; flags.dp = true; flags.dn = true;
+        auto o = cached->get_ln_fugacity_coefficients_fused(T, rhovec, flags);
+        auto oref = ref->get_ln_fugacity_coefficients_fused(T, rhovec, flags);
+        CHECK(o.lnphi[1] == Approx(oref.lnphi[1]));
+        CHECK(o.dlnphidp[1] == Approx(oref.dlnphidp[1]));
+        CHECK(o.ndlnphidn(0, 1) == Approx(oref.ndlnphidn(0, 1)));
+        auto stats = cached->get_cache_stats();
+        CHECK(stats.misses == 1);
+        CHECK(stats.hits == 3);
+    }
+    SECTION("pure_VLE_T"){
+        auto jpure = nlohmann::json::parse(R"({"kind": "PR", "model": {"Tcrit / K": [190.564], "pcrit / Pa": [4599200], "acentric": [0.011]}})");
+        auto pureref = teqp::cppinterface::make_model(jpure);
+        auto purecached = teqp::cppinterface::make_cached(teqp::cppinterface::make_model(jpure));
+        auto soln = purecached->pure_VLE_T(150.0, 21000.0, 1100.0, 10);
+        auto solnref = pureref->pure_VLE_T(150.0, 21000.0, 1100.0, 10);
+        CHECK(soln[0] == Approx(solnref[0]));
+        CHECK(soln[1] == Approx(solnref[1]));
+        // dpsatdT_pure evaluates Ar01 and Ar10 at each phase, so at least two hits
+        purecached->reset_cache_stats();
+        CHECK(purecached->dpsatdT_pure(150.0, soln[0], soln[1]) == Approx(pureref->dpsatdT_pure(150.0, soln[0], soln[1])));
+        CHECK(purecached->get_cache_stats().hits >= 2);
+    }
+    SECTION("threads"){
+        // Each thread fills its own cache, and the caches of all threads are released with the model
+        const auto ref01 = cached->get_Ar01(T, rho, z);
+        cached->reset_cache_stats();
+        std::atomic<int> bad{0};
+        teqp::cppinterface::parallel_for_chunks(40, 4, [&](const Eigen::Index istart, const Eigen::Index iend){
+            for (auto i = istart; i < iend; ++i){
+                if (cached->get_Ar01(T, rho, z) != ref01){ ++bad; }
+            }
+        });
+        CHECK(bad == 0);
+        auto stats = cached->get_cache_stats();
+        CHECK(stats.misses == 4);
+        CHECK(stats.hits == 36);
+    }
+    CHECK_THROWS(teqp::cppinterface::make_cached(nullptr));
+}
+
+TEST_CASE("Binary files of models", "[AbstractModel][binary]")
+{
+    auto path = (std::filesystem::temp_directory_path() / "teqp_model.bin").string();
+    auto z = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+    
+    SECTION("multifluid"){
+        nlohmann::json spec = {{"kind", "multifluid"}, {"model", {{"components", {"Methane", "Ethane"}}, {"root", "../mycp"}, {"BIP", ""}, {"departure", ""}}}};
+        auto ref = teqp::cppinterface::make_model(spec);
+        teqp::cppinterface::save_binary(spec, path);
+        auto stored = teqp::cppinterface::load_binary_spec(path);
+        CHECK(stored.at("model").at("components")[0].is_object());
+        CHECK(!stored.at("model").contains("root"));
+        auto model = teqp::cppinterface::load_binary(path);
+        CHECK(model->get_Ar01(300, 3000, z) == Approx(ref->get_Ar01(300, 3000, z)));
+        CHECK(model->get_Ar20(300, 3000, z) == Approx(ref->get_Ar20(300, 3000, z)));
+    }
+    SECTION("PR"){
+        auto j = nlohmann::json::parse(R"({"kind": "PR", "model": {"Tcrit / K": [190.564, 305.32], "pcrit / Pa": [4599200, 4872200], "acentric": [0.011, 0.099]}})");
+        teqp::cppinterface::save_binary(j, path);
+        auto model = teqp::cppinterface::load_binary(path);
+        CHECK(model->get_Ar01(300, 3000, z) == Approx(build_PR_binary_AbstractModel()->get_Ar01(300, 3000, z)));
+    }
+    SECTION("bad file"){
+        { std::ofstream ofs(path); ofs << "{}"; }
+        CHECK_THROWS(teqp::cppinterface::load_binary(path));
+    }
+    std::filesystem::remove(path);
+}
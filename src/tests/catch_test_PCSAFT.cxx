@@ -26,6 +26,33 @@ TEST_CASE("Single alphar check value", "[PCSAFT]")
     CHECK(tdx::get_Ar00(model, T, Dmolar, z) == Approx(-0.032400020930842724));
 }
 
+TEST_CASE("Ternary alphar check values", "[PCSAFT]")
+{
+    // Methane, ethane, and a dipolar acetone-like component with non-zero kij; the values were obtained
+    // with the implementation that formed the mixing sums of Eqs. A.12 and A.13 term by term
+    std::vector<SAFTCoeffs> coeffs;
+    std::vector<double> m = {1.0, 1.6069, 2.7447}, sigma = {3.7039, 3.5206, 3.2742}, eoverk = {150.03, 191.42, 232.99};
+    for (auto i = 0; i < 3; ++i) {
+        SAFTCoeffs c;
+        c.m = m[i]; c.sigma_Angstrom = sigma[i]; c.epsilon_over_k = eoverk[i];
+        if (i == 2) { c.mustar2 = 1.5; c.nmu = 1; }
+        coeffs.push_back(c);
+    }
+    Eigen::ArrayXXd kmat(3, 3); kmat << 0, 0.01, 0.02, 0.01, 0, -0.015, 0.02, -0.015, 0;
+    auto model = PCSAFTMixture(coeffs, kmat);
+    auto z = (Eigen::ArrayXd(3) << 0.5, 0.3, 0.2).finished();
+    
+    std::vector<std::tuple<double, double, double>> checks = {
+        {150, 10, -0.0053613160603038171}, {150, 5000, -2.2249676734721873}, {150, 15000, -5.3022740438323996},
+        {300, 10, -0.0016159616444234527}, {300, 5000, -0.68529842516116435}, {300, 15000, -1.4133354832761966},
+        {450, 10, -0.00067072429547667669}, {450, 5000, -0.26473126558593002}, {450, 15000, -0.28607142961007548}
+    };
+    for (auto [T, rho, expected] : checks) {
+        CAPTURE(T); CAPTURE(rho);
+        CHECK(model.alphar(T, rho, z) == Approx(expected).epsilon(1e-13));
+    }
+}
+
 TEST_CASE("Check 0n derivatives", "[PCSAFT]")
 {
     std::vector<std::string> names = { "Methane", "Ethane" };
@@ -355,3 +382,99 @@ TEST_CASE("Check B and its temperature derivatives", "[PCSAFT],[B]")
     auto TdBdT = Tspec*model->get_dmBnvirdTm(2, 1, Tspec, z);
     CHECK(TdBdT == Approx(TdBdTnondilute));
 }
+
+TEST_CASE("Check PCSAFT association for methanol", "[PCSAFT],[association]")
+{
+    // 2B parameters from Gross and Sadowski, IECR, 2002
+    auto spec = nlohmann::json::parse(R"({
+        "coeffs": [{"name": "Methanol", "m": 1.5255, "sigma_Angstrom": 3.2300, "epsilon_over_k": 188.90, "BibTeXKey": "Gross-IECR-2002",
+                    "sites": ["e", "H"], "epsilon_AB_over_k": 2899.5, "kappa_AB": 0.035176}]
+    })");
+    auto model = PCSAFTfactory(spec);
+    spec["coeffs"][0].erase("sites");
+    auto nonassociating = PCSAFTfactory(spec);
+    
+    const double T = 300.0, rho = 20000.0;
+    auto z = (Eigen::ArrayXd(1) << 1.0).finished();
+    
+    SECTION("closed-form 2B solution"){
+        // Contact value of the radial distribution function from Eqn. A.7
+        auto vals = PCSAFTHardChainContribution(
+            (Eigen::ArrayXd(1) << 1.5255).finished(), (Eigen::ArrayXd(1) << 0.5255).finished(),
+            (Eigen::ArrayXd(1) << 3.2300).finished(), (Eigen::ArrayXd(1) << 188.90).finished(), Eigen::ArrayXXd::Zero(1,1)
+        ).eval(T, rho, z);
+        auto d = 3.2300*(1.0 - 0.12*exp(-3.0*188.90/T));
+        auto g = gij_HS(vals.zeta, std::vector<double>{d, d}, 0, 1);
+        auto rhoN_A3 = rho*N_A*1e-30;
+        auto Delta = g*0.035176*pow(3.2300, 3)*(exp(2899.5/T) - 1.0);
+        auto X = (-1.0 + sqrt(1.0 + 4.0*rhoN_A3*Delta))/(2.0*rhoN_A3*Delta);
+        auto alphar_assoc = model.alphar(T, rho, z) - nonassociating.alphar(T, rho, z);
+        CHECK(alphar_assoc == Approx(2.0*(log(X) - X/2.0 + 0.5)));
+    }
+    SECTION("derivatives through the implicit site fractions"){
+        using my_float_type = boost::multiprecision::number<boost::multiprecision::cpp_bin_float<100U>>;
+        my_float_type D = rho, h = pow(my_float_type(10.0), -10);
+        auto fD = [&](const auto& x) { return model.alphar(T, x, z); };
+        using tdx = TDXDerivatives<decltype(model)>;
+        auto Ar02 = tdx::get_Ar02(model, T, rho, z);
+        auto Ar02mp = static_cast<double>((D * D) * centered_diff<2, 4>(fD, D, h));
+        CHECK(Ar02 == Approx(Ar02mp).epsilon(1e-10));
+        auto Ar04 = tdx::get_Ar0n<4>(model, T, rho, z)[4];
+        auto Ar04mcx = tdx::get_Ar0n<4, ADBackends::multicomplex>(model, T, rho, z)[4];
+        CHECK(Ar04 == Approx(Ar04mcx).epsilon(1e-10));
+        auto Ar21 = tdx::get_Ar21(model, T, rho, z);
+        auto Ar21mcx = tdx::get_Arxy<2, 1, ADBackends::multicomplex>(model, T, rho, z);
+        CHECK(Ar21 == Approx(Ar21mcx).epsilon(1e-10));
+    }
+}
+
+TEST_CASE("Check PCSAFT cross-association in mixtures", "[PCSAFT],[association]")
+{
+    // 2B parameters of methanol and water from Gross and Sadowski, IECR, 2002
+    auto methanol = nlohmann::json::parse(R"({"name": "Methanol", "m": 1.5255, "sigma_Angstrom": 3.2300, "epsilon_over_k": 188.90, "BibTeXKey": "Gross-IECR-2002",
+                    "sites": ["e", "H"], "epsilon_AB_over_k": 2899.5, "kappa_AB": 0.035176})");
+    auto water = nlohmann::json::parse(R"({"name": "Water", "m": 1.0656, "sigma_Angstrom": 3.0007, "epsilon_over_k": 366.51, "BibTeXKey": "Gross-IECR-2002",
+                    "sites": ["e", "H"], "epsilon_AB_over_k": 2500.7, "kappa_AB": 0.034868})");
+    const double T = 300.0, rho = 30000.0;
+    
+    SECTION("a component split in two"){
+        // The sites of the two halves cross-associate, so the mixture is the pure fluid
+        auto pure = PCSAFTfactory({{"coeffs", {methanol}}});
+        auto split = PCSAFTfactory({{"coeffs", {methanol, methanol}}});
+        auto z = (Eigen::ArrayXd(1) << 1.0).finished();
+        auto z2 = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+        CHECK(split.alphar(T, rho, z2) == Approx(pure.alphar(T, rho, z)).epsilon(1e-13));
+    }
+    SECTION("mass action of methanol + water"){
+        auto model = PCSAFTfactory({{"coeffs", {methanol, water}}});
+        methanol.erase("sites"); water.erase("sites");
+        auto nonassociating = PCSAFTfactory({{"coeffs", {methanol, water}}});
+        auto z = (Eigen::ArrayXd(2) << 0.4, 0.6).finished();
+        
+        // Contact values of the radial distribution function from Eqn. A.7
+        auto m = (Eigen::ArrayXd(2) << 1.5255, 1.0656).finished(), sigma = (Eigen::ArrayXd(2) << 3.2300, 3.0007).finished(), eps = (Eigen::ArrayXd(2) << 188.90, 366.51).finished();
+        auto vals = PCSAFTHardChainContribution(m, m - 1.0, sigma, eps, Eigen::ArrayXXd::Zero(2, 2)).eval(T, rho, z);
+        auto d = (sigma*(1.0 - 0.12*exp(-3.0*eps/T))).eval();
+        auto gij = [&](std::size_t i, std::size_t j){ return gij_HS(vals.zeta, d, i, j); };
+        
+        REQUIRE(model.get_association());
+        const auto& assoc = model.get_association().value();
+        const auto& sites = assoc.get_sites();
+        auto rhoN_A3 = rho*N_A*1e-30;
+        auto Delta = assoc.get_Delta(T, gij);
+        auto X = assoc.get_X(T, rhoN_A3, z, gij);
+        bool cross = false;
+        for (auto k = 0; k < X.size(); ++k){
+            double summer = 0;
+            for (auto l = 0; l < X.size(); ++l){
+                summer += rhoN_A3*z[sites.component[l]]*sites.multiplicity[l]*Delta(k, l)*X[l];
+                cross = cross || (sites.component[k] != sites.component[l] && Delta(k, l) > 0);
+            }
+            CAPTURE(k);
+            CHECK(X[k]*(1.0 + summer) == Approx(1.0).epsilon(1e-12));
+        }
+        CHECK(cross);
+        auto alphar_assoc = model.alphar(T, rho, z) - nonassociating.alphar(T, rho, z);
+        CHECK(alphar_assoc == Approx(association::get_alphar(sites, X, z)).epsilon(1e-12));
+    }
+}
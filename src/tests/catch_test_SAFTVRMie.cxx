@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
+#include <catch2/benchmark/catch_benchmark_all.hpp>
 
 using Catch::Approx;
 
@@ -108,6 +109,81 @@ TEST_CASE("Check all xy derivs", "[SAFTVRMie]")
     int rr = 0;
 }
 
+TEST_CASE("Quaternary alphar check values", "[SAFTVRMie]")
+{
+    // Methane, ethane, propane, and a butane-like component with lambda_a != 6, with non-zero kij; the values
+    // were obtained with the implementation that evaluated the pair constants and per-exponent terms at every call
+    std::vector<SAFTVRMieCoeffs> coeffs;
+    std::vector<double> m = {1.0, 1.4373, 1.6845, 1.8514}, sigma = {3.7412e-10, 3.7257e-10, 3.9056e-10, 4.0887e-10},
+        eoverk = {153.36, 206.12, 239.89, 273.64}, lambda_r = {12.650, 12.400, 13.006, 13.650}, lambda_a = {6.0, 6.0, 6.0, 6.5};
+    for (auto i = 0; i < 4; ++i) {
+        SAFTVRMieCoeffs c;
+        c.m = m[i]; c.sigma_m = sigma[i]; c.epsilon_over_k = eoverk[i]; c.lambda_r = lambda_r[i]; c.lambda_a = lambda_a[i];
+        coeffs.push_back(c);
+    }
+    Eigen::ArrayXXd kmat(4, 4);
+    kmat << 0, 0.01, 0.02, -0.01,
+            0.01, 0, -0.015, 0.005,
+            0.02, -0.015, 0, 0.03,
+            -0.01, 0.005, 0.03, 0;
+    SAFTVRMieMixture model{coeffs, kmat};
+    auto z = (Eigen::ArrayXd(4) << 0.4, 0.3, 0.2, 0.1).finished();
+    
+    std::vector<std::tuple<double, double, double>> checks = {
+        {150, 10, -0.0050402217683889698}, {150, 5000, -2.5177942651087641}, {150, 12000, -4.5294952649792242},
+        {300, 10, -0.0014736025444827231}, {300, 5000, -0.66052612294988911}, {300, 12000, -1.2088359988234023},
+        {450, 10, -0.00056377561085354654}, {450, 5000, -0.22140043194283554}, {450, 12000, -0.2270881632063162}
+    };
+    for (auto [T, rho, expected] : checks) {
+        CAPTURE(T); CAPTURE(rho);
+        CHECK(model.alphar(T, rho, z) == Approx(expected).epsilon(1e-12));
+    }
+}
+
+TEST_CASE("Check SAFT-VR-Mie association for water", "[SAFTVRMie],[association]")
+{
+    // 4C parameters from Dufal et al., Mol. Phys., 2015
+    auto spec = nlohmann::json::parse(R"({
+        "coeffs": [
+            {"name": "Water", "m": 1.0, "sigma_Angstrom": 3.0063, "epsilon_over_k": 266.68, "lambda_r": 17.020, "lambda_a": 6.0, "BibTeXKey": "Dufal-MP-2015",
+             "sites": ["e", "e", "H", "H"], "epsilon_AB_over_k": 1985.4, "K_AB_Angstrom3": 101.69}
+        ]
+    })");
+    auto model = SAFTVRMiefactory(spec);
+    REQUIRE(model.get_association());
+    spec["coeffs"][0].erase("sites");
+    auto nonassociating = SAFTVRMiefactory(spec);
+    CHECK(!nonassociating.get_association());
+    
+    const double T = 300.0, rho = 55000.0;
+    auto z = (Eigen::ArrayXd(1) << 1.0).finished();
+    
+    SECTION("closed-form 4C solution"){
+        // For a pure fluid with m = 1, rho_s*sigma_x^3 is rhoN*sigma^3; the two e and the two H sites have the same fraction
+        auto rhoN_A3 = rho*N_A*1e-30;
+        auto I = DufalAssociationIntegral{}.get_I(T/266.68, rhoN_A3*pow(3.0063, 3));
+        auto Delta = 101.69*(exp(1985.4/T) - 1.0)*I;
+        auto X = (-1.0 + sqrt(1.0 + 8.0*rhoN_A3*Delta))/(4.0*rhoN_A3*Delta);
+        auto alphar_assoc = model.alphar(T, rho, z) - nonassociating.alphar(T, rho, z);
+        CHECK(alphar_assoc == Approx(4.0*(log(X) - X/2.0 + 0.5)).epsilon(1e-12));
+        // Obtained with this implementation
+        CHECK(model.alphar(T, rho, z) == Approx(-9.5587104443179811).epsilon(1e-12));
+    }
+    SECTION("saturation at the normal boiling point"){
+        // The deviations of the model from IAPWS-95 (101418 Pa and 53.20 kmol/m^3) are about 2% in pressure and 1% in liquid density
+        const double Tsat = 373.15;
+        auto rhoLV = pure_VLE_T(model, Tsat, 53000.0, 33.0, 20);
+        double p = rhoLV[1]*model.R(z)*Tsat*(1.0 + TDXDerivatives<decltype(model)>::get_Ar01(model, Tsat, rhoLV[1], z));
+        CHECK(p == Approx(101418).epsilon(0.03));
+        CHECK(rhoLV[0] == Approx(53200).epsilon(0.015));
+    }
+    SECTION("derivatives through the implicit site fractions"){
+        ijcheck<0,2>(model, T, rho, z);
+        ijcheck<1,1>(model, T, rho, z);
+        ijcheck<2,1>(model, T, rho, z);
+    }
+}
+
 TEST_CASE("Solve for critical point with three interface approaches", "[SAFTVRMie]")
 {
     Eigen::ArrayXXd kmat = Eigen::ArrayXXd::Zero(1,1);
@@ -400,3 +476,115 @@ TEST_CASE("Check ln(phi) and its derivatives", "[SAFTVRMielnphi]")
         CHECK(worst_error < 1e-10);
     }
 }
+
+TEST_CASE("Fused kernel for ln(phi) and its derivatives", "[SAFTVRMielnphi]")
+{
+    std::vector<std::string> names = {"Methane", "Ethane"};
+    SAFTVRMieMixture model{names};
+    double T = 300.0;
+    auto rhovec = (Eigen::ArrayXd(2) << 300, 200).finished();
+    Eigen::ArrayXd molefracs = forceeval(rhovec/rhovec.sum());
+    using iso = IsochoricDerivatives<decltype(model)>;
+    FugacityFlags flags; flags.dT = true; flags.dp = true; flags.dn = true;
+    auto o = iso::get_ln_fugacity_coefficients_fused(model, T, rhovec, flags);
+    
+    auto lnphi = iso::get_ln_fugacity_coefficients_Trhomolefracs(model, T, rhovec.sum(), molefracs);
+    CHECK(((o.lnphi - lnphi)/lnphi).cwiseAbs().maxCoeff() < 1e-12);
+    CHECK(o.Z == Approx(std::get<1>(iso::get_lnZ_Z_dZdrho(model, T, rhovec))));
+    
+    // At constant mole numbers, d/dT at constant density is d/dT at constant pressure plus d/dp*(dp/dT) at constant density
+    auto dlnphidT_rhovec = iso::get_d_ln_fugacity_coefficients_dT_constrhovec(model, T, rhovec);
+    auto dT_err = ((o.dlnphidT + o.dlnphidp*iso::get_dpdT_constrhovec(model, T, rhovec) - dlnphidT_rhovec)/dlnphidT_rhovec).cwiseAbs().maxCoeff();
+    CHECK(dT_err < 1e-10);
+    // and d/drho at constant mole fractions is d/dp*(dp/drho)
+    auto dlnphidrho = iso::get_d_ln_fugacity_coefficients_drho_constTmolefracs(model, T, rhovec);
+    auto dpdrho = (iso::get_dpdrhovec_constT(model, T, rhovec)*molefracs).sum();
+    CHECK(((o.dlnphidp*dpdrho - dlnphidrho)/dlnphidrho).cwiseAbs().maxCoeff() < 1e-10);
+    
+    // Gibbs-Duhem, and symmetry of the mole number derivatives
+    CHECK((molefracs.matrix().transpose()*o.ndlnphidn.matrix()).cwiseAbs().maxCoeff() < 1e-12);
+    CHECK(o.ndlnphidn(0, 1) == Approx(o.ndlnphidn(1, 0)));
+    
+    // The mole number derivatives by finite differences of ln(phi) in n_j, with the density that keeps the pressure
+    // constant found by Newton's method; with n summing to one, n*d(ln(phi_i))/dn_j is the derivative itself
+    const double R = model.R(molefracs);
+    const double p = rhovec.sum()*R*T + iso::get_pr(model, T, rhovec);
+    auto get_lnphi_Tp = [&](const Eigen::ArrayXd& n){
+        Eigen::ArrayXd x = n/n.sum();
+        double rho = rhovec.sum();
+        for (auto it = 0; it < 20; ++it){
+            Eigen::ArrayXd rv = rho*x;
+            rho -= (rho*R*T + iso::get_pr(model, T, rv) - p)/(iso::get_dpdrhovec_constT(model, T, rv)*x).sum();
+        }
+        return iso::get_ln_fugacity_coefficients(model, T, (rho*x).eval()).eval();
+    };
+    const double dn = 1e-5;
+    for (auto j = 0; j < 2; ++j){
+        Eigen::ArrayXd nplus = molefracs, nminus = molefracs;
+        nplus[j] += dn; nminus[j] -= dn;
+        Eigen::ArrayXd numerical = (get_lnphi_Tp(nplus) - get_lnphi_Tp(nminus))/(2*dn);
+        for (auto i = 0; i < 2; ++i){
+            CAPTURE(i, j);
+            CHECK(o.ndlnphidn(i, j) == Approx(numerical[i]).margin(1e-8));
+        }
+    }
+    
+    // Only the requested derivatives are calculated
+    auto obare = iso::get_ln_fugacity_coefficients_fused(model, T, rhovec);
+    CHECK(obare.dlnphidT.size() == 0);
+    CHECK(obare.ndlnphidn.size() == 0);
+    CHECK(obare.Z == Approx(o.Z));
+}
+
+TEST_CASE("Chebyshev expansions of the diameters", "[SAFTVRMie],[dii]")
+{
+    std::vector<std::string> names = {"Methane", "Ethane", "Propane"};
+    nlohmann::json flags = {{"dii_surrogate", {{"Tmin / K", 20.0}, {"Tmax / K", 3000.0}}}};
+    SAFTVRMieMixture exact{names}, fast{names, std::nullopt, flags};
+    for (double T : {20.0, 55.5, 300.0, 1234.5, 3000.0}){
+        auto dexact = exact.get_terms().get_dmat(T), dfast = fast.get_terms().get_dmat(T);
+        CHECK(((dexact - dfast)/dexact).abs().maxCoeff() < 1e-13);
+    }
+    // Outside the range the quadrature is used
+    CHECK(fast.get_terms().get_dmat(5000.0)(0,0) == exact.get_terms().get_dmat(5000.0)(0,0));
+    
+    // Derivatives with respect to temperature are taken through the expansions
+    auto z = (Eigen::ArrayXd(3) << 0.3, 0.3, 0.4).finished();
+    double T = 250, rho = 3000;
+    using tdx = TDXDerivatives<SAFTVRMieMixture, double, Eigen::ArrayXd>;
+    CHECK(tdx::get_Ar10(fast, T, rho, z) == Approx(tdx::get_Ar10(exact, T, rho, z)).epsilon(1e-10));
+    CHECK(tdx::get_Ar20(fast, T, rho, z) == Approx(tdx::get_Ar20(exact, T, rho, z)).epsilon(1e-8));
+    CHECK(tdx::get_Ar11(fast, T, rho, z) == Approx(tdx::get_Ar11(exact, T, rho, z)).epsilon(1e-10));
+    
+    nlohmann::json bad = {{"dii_surrogate", {{"Tmin / K", 300.0}, {"Tmax / K", 20.0}}}};
+    CHECK_THROWS(SAFTVRMieMixture(names, std::nullopt, bad));
+}
+
+TEST_CASE("Benchmark the Chebyshev expansions of the diameters", "[SAFTVRMie],[dii],[.benchmark]")
+{
+    std::vector<std::string> names = {"Methane", "Ethane", "Propane"};
+    nlohmann::json flags = {{"dii_surrogate", {{"Tmin / K", 20.0}, {"Tmax / K", 3000.0}}}};
+    SAFTVRMieMixture exact{names}, fast{names, std::nullopt, flags};
+    auto z = (Eigen::ArrayXd(3) << 0.3, 0.3, 0.4).finished();
+    double T = 250, rho = 3000;
+    using tdx = TDXDerivatives<SAFTVRMieMixture, double, Eigen::ArrayXd>;
+    
+    BENCHMARK("dmat by quadrature") {
+        return exact.get_terms().get_dmat(T);
+    };
+    BENCHMARK("dmat from expansions") {
+        return fast.get_terms().get_dmat(T);
+    };
+    BENCHMARK("alphar by quadrature") {
+        return exact.alphar(T, rho, z);
+    };
+    BENCHMARK("alphar from expansions") {
+        return fast.alphar(T, rho, z);
+    };
+    BENCHMARK("Ar20 by quadrature") {
+        return tdx::get_Ar20(exact, T, rho, z);
+    };
+    BENCHMARK("Ar20 from expansions") {
+        return tdx::get_Ar20(fast, T, rho, z);
+    };
+}
@@ -9,7 +9,10 @@ using Catch::Approx;
 #include "teqp/models/cubics.hpp"
 #include "teqp/derivs.hpp"
 #include "teqp/algorithms/VLE.hpp"
+#include "teqp/algorithms/superancillary.hpp"
 #include "teqp/cpp/teqpcpp.hpp"
+#include "teqp/cpp/deriv_adapter.hpp"
+#include "autodiff_only.hpp"
 
 #include <boost/numeric/odeint/stepper/euler.hpp>
 #include <boost/numeric/odeint/stepper/runge_kutta_cash_karp54.hpp>
@@ -86,6 +89,161 @@ TEST_CASE("Check calling superancillary curves", "[cubic][superanc]")
     }
 }
 
+TEST_CASE("Superancillary VLE through AbstractModel", "[cubic][superanc]")
+{
+    auto j = nlohmann::json::parse(R"(
+    {
+        "kind": "PR",
+        "model": {
+            "Tcrit / K": [190.564, 150.687],
+            "pcrit / Pa": [4599200, 4863000],
+            "acentric": [0.011, -0.002]
+        }
+    }
+    )");
+    const auto mix = teqp::cppinterface::make_model(j);
+    REQUIRE(mix->has_superanc());
+    
+    j["model"]["Tcrit / K"] = {150.687};
+    j["model"]["pcrit / Pa"] = {4863000};
+    j["model"]["acentric"] = {-0.002};
+    const auto pure = teqp::cppinterface::make_model(j);
+    
+    double T = 130.0;
+    auto sat = mix->superanc_VLE_T(T, 1);
+    CHECK(sat[1] == Approx(pure->superanc_VLE_T(T)[1]));
+    
+    // With no Newton steps, the superancillary values are returned directly, whatever the guesses
+    auto rhoLV0 = pure->pure_VLE_T(T, 1.0, 1.0, 0);
+    CHECK(rhoLV0[0] == sat[1]);
+    CHECK(rhoLV0[1] == sat[2]);
+    auto rhoLV = pure->pure_VLE_T(T, 1.0, 1.0, 10);
+    CHECK(rhoLV[0] == Approx(sat[1]));
+    CHECK(rhoLV[1] == Approx(sat[2]));
+    auto z = (Eigen::ArrayXd(1) << 1.0).finished();
+    CHECK(sat[0] == Approx(rhoLV[1]*pure->get_R(z)*T*(1.0 + pure->get_Ar01(T, rhoLV[1], z))));
+    
+    Eigen::ArrayXd Ts = Eigen::ArrayXd::LinSpaced(20, 100, 140);
+    EMatrixd out(Ts.size(), 3);
+    mix->superanc_VLE_T_many(Ts, 1, out, 2);
+    for (auto i = 0; i < Ts.size(); ++i) {
+        CHECK((out.row(i).transpose() == mix->superanc_VLE_T(Ts[i], 1)).all());
+    }
+    CHECK_THROWS(mix->superanc_VLE_T(T, 2));
+}
+
+TEST_CASE("A generic cubic without superancillary equations says so", "[cubic][superanc]")
+{
+    std::valarray<double> Tc_K = {150.687}, pc_Pa = {4863000};
+    std::vector<AlphaFunctionOptions> alphas = {BasicAlphaFunction(Tc_K[0], 0.37464)};
+    auto cub = GenericCubic(1.0, 0.0, 0.42748, 0.08664, CubicSuperAncillary::UNKNOWN_CODE, Tc_K, pc_Pa, std::move(alphas), Eigen::ArrayXXd::Zero(1, 1));
+    CHECK(!cub.has_superanc());
+    CHECK_THROWS_AS(cub.superanc_VLE_T(130.0), teqp::InvalidArgument);
+    
+    auto am = teqp::cppinterface::adapter::make_owned(cub);
+    CHECK(!am->has_superanc());
+    // The guesses are used as is
+    auto rhoLV = am->pure_VLE_T(130.0, 1.0, 1.0, 0);
+    CHECK(rhoLV[0] == 1.0);
+    CHECK(rhoLV[1] == 1.0);
+}
+
+TEST_CASE("Build the superancillary equations of a pure fluid from a model", "[cubic][superanc]")
+{
+    auto j = nlohmann::json::parse(R"(
+    {
+        "kind": "PR",
+        "model": {
+            "Tcrit / K": [190.564, 150.687],
+            "pcrit / Pa": [4599200, 4863000],
+            "acentric": [0.011, -0.002]
+        }
+    }
+    )");
+    const auto mix = teqp::cppinterface::make_model(j);
+    // The second component of the mixture, compared with the superancillary equations of the cubic
+    nlohmann::json spec = {
+        {"Tmin", 84.0}, {"Tcguess", 150.0}, {"rhocguess", 13000.0}, {"Nthreads", 2},
+        {"pure_spec", {{"alternative_pure_index", 1}, {"alternative_length", 2}}}
+    };
+    auto sa = build_pure_superancillary(*mix, spec);
+    CHECK(sa.Tc == Approx(150.687).epsilon(1e-8));
+    CHECK(sa.Tmin == 84.0);
+    for (auto T : {84.0, 100.0, 120.0, 140.0, 150.0}) {
+        CAPTURE(T);
+        auto expected = mix->superanc_VLE_T(T, 1);
+        auto got = sa(T);
+        for (auto k = 0; k < 3; ++k) {
+            CHECK(got[k] == Approx(expected[k]).epsilon(1e-9));
+        }
+    }
+    CHECK_THROWS(sa(sa.Tc));
+
+    // Round trip through JSON
+    PureSuperAncillary sa2(nlohmann::json::parse(sa.to_json().dump()));
+    CHECK((sa2(123.4) == sa(123.4)).all());
+}
+
+TEST_CASE("Build the superancillary equations of PC-SAFT methane", "[PCSAFT][superanc]")
+{
+    const auto model = teqp::cppinterface::make_model(nlohmann::json::parse(R"({"kind": "PCSAFT", "model": {"names": ["Methane"]}})"));
+    const double tol = 1e-10;
+    nlohmann::json spec = {{"Tmin", 91.0}, {"Tcguess", 191.0}, {"rhocguess", 9000.0}, {"Tred_max", 0.999}, {"tol", tol}, {"Nthreads", 2}};
+    auto sa = build_pure_superancillary(*model, spec);
+    CHECK(sa.Tmax == Approx(0.999*sa.Tc).epsilon(1e-14));
+
+    // The guesses of the VLE calculations are from the superancillary equations of Peng-Robinson methane in corresponding
+    // states, so they do not depend on the walk of the builder
+    const auto pr = teqp::cppinterface::make_model(nlohmann::json::parse(R"({"kind": "PR", "model": {"Tcrit / K": [190.564], "pcrit / Pa": [4599200], "acentric": [0.011]}})"));
+    const double TcPR = 190.564, rhocPR = 4599200/(8.31446261815324*TcPR*0.3074013086987);
+    const auto z = (Eigen::ArrayXd(1) << 1.0).finished();
+    const double R = model->get_R(z);
+    for (auto T : {91.0, 97.3, 123.7, 161.1, 183.9, 189.6, sa.Tmax}) {
+        CAPTURE(T);
+        auto guess = pr->superanc_VLE_T(T/sa.Tc*TcPR);
+        auto rhoLV = model->pure_VLE_T(T, guess[1]*sa.rhoc/rhocPR, guess[2]*sa.rhoc/rhocPR, 20);
+        REQUIRE(rhoLV[0] > 1.01*rhoLV[1]);
+        double p = rhoLV[1]*R*T*(1 + model->get_Ar01(T, rhoLV[1], z));
+        auto got = sa(T);
+        CHECK(got[0] == Approx(p).epsilon(tol));
+        CHECK(got[1] == Approx(rhoLV[0]).epsilon(tol));
+        CHECK(got[2] == Approx(rhoLV[1]).epsilon(tol));
+    }
+}
+
+TEST_CASE("Indexed and batch evaluation of the superancillaries", "[cubic][superanc]")
+{
+    using namespace CubicSuperAncillary;
+    const auto& sa = PR_rhoV;
+    const double xmin = sa.exps.front().xmin, xmax = sa.exps.back().xmax;
+    // Uniform in Ttilde, then approaching the critical point where the expansions are refined
+    std::vector<double> x;
+    for (auto i = 0; i <= 1000; ++i) {
+        x.push_back(xmin + (xmax - xmin)*i/1000.0);
+        x.push_back(xmax - (xmax - xmin)*std::pow(10.0, -1.0 - 7.0*i/1000.0));
+    }
+    for (const auto& e : sa.exps) {
+        x.push_back(e.xmin);
+    }
+    std::vector<double> y(x.size());
+    sa.y_many(x.data(), &(y[0]), x.size());
+    for (auto k = 0U; k < x.size(); ++k) {
+        CAPTURE(x[k]);
+        auto i = sa.get_index(x[k]);
+        CHECK(sa.exps[i].xmin <= x[k]);
+        CHECK((x[k] < sa.exps[i].xmax || i + 1 == static_cast<int>(sa.exps.size())));
+        // The loops are not required to be bitwise identical: the compiler may contract them to FMA
+        // differently, in particular the blocked recurrences of y_many once they are vectorized
+        CHECK(sa.y(x[k]) == Approx(sa.exps[i].y(x[k])).epsilon(1e-15));
+        CHECK(y[k] == Approx(sa.y(x[k])).epsilon(1e-15));
+    }
+    CHECK_THROWS(sa.y(xmax*1.01));
+    double bad = xmin*0.99;
+    CHECK_THROWS(sa.y_many(&bad, &(y[0]), 1));
+    CHECK_THROWS(sa.get_index(bad));
+    CHECK_THROWS(SuperAncillary(std::vector<Chebyshev>{}));
+}
+
 TEST_CASE("Check orthobaric density derivatives for pure fluid", "[cubic][superanc]")
 {
     std::valarray<double> Tc_K = { 150.687 };
@@ -238,6 +396,13 @@ TEST_CASE("Check manual integration of subcritical VLE isotherm for binary mixtu
 
         double pfinal = J.back().at("pL / Pa").back();
         CHECK(std::abs(pfinal / pfinal_goal-1) < 1e-5);
+        
+        // The columnar output holds the same trace
+        auto cols = trace_VLE_isotherm_binary_columns(model, T, rhovecL0, rhovecV0, opt);
+        REQUIRE(static_cast<std::size_t>(cols.pL.size()) == Nstep);
+        CHECK(cols.rhoL.cols() == 2);
+        CHECK(cols.pL(cols.pL.size()-1) == Approx(pfinal));
+        CHECK(VLE_trace_to_JSON(cols).size() == Nstep);
     }
 }
 
@@ -540,3 +705,63 @@ TEST_CASE("Check generalized and alphas", "[PRalpha]"){
         CHECK(m2.get_meta() != m0.get_meta());
     }
 }
+
+TEST_CASE("Analytic density derivatives of cubics match autodiff", "[cubic][analytic]")
+{
+    std::valarray<double> Tc_K = { 190.564, 154.581, 150.687 },
+                pc_Pa = { 4599200, 5042800, 4863000 },
+               acentric = { 0.011, 0.022, -0.002};
+    auto model = canonical_PR(Tc_K, pc_Pa, acentric);
+    auto z = (Eigen::ArrayXd(3) << 0.3, 0.4, 0.3).finished();
+    double T = 200, rho = 8000;
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    CHECK(tdx::get_Arxy<0, 1, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 1, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<0, 2, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 2, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<0, 3, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 3, ADBackends::autodiff>(model, T, rho, z)));
+    auto Ar0nan = tdx::get_Ar0n<6, ADBackends::analytic>(model, T, rho, z);
+    auto Ar0nad = tdx::get_Ar0n<6, ADBackends::autodiff>(model, T, rho, z);
+    for (auto n = 0; n <= 6; ++n) {
+        CHECK(Ar0nan[n] == Approx(Ar0nad[n]));
+    }
+    CHECK(tdx::get_Arxy<1, 1, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<1, 1, ADBackends::autodiff>(model, T, rho, z)));
+}
+
+TEST_CASE("Analytic temperature and concentration derivatives of cubics match autodiff", "[cubic][analytic]")
+{
+    std::valarray<double> Tc_K = { 190.564, 154.581, 150.687 },
+                pc_Pa = { 4599200, 5042800, 4863000 },
+               acentric = { 0.011, 0.022, -0.002};
+    Eigen::ArrayXXd kmat = Eigen::ArrayXXd::Zero(3, 3);
+    kmat(0, 1) = kmat(1, 0) = 0.05;
+    auto model = canonical_SRK(Tc_K, pc_Pa, acentric, kmat);
+    AutodiffOnly<decltype(model)> ad{model};
+    auto z = (Eigen::ArrayXd(3) << 0.3, 0.4, 0.3).finished();
+    double T = 200, rho = 8000;
+    
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    CHECK(tdx::get_Arxy<2, 0, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<2, 0, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<2, 1, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<2, 1, ADBackends::autodiff>(model, T, rho, z)));
+    auto Arn0an = tdx::get_Arn0<3, ADBackends::analytic>(model, T, rho, z);
+    auto Arn0ad = tdx::get_Arn0<3, ADBackends::autodiff>(model, T, rho, z);
+    for (auto n = 0; n <= 3; ++n) {
+        CHECK(Arn0an[n] == Approx(Arn0ad[n]));
+    }
+    
+    using id = IsochoricDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    using idad = IsochoricDerivatives<decltype(ad), double, Eigen::ArrayXd>;
+    Eigen::ArrayXd rhovec = rho*z;
+    auto [f, grad, H] = id::build_Psir_fgradHessian_autodiff(model, T, rhovec);
+    auto [fad, gradad, Had] = idad::build_Psir_fgradHessian_autodiff(ad, T, rhovec);
+    CHECK(f == Approx(fad));
+    auto gradonly = id::build_Psir_gradient_autodiff(model, T, rhovec);
+    auto Honly = id::build_Psir_Hessian_autodiff(model, T, rhovec);
+    for (auto i = 0; i < 3; ++i) {
+        CHECK(grad[i] == Approx(gradad[i]));
+        CHECK(gradonly[i] == Approx(gradad[i]));
+        for (auto j = 0; j < 3; ++j) {
+            CHECK(H(i, j) == Approx(Had(i, j)));
+            CHECK(Honly(i, j) == Approx(Had(i, j)));
+        }
+    }
+    CHECK(id::get_fugacity_coefficients(model, T, rhovec)[0] == Approx(idad::get_fugacity_coefficients(ad, T, rhovec)[0]));
+}
@@ -8,6 +8,7 @@ using Catch::Approx;
 
 #include "teqp/models/multifluid.hpp"
 #include "teqp/models/multifluid_ancillaries.hpp"
+#include "teqp/models/multifluid_binary.hpp"
 #include "teqp/algorithms/critical_tracing.hpp"
 #include "teqp/algorithms/VLE.hpp"
 #include "teqp/cpp/teqpcpp.hpp"
@@ -144,7 +145,18 @@ TEST_CASE("Check that all pure fluid models can be instantiated", "[multifluid],
             std::valarray<double> z(0.0, 1);
             model.alphar(300, 1.0, z);
         }
-    }    
+    }
+    SECTION("Struct-of-arrays evaluation matches visiting the terms") {
+        for (auto path : get_files_in_folder(root + "/dev/fluids", ".json")) {
+            auto stem = path.filename().stem().string();
+            if (stem == "Methanol") { continue; }
+            CAPTURE(stem);
+            auto eos = build_multifluid_model({ stem }, root).corr.get_EOS(0);
+            for (double delta : {1e-3, 0.5, 2.0}) {
+                CHECK(eos.alphar(0.8, delta) == Approx(eos.alphar_visit(0.8, delta)).margin(1e-14));
+            }
+        }
+    }
 }
 
 TEST_CASE("Check that all ancillaries can be instantiated and work properly", "[multifluid],[all]") {
@@ -243,6 +255,24 @@ TEST_CASE("Check that all binary pairs specified in the binary pair file can be
     }
 }
 
+TEST_CASE("Cache of parsed JSON files", "[multifluid],[cache]") {
+    std::string root = "../mycp";
+    auto path = root + "/dev/mixtures/mixture_binary_pairs.json";
+    auto j1 = load_a_JSON_file_cached(path);
+    auto j2 = load_a_JSON_file_cached(std::filesystem::absolute(path).string());
+    CHECK(j1 == j2); // the same parsed data are shared
+    CHECK(*j1 == load_a_JSON_file(path));
+
+    // A modified file is parsed again
+    auto tmp = (std::filesystem::temp_directory_path() / "teqp_cache_test.json").string();
+    { std::ofstream ofs(tmp); ofs << R"({"a": 1})"; }
+    CHECK(load_a_JSON_file_cached(tmp)->at("a") == 1);
+    { std::ofstream ofs(tmp); ofs << R"({"a": 12})"; }
+    CHECK(load_a_JSON_file_cached(tmp)->at("a") == 12);
+    std::filesystem::remove(tmp);
+    CHECK_THROWS(load_a_JSON_file_cached(tmp));
+}
+
 TEST_CASE("Check that all pure fluid models can be evaluated at zero density", "[multifluid],[all],[virial]") {
     std::string root = "../mycp";
     SECTION("With filename stems") {
@@ -473,3 +503,97 @@ TEST_CASE("Test ECS for pure fluids", "[ECS]"){
     auto z = (Eigen::ArrayXd(1) << 1.0).finished();
     double alphar = model->get_Ar00(T, rho, z);
 }
+
+TEST_CASE("Fixed-composition view of a multifluid model", "[multifluid],[fixedcomposition]") {
+    auto model = build_multifluid_model({ "Methane", "Ethane", "Nitrogen", "CarbonDioxide" }, "../mycp");
+    Eigen::ArrayXd z(4); z << 0.85, 0.08, 0.05, 0.02;
+    auto view = make_fixed_composition(model, z);
+    CHECK(view.get_Tr() == Approx(model.redfunc.get_Tr(z)));
+    
+    double T = 250, rho = 5000;
+    CHECK(view.alphar(T, rho, z) == Approx(model.alphar(T, rho, z)));
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    using tdxview = TDXDerivatives<decltype(view), double, Eigen::ArrayXd>;
+    CHECK(tdxview::get_Ar01(view, T, rho, z) == Approx(tdx::get_Ar01(model, T, rho, z)));
+    CHECK(tdxview::get_Ar20(view, T, rho, z) == Approx(tdx::get_Ar20(model, T, rho, z)));
+    
+    // Another composition is forwarded to the model
+    Eigen::ArrayXd z2(4); z2 << 0.25, 0.25, 0.25, 0.25;
+    CHECK(view.alphar(T, rho, z2) == Approx(model.alphar(T, rho, z2)));
+    CHECK_THROWS(make_fixed_composition(model, z.head(3).eval()));
+    
+    // Mole fractions of the wrong length are rejected by the departure contribution too
+    CHECK_THROWS_AS(model.dep.alphar(1.3, 0.8, z.head(3).eval()), teqp::InvalidArgument);
+    CHECK_THROWS_AS(model.dep.get_weights(z.head(3).eval()), teqp::InvalidArgument);
+}
+
+TEST_CASE("Grouped departure functions of a GERG-2008 mixture", "[multifluid],[departure]") {
+    // The pairs of these hydrocarbons other than methane+ethane and methane+propane share the generalized departure function
+    auto model = build_multifluid_model({ "Methane", "Ethane", "n-Propane", "n-Butane", "IsoButane" }, "../mycp");
+    const auto& dep = model.dep;
+    CHECK(dep.get_Ndistinct() < dep.get_Nactive());
+    
+    Eigen::ArrayXd z(5); z << 0.6, 0.15, 0.1, 0.08, 0.07;
+    const auto& F = dep.get_F();
+    for (const auto& state : std::vector<std::tuple<double, double>>{{0.8, 0.1}, {1.3, 0.8}, {2.1, 2.5}}) {
+        const auto [tau, delta] = state;
+        CAPTURE(state);
+        // The dense sum over all the binary pairs
+        double dense = 0.0;
+        for (auto i = 0; i < z.size(); ++i) {
+            for (auto j = i + 1; j < z.size(); ++j) {
+                dense += z[i]*z[j]*F(i, j)*dep.get_alpharij(i, j, tau, delta);
+            }
+        }
+        CHECK(dense != 0.0);
+        CHECK(dep.alphar(tau, delta, z) == Approx(dense).epsilon(1e-14));
+        CHECK(dep.alphar_weighted(tau, delta, dep.get_weights(z)) == Approx(dense).epsilon(1e-14));
+    }
+}
+
+TEST_CASE("Analytic derivatives of multifluid models match autodiff", "[multifluid],[analytic]") {
+    auto model = build_multifluid_model({ "Methane", "Ethane", "Nitrogen", "CarbonDioxide" }, "../mycp");
+    Eigen::ArrayXd z(4); z << 0.85, 0.08, 0.05, 0.02;
+    double T = 250, rho = 5000;
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    CHECK(tdx::get_Arxy<1, 0, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<1, 0, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<0, 1, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 1, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<2, 0, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<2, 0, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<1, 1, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<1, 1, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<0, 4, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 4, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<2, 2, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<2, 2, ADBackends::autodiff>(model, T, rho, z)));
+    CHECK(tdx::get_Arxy<4, 0, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<4, 0, ADBackends::autodiff>(model, T, rho, z)));
+    
+    auto Ar0nan = tdx::get_Ar0n<4, ADBackends::analytic>(model, T, rho, z);
+    auto Ar0nad = tdx::get_Ar0n<4, ADBackends::autodiff>(model, T, rho, z);
+    for (auto n = 0; n <= 4; ++n) {
+        CHECK(Ar0nan[n] == Approx(Ar0nad[n]));
+    }
+    
+    // The fixed-composition view uses the same kernels
+    auto view = make_fixed_composition(model, z);
+    using tdxview = TDXDerivatives<decltype(view), double, Eigen::ArrayXd>;
+    CHECK(tdxview::get_Arxy<2, 1, ADBackends::analytic>(view, T, rho, z) == Approx(tdx::get_Arxy<2, 1, ADBackends::autodiff>(model, T, rho, z)));
+    
+    // Orders above 4 fall back to autodiff
+    CHECK(tdx::get_Arxy<0, 5, ADBackends::analytic>(model, T, rho, z) == Approx(tdx::get_Arxy<0, 5, ADBackends::autodiff>(model, T, rho, z)));
+}
+
+TEST_CASE("Binary tables of a multifluid model", "[multifluid],[binary]") {
+    auto model = build_multifluid_model({ "Methane", "Ethane", "Nitrogen", "CarbonDioxide" }, "../mycp");
+    auto tables = multifluid_to_binary(model);
+    auto loaded = multifluid_from_binary(tables.data(), tables.data() + tables.size());
+    
+    Eigen::ArrayXd z(4); z << 0.85, 0.08, 0.05, 0.02;
+    double T = 250, rho = 5000;
+    CHECK(loaded.alphar(T, rho, z) == model.alphar(T, rho, z));
+    CHECK(loaded.dep.get_Ndistinct() == model.dep.get_Ndistinct());
+    CHECK(loaded.dep.get_Nactive() == model.dep.get_Nactive());
+    CHECK(loaded.get_meta() == model.get_meta());
+    using tdx = TDXDerivatives<decltype(model), double, Eigen::ArrayXd>;
+    CHECK(tdx::get_Ar20(loaded, T, rho, z) == Approx(tdx::get_Ar20(model, T, rho, z)));
+    
+    CHECK_THROWS_AS(multifluid_from_binary(tables.data(), tables.data() + tables.size()/2), teqp::InvalidArgument);
+    tables.push_back(0);
+    CHECK_THROWS_AS(multifluid_from_binary(tables.data(), tables.data() + tables.size()), teqp::InvalidArgument);
+}
@@ -6,6 +6,7 @@ using Catch::Approx;
 #include "teqp/core.hpp"
 #include "teqp/models/cubicsuperancillary.hpp"
 #include "teqp/models/CPA.hpp"
+#include "autodiff_only.hpp"
 #include "teqp/models/vdW.hpp"
 
 #include "teqp/algorithms/VLE.hpp"
@@ -276,6 +277,26 @@ TEST_CASE("Trace critical locus for vdW", "[vdW][crit]")
         max_spluses[ifluid] = max_splus;
 
         CHECK(trace.back().at("T / K") == Approx(Tc_K[1 - ifluid]));
+
+        // The streaming tracer hands over the same points, keeping only the last one here
+        CriticalTracePoint last;
+        auto Npoints = ct::trace_critical_arclength_binary_sink(vdW, T0, rhovec0, [&last](const CriticalTracePoint& pt){ last = pt; }, opt);
+        CHECK(Npoints == trace.size());
+        CHECK(last.T == Approx(trace.back().at("T / K")));
+
+        // The CSV file has the header, then one row per point of the trace, starting with the initial state
+        {
+            std::string csvname = "vdW_crit_trace.csv";
+            ct::trace_critical_arclength_binary(vdW, T0, rhovec0, csvname, opt);
+            std::ifstream ifs(csvname);
+            std::vector<std::string> lines;
+            for (std::string line; std::getline(ifs, line); ) { lines.push_back(line); }
+            REQUIRE(lines.size() == trace.size() + 1);
+            std::stringstream first(lines[1]);
+            std::vector<std::string> fields;
+            for (std::string field; std::getline(first, field, ','); ) { fields.push_back(field); }
+            CHECK(std::stod(fields.at(3)) == Approx(T0)); // The fourth column is T / K
+        }
     }
     CHECK(max_spluses.min() == Approx(max_spluses.max()).epsilon(0.01));
     CHECK(max_spluses.min() > -log(1 - 1.0 / 3.0));
@@ -475,6 +496,121 @@ TEST_CASE("Test water w/ factory", "") {
    //REQUIRE(p_withassoc == 3.14);
 }
 
+TEST_CASE("Test water + methanol mixture", "[CPA]") {
+    using namespace CPA;
+    nlohmann::json water = {
+        {"a0i / Pa m^6/mol^2",0.12277 }, {"bi / m^3/mol", 0.000014515}, {"c1", 0.67359}, {"Tc / K", 647.096},
+        {"epsABi / J/mol", 16655.0}, {"betaABi", 0.0692}, {"class","4C"}
+    };
+    nlohmann::json methanol = {
+        {"a0i / Pa m^6/mol^2",0.40531 }, {"bi / m^3/mol", 0.000030978}, {"c1", 0.43102}, {"Tc / K", 512.64},
+        {"epsABi / J/mol", 24591.0}, {"betaABi", 0.01610}, {"class","2B"}
+    };
+    double T = 350, rhomolar = 30000, R = 8.3144598;
+    
+    SECTION("splitting a fluid into two identical components changes nothing"){
+        for (auto combining : {"CR1", "ECR"}){
+            nlohmann::json jpure = {{"cubic","SRK"}, {"pures", {water}}, {"R_gas / J/mol/K", R}, {"combining", combining}};
+            nlohmann::json jsplit = {{"cubic","SRK"}, {"pures", {water, water}}, {"R_gas / J/mol/K", R}, {"combining", combining}};
+            auto pure = CPAfactory(jpure);
+            auto split = CPAfactory(jsplit);
+            auto z1 = (Eigen::ArrayXd(1) << 1.0).finished();
+            auto z2 = (Eigen::ArrayXd(2) << 0.3, 0.7).finished();
+            CHECK(split.alphar(T, rhomolar, z2) == Approx(pure.alphar(T, rhomolar, z1)));
+        }
+    }
+    SECTION("site fractions satisfy the mass-action equations"){
+        nlohmann::json j = {{"cubic","SRK"}, {"pures", {water, methanol}}, {"R_gas / J/mol/K", R}};
+        auto cpa = CPAfactory(j);
+        auto z = (Eigen::ArrayXd(2) << 0.4, 0.6).finished();
+        const auto& sites = cpa.assoc.get_sites();
+        auto X = cpa.assoc.get_X(T, rhomolar, z);
+        auto Delta = cpa.assoc.get_Delta(T, rhomolar, z);
+        for (auto k = 0; k < X.size(); ++k){
+            double summer = 0;
+            for (auto l = 0; l < X.size(); ++l){
+                summer += rhomolar*z[sites.component[l]]*sites.multiplicity[l]*Delta(k, l)*X[l];
+            }
+            CHECK(X[k]*(1 + summer) == Approx(1.0).margin(1e-14));
+        }
+    }
+    SECTION("derivatives through the implicit site fractions"){
+        nlohmann::json j = {{"cubic","SRK"}, {"pures", {water, methanol}}, {"R_gas / J/mol/K", R}, {"combining", "ECR"}};
+        auto cpa = CPAfactory(j);
+        auto z = (Eigen::ArrayXd(2) << 0.4, 0.6).finished();
+        using tdc = TDXDerivatives<decltype(cpa)>;
+        auto Ar02 = tdc::get_Ar02(cpa, T, rhomolar, z);
+        auto Ar02mcx = tdc::get_Arxy<0, 2, ADBackends::multicomplex>(cpa, T, rhomolar, z);
+        CHECK(Ar02 == Approx(Ar02mcx));
+        auto Ar11 = tdc::get_Ar11(cpa, T, rhomolar, z);
+        auto Ar11mcx = tdc::get_Arxy<1, 1, ADBackends::multicomplex>(cpa, T, rhomolar, z);
+        CHECK(Ar11 == Approx(Ar11mcx));
+        auto rhovec = (rhomolar*z).eval();
+        using id = IsochoricDerivatives<decltype(cpa)>;
+        auto H = id::build_Psir_Hessian_autodiff(cpa, T, rhovec);
+        auto Hmcx = id::build_Psir_Hessian_mcx(cpa, T, rhovec);
+        for (auto i = 0; i < 2; ++i){
+            for (auto k = 0; k < 2; ++k){
+                CHECK(H(i, k) == Approx(Hmcx(i, k)).epsilon(1e-10));
+            }
+        }
+    }
+    SECTION("no association sites at all"){
+        auto inert = water;
+        inert["class"] = "not_associating";
+        nlohmann::json j = {{"cubic","SRK"}, {"pures", {inert, inert}}, {"R_gas / J/mol/K", R}};
+        auto cpa = CPAfactory(j);
+        auto z = (Eigen::ArrayXd(2) << 0.4, 0.6).finished();
+        CHECK(cpa.assoc.get_X(T, rhomolar, z).size() == 0);
+        CHECK(cpa.assoc.alphar(T, rhomolar, z) == 0.0);
+        CHECK(cpa.alphar(T, rhomolar, z) == cpa.cubic.alphar(T, rhomolar, z));
+    }
+}
+
+TEST_CASE("Analytic derivatives of non-associating CPA match autodiff", "[CPA][analytic]") {
+    using namespace CPA;
+    nlohmann::json water = {
+        {"a0i / Pa m^6/mol^2",0.12277 }, {"bi / m^3/mol", 0.000014515}, {"c1", 0.67359}, {"Tc / K", 647.096},
+        {"epsABi / J/mol", 16655.0}, {"betaABi", 0.0692}, {"class","not_associating"}
+    };
+    nlohmann::json methanol = {
+        {"a0i / Pa m^6/mol^2",0.40531 }, {"bi / m^3/mol", 0.000030978}, {"c1", 0.43102}, {"Tc / K", 512.64},
+        {"epsABi / J/mol", 24591.0}, {"betaABi", 0.01610}, {"class","not_associating"}
+    };
+    double T = 350, rhomolar = 20000;
+    auto z = (Eigen::ArrayXd(2) << 0.4, 0.6).finished();
+    Eigen::ArrayXd rhovec = rhomolar*z;
+    for (auto cubic : {"SRK", "PR"}){
+        CAPTURE(cubic);
+        nlohmann::json j = {{"cubic", cubic}, {"pures", {water, methanol}}, {"R_gas / J/mol/K", 8.3144598}};
+        auto cpa = CPAfactory(j);
+        AutodiffOnly<decltype(cpa)> ad{cpa};
+        
+        using tdx = TDXDerivatives<decltype(cpa), double, Eigen::ArrayXd>;
+        CHECK(tdx::get_Arxy<1, 0, ADBackends::analytic>(cpa, T, rhomolar, z) == Approx(tdx::get_Arxy<1, 0, ADBackends::autodiff>(cpa, T, rhomolar, z)));
+        CHECK(tdx::get_Arxy<2, 0, ADBackends::analytic>(cpa, T, rhomolar, z) == Approx(tdx::get_Arxy<2, 0, ADBackends::autodiff>(cpa, T, rhomolar, z)));
+        CHECK(tdx::get_Arxy<0, 2, ADBackends::analytic>(cpa, T, rhomolar, z) == Approx(tdx::get_Arxy<0, 2, ADBackends::autodiff>(cpa, T, rhomolar, z)));
+        CHECK(tdx::get_Arxy<1, 1, ADBackends::analytic>(cpa, T, rhomolar, z) == Approx(tdx::get_Arxy<1, 1, ADBackends::autodiff>(cpa, T, rhomolar, z)));
+        CHECK(tdx::get_Arxy<2, 1, ADBackends::analytic>(cpa, T, rhomolar, z) == Approx(tdx::get_Arxy<2, 1, ADBackends::autodiff>(cpa, T, rhomolar, z)));
+        
+        using id = IsochoricDerivatives<decltype(cpa), double, Eigen::ArrayXd>;
+        using idad = IsochoricDerivatives<decltype(ad), double, Eigen::ArrayXd>;
+        auto [f, grad, H] = id::build_Psir_fgradHessian_autodiff(cpa, T, rhovec);
+        auto [fad, gradad, Had] = idad::build_Psir_fgradHessian_autodiff(ad, T, rhovec);
+        CHECK(f == Approx(fad));
+        auto gradonly = id::build_Psir_gradient_autodiff(cpa, T, rhovec);
+        auto Honly = id::build_Psir_Hessian_autodiff(cpa, T, rhovec);
+        for (auto i = 0; i < 2; ++i) {
+            CHECK(grad[i] == Approx(gradad[i]));
+            CHECK(gradonly[i] == Approx(gradad[i]));
+            for (auto k = 0; k < 2; ++k) {
+                CHECK(H(i, k) == Approx(Had(i, k)));
+                CHECK(Honly(i, k) == Approx(Had(i, k)));
+            }
+        }
+    }
+}
+
 TEST_CASE("Check zero(ish)","") {
     double zero = 0.0;
     REQUIRE(zero == 0.0);